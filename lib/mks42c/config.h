@@ -25,4 +25,8 @@
 #define MKS42C_ADDRESS_DEFAULT          0   // default device slave address (0-9)
 #define MKS42C_ENABLEMODE_DEFAULT       0   // active low enable pin
 
+#define MKS42C_RPC_GATEWAY              0   // 1 = binary RPC on the USB serial instead of the text output
+#define MKS42C_DRIVER_TASK              0   // 1 = cyclic reads in a dedicated driver task, loop() only prints the snapshot
+#define MKS42C_DRIVER_PERIOD            10  // driver task cycle time in ms
+
 #endif
\ No newline at end of file
@@ -37,7 +37,7 @@ static const int MAX_POS_CURRENT = 3000;
 // read commands
 #define CMD_GET_ENCODER_VALUES             0x30
 #define CMD_GET_NUMPULSES_RECEIVED         0x33 
-//#define CMD_GET_MOTOR_ANGLE 0x36 // not documented in the manual
+#define CMD_GET_MOTOR_ANGLE                0x36 // not documented in the manual, only probed
 #define CMD_GET_SHAFT_ANGLE_ERROR          0x39 
 #define CMD_GET_ENABLE_PIN_STATE           0x3A 
 #define CMD_RELEASE_SHAFT_LOCK_PROTECTION  0x3D 
@@ -88,14 +88,308 @@ void log_to_console(const uint8_t* array, size_t length) {
   Serial.println(); // Newline at the end
 }
 
-SERVO42C::SERVO42C(){}
+//#########################################################################
+// One mutex per UART. All drivers on the same bus share it so frames from
+// different tasks don't end up interleaved on the wire. It is recursive so
+// a method can keep the bus across send() calls
+//
+// A move answers status 1 when it starts and status 2 when it is done.
+// The bus is free while the move runs, so the final status can show up
+// in front of or between the frames of any other transaction. Addresses
+// waiting for one are flagged in pending and every byte read from the
+// bus that is not part of the caller's response is scanned for it
+// Guarded by the bus lock
+//#########################################################################
+static const uint8_t MKS_MAX_BUS_ADDRESSES = 16;
+
+struct servo42c_bus {
+    SemaphoreHandle_t lock;
+    uint16_t          pending;                               // bit n = 0xE0 + n waits for a final status
+    uint8_t           final_status[MKS_MAX_BUS_ADDRESSES];   // 0 = not arrived
+    unsigned long     final_deadline[MKS_MAX_BUS_ADDRESSES]; // millis() to give up
+    uint8_t           scan[MKS_DEFAULT_RECEIVE_LENGTH];
+    uint8_t           scan_length;
+};
+
+static servo42c_bus *get_bus( HardwareSerial *serial ){
+    static SemaphoreHandle_t registry_lock = xSemaphoreCreateMutex();
+    static std::map<HardwareSerial*, servo42c_bus*> buses;
+    xSemaphoreTake( registry_lock, portMAX_DELAY );
+    servo42c_bus *bus = buses[serial];
+    if( bus == NULL ){
+        bus = new servo42c_bus();
+        bus->lock = xSemaphoreCreateRecursiveMutex();
+        buses[serial] = bus;
+    }
+    xSemaphoreGive( registry_lock );
+    return bus;
+}
+
+static bool is_final_status( servo42c_bus *bus, const uint8_t *frame ){
+    uint8_t index = frame[0] - 0xE0;
+    return index < MKS_MAX_BUS_ADDRESSES && ( ( bus->pending >> index ) & 1 ) 
+           && frame[1] == 2 && frame[2] == (uint8_t)( frame[0] + frame[1] );
+}
+
+static void store_final_status( servo42c_bus *bus, uint8_t address, uint8_t status ){
+    uint8_t index = address - 0xE0;
+    bus->pending             &= ~( 1 << index );
+    bus->final_status[index]  = status;
+}
+
+//#########################################################################
+// True if the byte ends a pending final status. Its checksum byte can
+// look like the address of another axis, the final status wins
+//#########################################################################
+static bool completes_final_status( servo42c_bus *bus, uint8_t received_byte ){
+    if( bus->pending == 0 || bus->scan_length < MKS_DEFAULT_RECEIVE_LENGTH - 1 ){
+        return false;
+    }
+    uint8_t frame[MKS_DEFAULT_RECEIVE_LENGTH] = { bus->scan[bus->scan_length - 2], bus->scan[bus->scan_length - 1], received_byte };
+    return is_final_status( bus, frame );
+}
+
+//#########################################################################
+// Feed one byte that is not part of a response into the final status scan
+//#########################################################################
+static void scan_final_status( servo42c_bus *bus, uint8_t received_byte ){
+    if( bus->pending == 0 ){
+        bus->scan_length = 0;
+        return;
+    }
+    if( bus->scan_length == MKS_DEFAULT_RECEIVE_LENGTH ){
+        bus->scan[0] = bus->scan[1];
+        bus->scan[1] = bus->scan[2];
+        --bus->scan_length;
+    }
+    bus->scan[bus->scan_length++] = received_byte;
+    if( bus->scan_length == MKS_DEFAULT_RECEIVE_LENGTH && is_final_status( bus, bus->scan ) ){
+        store_final_status( bus, bus->scan[0], bus->scan[1] );
+        bus->scan_length = 0;
+    }
+}
+
+SERVO42C::SERVO42C() : microsteps( 16 ), full_steps( 200 ), _serial( NULL ), capture( NULL ), replay( NULL ), bus( NULL ), slave_address( 0xE0 ), 
+                       telemetry_seq( 0 ), telemetry(), encoder_seen( false ), last_carrier( 0 ), encoder_turns( 0 ), 
+                       pulses_seen( false ), last_pulses( 0 ), applied_current( 0 ), idle_mode( MKS_IDLE_OFF ), idle_timeout( 0 ), 
+                       idle_current( 0 ), running_continuous( false ), last_motion( 0 ), idle_since( 0 ), idle_check_encoder( 0 ), idle_check_time( 0 ), idle_check_valid( false ), 
+                       idle_stats(), params(), limits( default_limits() ), limit_override( false ), position_referenced( false ), position_stale( false ), 
+                       limit_position( 0 ), reference_steps( 0 ), reference_encoder( 0 ), limit_error( MKS_LIMIT_OK ), limit_rejections( 0 ), 
+                       probed( false ), capabilities( 0 ), sample_count( 0 ), sample_encoder( 0 ), sample_us( 0 ), measured_velocity( 0 ), 
+                       command_active( false ), command_bounded( false ), command_velocity( 0 ), command_origin( 0 ), command_target( 0 ), 
+                       command_us( 0 ), following_referenced( false ), following_inverted( false ), following_pulses( 0 ), 
+                       following_steps( 0 ) {
+    memset( unsupported, 0, sizeof( unsupported ) );
+    portMUX_INITIALIZE( &telemetry_mux );
+    portMUX_INITIALIZE( &motion_mux );
+}
 
+SERVO42C::~SERVO42C(){}
 
 bool SERVO42C::init( HardwareSerial &serial ){
     _serial = &serial;
+    bus     = get_bus( _serial );
+    return bus->lock != NULL;
+}
+
+//#########################################################################
+// Record all TX and RX bytes of this driver into the capture
+// NULL disables it. Drivers on the same bus can share one capture
+//#########################################################################
+void SERVO42C::set_capture( SERVO42C_CAPTURE *_capture ){
+    lock_bus();
+    capture = _capture;
+    unlock_bus();
+}
+
+//#########################################################################
+// Replay a capture. Call it after init() with the same SERVO42C_REPLAY
+// so receive() times out on the recorded time instead of waiting the
+// full timeout. NULL goes back to millis()
+//#########################################################################
+void SERVO42C::set_replay( SERVO42C_REPLAY *_replay ){
+    lock_bus();
+    replay = _replay;
+    unlock_bus();
+}
+
+unsigned long SERVO42C::bus_millis(){
+    return replay != NULL ? replay->get_millis() : millis();
+}
+
+//#########################################################################
+// Bus lock. Public so helpers can keep the bus for several frames
+// Every lock_bus() needs a matching unlock_bus() from the same task
+//#########################################################################
+void SERVO42C::lock_bus(){
+    xSemaphoreTakeRecursive( bus->lock, portMAX_DELAY );
+}
+
+void SERVO42C::unlock_bus(){
+    xSemaphoreGiveRecursive( bus->lock );
+}
+
+//#########################################################################
+// Throw away anything left in the RX buffer. Late responses from a
+// transaction that timed out would otherwise be taken as the answer
+// to the next command. Final status frames are picked out first
+//#########################################################################
+void SERVO42C::drain_rx(){
+    uint8_t raw[MKS_CAPTURE_MAX_DATA];
+    uint8_t raw_length = 0;
+    while( _serial->available() > 0 ){
+        uint8_t received_byte = _serial->read();
+        if( raw_length < MKS_CAPTURE_MAX_DATA ){ raw[raw_length++] = received_byte; }
+        scan_final_status( bus, received_byte );
+    }
+    if( capture != NULL && raw_length > 0 ){
+        capture->record( true, raw, raw_length );
+    }
+}
+
+//#########################################################################
+// Telemetry snapshot
+// Writers are serialized with a short critical section and bump the
+// sequence to odd while they write. Readers never block, they just retry
+// if the sequence was odd or changed while copying
+//#########################################################################
+void SERVO42C::begin_telemetry_update(){
+    portENTER_CRITICAL( &telemetry_mux );
+    telemetry_seq.fetch_add( 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+}
+
+void SERVO42C::end_telemetry_update(){
+    telemetry.timestamp = millis();
+    telemetry_seq.fetch_add( 1, std::memory_order_release );
+    portEXIT_CRITICAL( &telemetry_mux );
+}
+
+void SERVO42C::get_telemetry( servo42c_telemetry &snapshot ){
+    uint32_t seq_start, seq_end;
+    do {
+        seq_start = telemetry_seq.load( std::memory_order_acquire );
+        snapshot  = telemetry;
+        std::atomic_thread_fence( std::memory_order_acquire );
+        seq_end   = telemetry_seq.load( std::memory_order_relaxed );
+    } while( ( seq_start & 1 ) || seq_start != seq_end );
+}
+
+//#########################################################################
+// Idle policy
+// timeout_ms: ms without motion before the axis goes idle, 0 = off
+// mode:       MKS_IDLE_REDUCE_CURRENT = drop to idle_current_ma
+//             MKS_IDLE_DISABLE        = disable the driver
+// Reducing the current keeps the position, disabling may lose it if 
+// the axis is loaded. Reducing needs set_max_current() to be called
+// first so the run current is known. Call poll_idle() periodically
+//#########################################################################
+void SERVO42C::set_idle_policy( uint32_t timeout_ms, uint8_t mode, uint16_t idle_current_ma ){
+    lock_bus();
+    if( !wake_from_idle() ){
+        unlock_bus();
+        return; // still idle under the old policy, get_idle_stats() shows it
+    }
+    idle_timeout = timeout_ms;
+    idle_mode    = timeout_ms > 0 ? mode : MKS_IDLE_OFF;
+    idle_current = idle_current_ma;
+    last_motion  = millis();
+    unlock_bus();
+}
+
+//#########################################################################
+// Puts the axis into idle state if there was no motion for the timeout
+// Only reads the encoder once the timeout ran out, to make sure a long
+// move is not still running. It has to read the same value again after
+// MKS_IDLE_SETTLE_TIME. Returns true if the axis is idle
+//#########################################################################
+bool SERVO42C::poll_idle(){
+    lock_bus();
+    // without a known run current there is nothing to restore later
+    bool no_current = idle_mode == MKS_IDLE_REDUCE_CURRENT && applied_current == 0;
+    if( idle_mode == MKS_IDLE_OFF || no_current || idle_stats.idle || running_continuous || ( millis() - last_motion ) < idle_timeout ){
+        bool idle = idle_stats.idle;
+        unlock_bus();
+        return idle;
+    }
+    if( idle_check_valid && ( millis() - idle_check_time ) < MKS_IDLE_SETTLE_TIME ){
+        unlock_bus();
+        return false;
+    }
+    int64_t encoder;
+    if( !read_encoder( encoder ) ){
+        unlock_bus();
+        return false;
+    }
+    if( !idle_check_valid || encoder != idle_check_encoder ){
+        // first read or still moving, check again after the settle time
+        idle_check_encoder = encoder;
+        idle_check_time    = millis();
+        idle_check_valid   = true;
+        unlock_bus();
+        return false;
+    }
+    bool success = false;
+    if( idle_mode == MKS_IDLE_REDUCE_CURRENT ){
+        success = send_8bit_status( CMD_SET_CURRENT, idle_current / 200 ) == 1;
+    } else if( idle_mode == MKS_IDLE_DISABLE ){
+        success = send_8bit_status( CMD_SET_ENABLE_STATE, 0 ) == 1;
+    }
+    if( success ){
+        idle_stats.idle = true;
+        ++idle_stats.idle_entries;
+        idle_since = millis();
+    }
+    unlock_bus();
+    return success;
+}
+
+//#########################################################################
+// Restore current / enable state before a motion command. Called with
+// the bus locked. false if the axis stays idle, the motion command has
+// to fail then
+//#########################################################################
+bool SERVO42C::wake_from_idle(){
+    last_motion      = millis();
+    idle_check_valid = false;
+    if( !idle_stats.idle ){
+        return true;
+    }
+    unsigned long start = micros();
+    uint8_t status = 0;
+    if( idle_mode == MKS_IDLE_REDUCE_CURRENT ){
+        status = send_8bit_status( CMD_SET_CURRENT, applied_current / 200 );
+    } else if( idle_mode == MKS_IDLE_DISABLE ){
+        status = send_8bit_status( CMD_SET_ENABLE_STATE, 1 );
+    }
+    if( status != 1 ){
+        return false;
+    }
+    idle_stats.idle          = false;
+    idle_stats.last_wake_us  = micros() - start;
+    idle_stats.idle_time    += millis() - idle_since;
+    if( idle_stats.last_wake_us > idle_stats.max_wake_us ){ idle_stats.max_wake_us = idle_stats.last_wake_us; }
+    ++idle_stats.wakeups;
     return true;
 }
 
+//#########################################################################
+// true if the next motion command restores the axis from idle first. That
+// is a blocking transaction, see post_run_continuous()
+//#########################################################################
+bool SERVO42C::needs_wake(){
+    lock_bus();
+    bool idle = idle_stats.idle;
+    unlock_bus();
+    return idle;
+}
+
+void SERVO42C::get_idle_stats( servo42c_idle_stats &stats ){
+    lock_bus();
+    stats = idle_stats;
+    unlock_bus();
+}
+
 
 
 //#########################################################################
@@ -128,16 +422,32 @@ uint8_t SERVO42C::create_checksum( uint8_t *hex_blocks, int block_num ){
 // MKS_WAIT_TIMEOUT. Both are found in servo42c.h
 // if there is a connection error that will lead to a timeout and it
 // retries 3 times this would make 9 seconds of blocking
+// Commands the capability probe found unsupported fail at once
+// The bus is locked for the whole transaction including retries and
+// released before the caller parses the response
+// Commands that can answer status 2 wait until a pending final status
+// of the axis came in, the two could not be told apart. A new move
+// doesn't wait, it answers 0 or 1 and replaces the pending final status
 //#########################################################################
-bool SERVO42C::send( uint8_t *hex_block_set, size_t hex_block_size, uint8_t *response, uint8_t receive_length ){
+bool SERVO42C::send( uint8_t *hex_block_set, size_t hex_block_size, uint8_t *response, uint8_t receive_length, uint8_t retries, uint32_t timeout ){
     uint8_t retry     = 0;
     bool    success = false;
+    uint8_t cmd     = hex_block_set[1];
+    if( is_unsupported( cmd ) ){
+        return false; // the probe found the drive doesn't answer it
+    }
+    lock_bus();
+    if( cmd == CMD_GET_ENABLE_PIN_STATE || cmd == CMD_GET_SHAFT_LOCK_STATE ){
+        wait_final_status();
+    }
     do{
         //log_to_console( hex_block_set, hex_block_size );
         _serial->flush();
-        _serial->write( hex_block_set, hex_block_size ); // E0, A5, 00, 01, 0x86
-        success = receive( response, receive_length );
-    } while ( ( !success ) && ( ++retry < MKS_MAX_SEND_RETRIES ) );
+        drain_rx();
+        write_frame( hex_block_set, hex_block_size ); // E0, A5, 00, 01, 0x86
+        success = receive( response, receive_length, timeout );
+    } while ( ( !success ) && ( ++retry < retries ) );
+    unlock_bus();
     if( !success ){
         //Serial.println("Error");
     } else {
@@ -146,6 +456,107 @@ bool SERVO42C::send( uint8_t *hex_block_set, size_t hex_block_size, uint8_t *res
     return success;
 }
 
+//#########################################################################
+// Capability probe
+// Sends each probe command up to MKS_PROBE_RETRIES times with the short
+// MKS_PROBE_TIMEOUT, so a single lost answer doesn't disable a command.
+// The encoder read has to answer, otherwise the drive is taken as not
+// reachable and nothing is cached. The probe releases a tripped shaft
+// lock and stops the motor, run it before anything moves. Calling it
+// again replaces the earlier result
+//#########################################################################
+struct servo42c_probe_command {
+    uint8_t  cmd;
+    uint8_t  receive_length;
+    uint16_t capability;
+};
+
+static const servo42c_probe_command MKS_PROBE_COMMANDS[] = {
+    { CMD_GET_ENCODER_VALUES,            8, MKS_CAP_ENCODER      },
+    { CMD_GET_NUMPULSES_RECEIVED,        6, MKS_CAP_PULSES       },
+    { CMD_GET_MOTOR_ANGLE,               6, MKS_CAP_MOTOR_ANGLE  }, // length is a guess, newer MKS firmware sends an int32
+    { CMD_GET_SHAFT_ANGLE_ERROR,         4, MKS_CAP_ANGLE_ERROR  },
+    { CMD_GET_ENABLE_PIN_STATE,          3, MKS_CAP_ENABLE_STATE },
+    { CMD_RELEASE_SHAFT_LOCK_PROTECTION, 3, MKS_CAP_RELEASE_LOCK },
+    { CMD_GET_SHAFT_LOCK_STATE,          3, MKS_CAP_LOCK_STATE   },
+    { CMD_SET_STOP_MOTOR,                3, MKS_CAP_STOP         },
+};
+
+bool SERVO42C::probe_capabilities(){
+    uint8_t  hex_block_set[3] = {0};
+    uint8_t  response[8];
+    uint16_t found = 0;
+    lock_bus();
+    memset( unsupported, 0, sizeof( unsupported ) );
+    for( size_t i = 0; i < sizeof( MKS_PROBE_COMMANDS ) / sizeof( MKS_PROBE_COMMANDS[0] ); ++i ){
+        const servo42c_probe_command &probe = MKS_PROBE_COMMANDS[i];
+        hex_block_set[0] = slave_address;
+        hex_block_set[1] = probe.cmd;
+        hex_block_set[2] = create_checksum( hex_block_set, 2 );
+        if( send( hex_block_set, 3, response, probe.receive_length, MKS_PROBE_RETRIES, MKS_PROBE_TIMEOUT ) ){
+            found |= probe.capability;
+        } else if( i == 0 ){
+            break; // no answer to the most basic read, drive is not there
+        }
+    }
+    bool success = found & MKS_CAP_ENCODER;
+    if( success ){
+        for( size_t i = 0; i < sizeof( MKS_PROBE_COMMANDS ) / sizeof( MKS_PROBE_COMMANDS[0] ); ++i ){
+            // stop is never refused without trying, it's the one command
+            // that has to get through when something goes wrong
+            if( !( found & MKS_PROBE_COMMANDS[i].capability ) && MKS_PROBE_COMMANDS[i].cmd != CMD_SET_STOP_MOTOR ){
+                unsupported[MKS_PROBE_COMMANDS[i].cmd >> 3] |= 1 << ( MKS_PROBE_COMMANDS[i].cmd & 7 );
+            }
+        }
+    }
+    // a failed probe leaves nothing cached, everything is sent
+    capabilities = success ? found : 0;
+    probed       = success;
+    unlock_bus();
+    return success;
+}
+
+bool SERVO42C::is_probed(){
+    return probed;
+}
+
+uint16_t SERVO42C::get_capabilities(){
+    return capabilities;
+}
+
+//#########################################################################
+// Forget the probe result, all commands are sent again
+//#########################################################################
+void SERVO42C::clear_capabilities(){
+    lock_bus();
+    memset( unsupported, 0, sizeof( unsupported ) );
+    capabilities = 0;
+    probed       = false;
+    unlock_bus();
+}
+
+bool SERVO42C::is_unsupported( uint8_t cmd ){
+    return ( unsupported[cmd >> 3] >> ( cmd & 7 ) ) & 1;
+}
+
+//#########################################################################
+// false only for commands the probe found unsupported
+//#########################################################################
+bool SERVO42C::is_command_supported( uint8_t cmd ){
+    return !is_unsupported( cmd );
+}
+
+//#########################################################################
+// Write a frame and record it. Caller holds the bus
+//#########################################################################
+size_t SERVO42C::write_frame( uint8_t *hex_block_set, size_t hex_block_size ){
+    size_t written = _serial->write( hex_block_set, hex_block_size );
+    if( capture != NULL ){
+        capture->record( false, hex_block_set, hex_block_size );
+    }
+    return written;
+}
+
 //#########################################################################
 // Blocking function that waits for the response
 // returns false on error or timeout and true on success
@@ -153,22 +564,38 @@ bool SERVO42C::send( uint8_t *hex_block_set, size_t hex_block_size, uint8_t *res
 // does not check for the correct function code in the response...
 // todo: pass function code and ensure the response belongs to the send
 // command. Not a big issue for now.
+// On a checksum error it resyncs to the next address byte inside what
+// was collected. A final status of a pending move is taken out of the
+// stream, also if it has the address of this axis
 //#########################################################################
-bool SERVO42C::receive( uint8_t* response, uint8_t receive_length ){
-    unsigned long start_time = millis();
+bool SERVO42C::receive( uint8_t* response, uint8_t receive_length, uint32_t timeout ){
+    unsigned long start_time = bus_millis();
     unsigned long time       = start_time;
     bool          success    = false;
     uint16_t      bytes_received = 0;
     uint8_t       received_byte;
+    uint8_t       raw[MKS_CAPTURE_MAX_DATA]; // everything read, also bytes the parser dropped
+    uint8_t       raw_length = 0;
     while(1){
         if( _serial->available() > 0 ){
             received_byte = _serial->read();
-            if( bytes_received != 0 || received_byte == slave_address ){
+            if( raw_length < MKS_CAPTURE_MAX_DATA ){ raw[raw_length++] = received_byte; }
+            if( bytes_received != 0 || ( received_byte == slave_address && !completes_final_status( bus, received_byte ) ) ){
                 response[ bytes_received++ ] = received_byte;
+            } else {
+                scan_final_status( bus, received_byte );
             }
             start_time = time; // if something comes in let's get it
+        } else if( replay == NULL ){
+            // nothing there yet, block for a tick instead of spinning so
+            // a high priority caller like the driver task doesn't starve
+            // the other tasks and trip the task watchdog
+            vTaskDelay( 1 );
         }
-        if( bytes_received == receive_length ){
+        if( bytes_received == MKS_DEFAULT_RECEIVE_LENGTH && is_final_status( bus, response ) ){
+            store_final_status( bus, response[0], response[1] );
+            bytes_received = 0;
+        } else if( bytes_received == receive_length ){
             uint8_t computed_checksum = create_checksum( response, receive_length - 1 );
             uint8_t received_checksum = response[ receive_length - 1 ];
             if (received_checksum == computed_checksum) {
@@ -176,19 +603,86 @@ bool SERVO42C::receive( uint8_t* response, uint8_t receive_length ){
                 //Serial.println("Checksum OK");
                 break;
            } else {
-                bytes_received = 0;
+                // drop up to the next address byte and continue from there
+                uint16_t skip = 1;
+                while( skip < bytes_received && ( response[skip] != slave_address || completes_final_status( bus, response[skip] ) ) ){
+                    scan_final_status( bus, response[skip++] );
+                }
+                bytes_received -= skip;
+                memmove( response, response + skip, bytes_received );
                 //Serial.println("Checksum not OK");
             }
         }
-        time = millis();
-        if( ( time - start_time ) > MKS_WAIT_TIMEOUT ){
+        time = bus_millis();
+        if( ( time - start_time ) > timeout ){
             //Serial.println("Timed out");
             break;
         }
     }
+    if( capture != NULL ){
+        capture->record( true, raw, raw_length );
+    }
     return success;
 }
 
+//#########################################################################
+// Final status of a move. Caller holds the bus
+// expect_final_status() flags the axis after the move answered status 1
+// take_final_status() returns 1 while it is still pending, 2 when it
+// arrived and 0 after the timeout. Either of the last two clears it
+//#########################################################################
+void SERVO42C::expect_final_status( uint32_t timeout ){
+    uint8_t index = slave_address - 0xE0;
+    if( index >= MKS_MAX_BUS_ADDRESSES ){
+        return;
+    }
+    bus->pending              |= 1 << index;
+    bus->final_status[index]   = 0;
+    bus->final_deadline[index] = millis() + timeout;
+}
+
+uint8_t SERVO42C::take_final_status(){
+    uint8_t index = slave_address - 0xE0;
+    if( index >= MKS_MAX_BUS_ADDRESSES ){
+        return 0;
+    }
+    drain_rx();
+    uint8_t status = bus->final_status[index];
+    if( status != 0 ){
+        bus->final_status[index] = 0;
+        return status;
+    }
+    if( !( ( bus->pending >> index ) & 1 ) ){
+        return 0; // cleared by a stop
+    }
+    if( (long)( millis() - bus->final_deadline[index] ) > 0 ){
+        bus->pending &= ~( 1 << index );
+        return 0;
+    }
+    return 1;
+}
+
+//#########################################################################
+// Wait until the final status of the axis came in or timed out. Caller
+// holds the bus. The result is left for the task that moved the axis
+// Call it before raw reads with read_async(), they would take the final
+// status as whatever they expect
+//#########################################################################
+void SERVO42C::wait_final_status(){
+    uint8_t index = slave_address - 0xE0;
+    while( index < MKS_MAX_BUS_ADDRESSES && ( ( bus->pending >> index ) & 1 ) ){
+        drain_rx();
+        if( (long)( millis() - bus->final_deadline[index] ) > 0 ){
+            // lost, a late frame must not be taken for it anymore
+            bus->pending &= ~( 1 << index );
+            break;
+        }
+        unlock_bus();
+        vTaskDelay( 1 );
+        lock_bus();
+    }
+}
+
 
 
 
@@ -206,10 +700,7 @@ bool SERVO42C::receive( uint8_t* response, uint8_t receive_length ){
 // true = enabled, false = disabled
 //#########################################################################
 bool SERVO42C::get_enable_state(){
-    uint8_t status = send_raw_cmd_status( CMD_GET_ENABLE_PIN_STATE );
-    if( status == 0 ){ 
-        // unhandled error
-    }
+    uint8_t status = read_state( CMD_GET_ENABLE_PIN_STATE );
     return status == 1 ? true : false;
 }
 
@@ -237,29 +728,112 @@ bool SERVO42C::release_shaft_lock_protection(){
 // true = protected, false = not proteced
 //#########################################################################
 bool SERVO42C::get_shaft_lock_protection_state(){
-    uint8_t status = send_raw_cmd_status( CMD_GET_SHAFT_LOCK_STATE );
+    uint8_t status = read_state( CMD_GET_SHAFT_LOCK_STATE );
+    return status == 1 ? true : false;
+}
+
+//#########################################################################
+// Enable pin or shaft lock state into the telemetry
+// returns the raw status, 0 = error
+//#########################################################################
+uint8_t SERVO42C::read_state( uint8_t cmd ){
+    uint8_t status = send_raw_cmd_status( cmd );
     if( status == 0 ){ 
         // unhandled error
+    } else {
+        begin_telemetry_update();
+        if( cmd == CMD_GET_ENABLE_PIN_STATE ){
+            telemetry.enabled = status == 1;
+        } else {
+            telemetry.shaft_locked = status == 1;
+        }
+        end_telemetry_update();
     }
-    return status == 1 ? true : false;
+    return status;
+}
+
+bool SERVO42C::read_angle_error( int16_t &value ){
+    if( send_raw_cmd_get_16bit( CMD_GET_SHAFT_ANGLE_ERROR, 4, value ) ){
+        begin_telemetry_update();
+        telemetry.angle_error = value;
+        end_telemetry_update();
+        return true;
+    }
+    return false;
 }
 
 float SERVO42C::get_shaft_angle_error(){
-    int16_t value = send_raw_cmd_get_16bit( CMD_GET_SHAFT_ANGLE_ERROR, 4 );
+    int16_t value = 0;
+    read_angle_error( value );
     return (static_cast<float>(value) / 0xFFFF)*360.0f;
 }
+
+//#########################################################################
+// Read one input into the telemetry, input is one of MKS_INPUT_*
+// Unlike the getters above it returns false if the read failed
+//#########################################################################
+bool SERVO42C::read_input( uint8_t input ){
+    int64_t encoder;
+    int32_t pulses;
+    int16_t angle_error;
+    switch( input ){
+        case MKS_INPUT_ENCODER:      return read_encoder( encoder );
+        case MKS_INPUT_PULSES:       return read_pulses( pulses );
+        case MKS_INPUT_ANGLE_ERROR:  return read_angle_error( angle_error );
+        case MKS_INPUT_ENABLE_STATE: return read_state( CMD_GET_ENABLE_PIN_STATE ) != 0;
+        case MKS_INPUT_LOCK_STATE:   return read_state( CMD_GET_SHAFT_LOCK_STATE ) != 0;
+    }
+    return false;
+}
 int32_t SERVO42C::get_pulses_received(){
-    int32_t value = send_raw_cmd_get_32bit( CMD_GET_NUMPULSES_RECEIVED, 6 );
+    int32_t value = 0;
+    read_pulses( value );
     return value;
 }
 int64_t SERVO42C::get_encoder_value(){
+    int64_t value = 0;
+    read_encoder( value );
+    return value;
+}
+
+//#########################################################################
+// Read the pulses received and update the unwrapped counter
+//#########################################################################
+bool SERVO42C::read_pulses( int32_t &value ){
+    if( send_raw_cmd_get_32bit( CMD_GET_NUMPULSES_RECEIVED, 6, value ) ){
+        begin_telemetry_update();
+        if( pulses_seen ){
+            // difference in 32bit wraps correctly if the counter overflowed
+            telemetry.pulses += (int32_t)( (uint32_t)value - (uint32_t)last_pulses );
+        } else {
+            telemetry.pulses = value;
+            pulses_seen      = true;
+        }
+        last_pulses = value;
+        end_telemetry_update();
+        return true;
+    }
+    return false;
+}
+
+//#########################################################################
+// Read the encoder and update the unwrapped multi-turn position
+//#########################################################################
+bool SERVO42C::read_encoder( int64_t &encoder ){
     uint8_t receive_length = 8;
     uint8_t hex_block_set[3] = {0};
     uint8_t response[receive_length];
     hex_block_set[0] = slave_address;
     hex_block_set[1] = CMD_GET_ENCODER_VALUES;
     hex_block_set[2] = create_checksum( hex_block_set, 2 );
-    if( send( hex_block_set, 3, response, receive_length ) ){
+    // the drive samples somewhere between request and answer, take the middle
+    // the bus is locked first so waiting for it doesn't count
+    lock_bus();
+    uint32_t request_us = micros();
+    bool     success    = send( hex_block_set, 3, response, receive_length );
+    uint32_t sample_time = request_us + ( micros() - request_us ) / 2;
+    unlock_bus();
+    if( success ){
         // first hex value E0 is the slave address and the last 01 is the checksum
         // hex value response[1] to respones[4] form a int32_t holding the carrier and response[5] response[6] form a int16_t holding the value
         // carrier is the number of total shaft turns done and value the position in the current rotation
@@ -271,19 +845,381 @@ int64_t SERVO42C::get_encoder_value(){
         carrier |= static_cast<int32_t>(response[4]);
         // Parse value
         uint16_t value = (uint16_t)(((uint16_t)response[5] << 8) | response[6]); // the current position in the actual revolution
-        return ((int64_t)carrier * 65536LL) + (int64_t)value;
+        begin_telemetry_update();
+        if( encoder_seen ){
+            // the carrier is only 32bit on the wire. Track the turns in 64bit
+            encoder_turns += (int32_t)( (uint32_t)carrier - (uint32_t)last_carrier );
+        } else {
+            encoder_turns = carrier;
+            encoder_seen  = true;
+        }
+        last_carrier = carrier;
+        encoder = encoder_turns * 65536LL + (int64_t)value;
+        telemetry.encoder = encoder;
+        end_telemetry_update();
+        record_sample( encoder, sample_time );
+        return true;
+    }
+    return false;
+}
+
+//#########################################################################
+// Microsteps per revolution based on the last motor type and subdivision
+// that were set successfully
+//#########################################################################
+uint32_t SERVO42C::get_steps_per_revolution(){
+    return (uint32_t)full_steps * microsteps;
+}
+
+//#########################################################################
+// Store a parameter after the drive confirmed it
+//#########################################################################
+void SERVO42C::remember_param( uint8_t param, uint16_t value ){
+    lock_bus();
+    params.value[param] = value;
+    params.valid       |= ( 1UL << param );
+    unlock_bus();
+}
+
+//#########################################################################
+// Copy of all parameters this instance has applied to the drive
+//#########################################################################
+void SERVO42C::get_params( servo42c_params &_params ){
+    lock_bus();
+    _params = params;
+    unlock_bus();
+}
+
+//#########################################################################
+// Soft limits, see servo42c.h
+// The check is O(1) and never touches the bus. Limits start disabled
+//#########################################################################
+servo42c_limits SERVO42C::default_limits(){
+    servo42c_limits limits;
+    limits.enabled          = false;
+    limits.min_steps        = INT64_MIN;
+    limits.max_steps        = INT64_MAX;
+    limits.max_speed        = 127;
+    limits.encoder_inverted = false;
+    return limits;
+}
+
+void SERVO42C::set_limits( const servo42c_limits &_limits ){
+    lock_bus();
+    limits = _limits;
+    unlock_bus();
+}
+
+void SERVO42C::get_limits( servo42c_limits &_limits ){
+    lock_bus();
+    _limits = limits;
+    unlock_bus();
+}
+
+//#########################################################################
+// Skip the checks while active. For homing routines that have to move
+// before the position is known. Moves still update the position
+//#########################################################################
+void SERVO42C::set_limit_override( bool active ){
+    lock_bus();
+    limit_override = active;
+    unlock_bus();
+}
+
+//#########################################################################
+// Define the current position as steps. Reads the encoder once
+//#########################################################################
+bool SERVO42C::set_position_reference( int64_t steps ){
+    int64_t encoder;
+    lock_bus();
+    bool success = read_encoder( encoder );
+    if( success ){
+        reference_steps     = steps;
+        reference_encoder   = encoder_to_steps( encoder );
+        limit_position      = steps;
+        position_referenced = true;
+        position_stale      = false;
+        set_following_reference(); // drives without 0x33 just have no following error
+    }
+    unlock_bus();
+    return success;
+}
+
+//#########################################################################
+// Set the tracked position from the encoder. Needs a reference
+//#########################################################################
+bool SERVO42C::sync_position(){
+    int64_t encoder;
+    lock_bus();
+    bool success = position_referenced && read_encoder( encoder );
+    if( success ){
+        int64_t moved  = encoder_to_steps( encoder ) - reference_encoder;
+        limit_position = reference_steps + ( limits.encoder_inverted ? -moved : moved );
+        position_stale = false;
+    }
+    unlock_bus();
+    return success;
+}
+
+int64_t SERVO42C::get_limit_position(){
+    lock_bus();
+    int64_t position = limit_position;
+    unlock_bus();
+    return position;
+}
+
+//#########################################################################
+// Check a move without sending it. Returns MKS_LIMIT_*
+//#########################################################################
+uint8_t SERVO42C::check_move( uint8_t dir, uint8_t speed, uint32_t steps ){
+    lock_bus();
+    uint8_t result = check_limits( dir, speed, steps );
+    unlock_bus();
+    return result;
+}
+
+//#########################################################################
+// Hot path check, caller holds the bus. Records the result
+//#########################################################################
+uint8_t SERVO42C::check_limits( uint8_t dir, uint8_t speed, uint32_t steps ){
+    uint8_t result = MKS_LIMIT_OK;
+    if( limits.enabled && !limit_override ){
+        int64_t target = limit_position + ( dir == 1 ? -(int64_t)steps : (int64_t)steps );
+        if( speed > limits.max_speed ){
+            result = MKS_LIMIT_SPEED;
+        } else if( !position_referenced || position_stale ){
+            result = MKS_LIMIT_NO_REFERENCE;
+        } else if( target < limits.min_steps ){
+            result = MKS_LIMIT_BELOW_MIN;
+        } else if( target > limits.max_steps ){
+            result = MKS_LIMIT_ABOVE_MAX;
+        }
+    }
+    limit_error = result;
+    if( result != MKS_LIMIT_OK ){
+        ++limit_rejections;
+    }
+    return result;
+}
+
+//#########################################################################
+// Same for continuous runs. A run has no target to check, it would only
+// stop at a limit if the caller stops it in time. So with the limits on
+// it may only go in a direction without a limit. Speed 0 always passes
+//#########################################################################
+uint8_t SERVO42C::check_continuous( uint8_t dir, uint8_t speed ){
+    uint8_t result = MKS_LIMIT_OK;
+    if( speed > 0 && limits.enabled && !limit_override ){
+        if( speed > limits.max_speed ){
+            result = MKS_LIMIT_SPEED;
+        } else if( dir == 1 ? limits.min_steps != INT64_MIN : limits.max_steps != INT64_MAX ){
+            result = MKS_LIMIT_CONTINUOUS;
+        }
+    }
+    limit_error = result;
+    if( result != MKS_LIMIT_OK ){
+        ++limit_rejections;
+    }
+    return result;
+}
+
+//#########################################################################
+// Result of the last checked motion command
+//#########################################################################
+uint8_t SERVO42C::get_limit_error(){
+    return limit_error;
+}
+
+uint32_t SERVO42C::get_limit_rejections(){
+    return limit_rejections;
+}
+
+//#########################################################################
+// Convert encoder counts (65536 per revolution) to microsteps
+// Turns and the position inside the turn are scaled separately so the
+// multiplication can't overflow. Rounds towards negative infinity
+//#########################################################################
+int64_t SERVO42C::encoder_to_steps( int64_t encoder ){
+    int64_t steps_per_rev = get_steps_per_revolution();
+    int64_t turns         = encoder >> 16;
+    int64_t counts        = encoder & 0xFFFF;
+    return turns * steps_per_rev + ( ( counts * steps_per_rev ) >> 16 );
+}
+
+//#########################################################################
+// Reads encoder and pulses received and fills the position
+// returns false if one of the reads failed. The position is then based
+// on the last good values
+//#########################################################################
+bool SERVO42C::get_position( servo42c_position &position ){
+    int64_t encoder;
+    int32_t pulses;
+    bool    success = read_encoder( encoder );
+    success &= read_pulses( pulses );
+    get_cached_position( position );
+    return success;
+}
+
+//#########################################################################
+// Take the current pulses and encoder as zero of the following error
+// The pulse counter and the encoder have unrelated zero points, call it
+// at standstill. set_position_reference() does it too. A later
+// set_motor_dir() drops it
+//#########################################################################
+bool SERVO42C::set_following_reference(){
+    int64_t encoder;
+    int32_t pulses;
+    lock_bus();
+    bool success = read_encoder( encoder ) && read_pulses( pulses );
+    if( success ){
+        servo42c_telemetry snapshot;
+        get_telemetry( snapshot );
+        bool reversed = ( params.valid & ( 1UL << MKS_PARAM_MOTOR_DIR ) ) && params.value[MKS_PARAM_MOTOR_DIR] == 1;
+        int64_t steps = encoder_to_steps( snapshot.encoder );
+        portENTER_CRITICAL( &motion_mux );
+        following_referenced = true;
+        following_inverted   = reversed != limits.encoder_inverted;
+        following_pulses     = snapshot.pulses;
+        following_steps      = steps;
+        portEXIT_CRITICAL( &motion_mux );
+    }
+    unlock_bus();
+    return success;
+}
+
+//#########################################################################
+// Position from the last values seen on the wire. No bus traffic
+//#########################################################################
+void SERVO42C::get_cached_position( servo42c_position &position ){
+    servo42c_telemetry snapshot;
+    get_telemetry( snapshot );
+    position.encoder   = snapshot.encoder;
+    position.steps     = encoder_to_steps( snapshot.encoder );
+    position.pulses    = snapshot.pulses;
+    position.timestamp = snapshot.timestamp;
+    portENTER_CRITICAL( &motion_mux );
+    bool    referenced = following_referenced;
+    bool    inverted   = following_inverted;
+    int64_t pulses_ref = following_pulses;
+    int64_t steps_ref  = following_steps;
+    portEXIT_CRITICAL( &motion_mux );
+    int64_t commanded  = position.pulses - pulses_ref;
+    position.following_valid = referenced;
+    position.following_error = referenced ? ( inverted ? -commanded : commanded ) - ( position.steps - steps_ref ) : 0;
+}
+
+//#########################################################################
+// Signed encoder counts per second for a speed value
+// dir 0 counts the encoder up unless the limits say encoder_inverted
+//#########################################################################
+int32_t SERVO42C::speed_to_velocity( uint8_t dir, uint8_t speed ){
+    int64_t velocity = (int64_t)( speed & 0x7F ) * MKS_SPEED_STEPS_PER_SECOND * 65536 / get_steps_per_revolution();
+    return ( dir == 1 ) != limits.encoder_inverted ? -(int32_t)velocity : (int32_t)velocity;
+}
+
+void SERVO42C::record_sample( int64_t encoder, uint32_t time_us ){
+    portENTER_CRITICAL( &motion_mux );
+    int32_t elapsed = (int32_t)( time_us - sample_us );
+    if( sample_count > 0 && elapsed > 0 && (uint32_t)elapsed < MKS_PREDICT_HORIZON ){
+        measured_velocity = (int32_t)( ( encoder - sample_encoder ) * 1000000 / elapsed );
     } else {
-        // error not handled. Just returns 0...
-        return 0;
+        measured_velocity = 0; // too far apart to say anything
+    }
+    sample_encoder = encoder;
+    sample_us      = time_us;
+    if( sample_count < 2 ){ ++sample_count; }
+    portEXIT_CRITICAL( &motion_mux );
+}
+
+//#########################################################################
+// Called with the bus locked after the drive accepted a motion command
+// bounded: move of steps microsteps, otherwise a continuous run
+//#########################################################################
+void SERVO42C::set_motion_command( uint8_t dir, uint8_t speed, bool bounded, uint32_t steps ){
+    servo42c_prediction now;
+    predict_position( now );
+    int64_t distance = (int64_t)steps * 65536 / get_steps_per_revolution();
+    int32_t velocity = speed_to_velocity( dir, speed );
+    portENTER_CRITICAL( &motion_mux );
+    command_active   = true;
+    command_bounded  = bounded;
+    command_velocity = velocity;
+    command_origin   = now.encoder;
+    command_target   = now.encoder + ( velocity < 0 ? -distance : distance );
+    command_us       = micros();
+    portEXIT_CRITICAL( &motion_mux );
+}
+
+//#########################################################################
+// Motion the library doesn't know the speed of, like goto zero
+// The prediction falls back to the measured velocity
+//#########################################################################
+void SERVO42C::clear_motion_command(){
+    portENTER_CRITICAL( &motion_mux );
+    command_active = false;
+    portEXIT_CRITICAL( &motion_mux );
+}
+
+//#########################################################################
+// Position extrapolated to now. No bus traffic, callable from any task
+//#########################################################################
+void SERVO42C::predict_position( servo42c_prediction &prediction ){
+    portENTER_CRITICAL( &motion_mux );
+    uint8_t  count          = sample_count;
+    int64_t  encoder        = sample_encoder;
+    uint32_t time_us        = sample_us;
+    int32_t  measured       = measured_velocity;
+    bool     active         = command_active;
+    bool     bounded        = command_bounded;
+    int32_t  velocity       = command_velocity;
+    int64_t  origin         = command_origin;
+    int64_t  target         = command_target;
+    uint32_t accepted_us    = command_us;
+    portEXIT_CRITICAL( &motion_mux );
+    uint32_t now_us = micros();
+    memset( &prediction, 0, sizeof( prediction ) );
+    if( count == 0 ){
+        prediction.source = MKS_PREDICT_NONE;
+        return;
+    }
+    // a sample older than the command doesn't know about it
+    // extrapolate from where the command started instead
+    bool sample_before_command = active && (int32_t)( accepted_us - time_us ) > 0;
+    int64_t  base    = encoder;
+    uint32_t base_us = time_us;
+    if( sample_before_command ){
+        base    = origin;
+        base_us = accepted_us;
+    }
+    if( !active ){
+        velocity = measured;
     }
-    return 0;
+    int64_t predicted = base + (int64_t)velocity * (int64_t)( now_us - base_us ) / 1000000;
+    if( active && bounded && ( velocity > 0 ? predicted >= target : predicted <= target ) ){
+        predicted = target; // move segment is done
+        velocity  = 0;
+    }
+    uint32_t age = now_us - time_us;
+    uint8_t confidence = 100;
+    if( velocity != 0 ){
+        confidence = age >= MKS_PREDICT_HORIZON ? 0 : (uint8_t)( 100 - (uint64_t)age * 100 / MKS_PREDICT_HORIZON );
+    }
+    if( sample_before_command ){
+        confidence /= 2;
+    }
+    prediction.encoder    = predicted;
+    prediction.steps      = encoder_to_steps( predicted );
+    prediction.velocity   = velocity;
+    prediction.age_us     = age;
+    prediction.confidence = confidence;
+    prediction.source     = velocity == 0 ? MKS_PREDICT_STANDSTILL : ( active ? MKS_PREDICT_COMMANDED : MKS_PREDICT_MEASURED );
 }
 
 //###########################################################
-// Sends a raw command and returns a int16_t
-// returns 0 on error.... unhandled
+// Sends a raw command and reads a int16_t into value
+// returns false on error and leaves value untouched
 //###########################################################
-int16_t SERVO42C::send_raw_cmd_get_16bit( uint8_t cmd, uint8_t receive_length ){
+bool SERVO42C::send_raw_cmd_get_16bit( uint8_t cmd, uint8_t receive_length, int16_t &value ){
     uint8_t hex_block_set[3] = {0};
     uint8_t response[receive_length];
     hex_block_set[0] = slave_address;
@@ -291,18 +1227,19 @@ int16_t SERVO42C::send_raw_cmd_get_16bit( uint8_t cmd, uint8_t receive_length ){
     hex_block_set[2] = create_checksum( hex_block_set, 2 );
     if( send( hex_block_set, 3, response, receive_length ) ){
         // looks good
-        return (int16_t)((response[1] << 8) | response[2]); // big endian
+        value = (int16_t)((response[1] << 8) | response[2]); // big endian
+        return true;
     } else {
         // not so good
-        return 0;
+        return false;
     }
 }
 
 //###########################################################
-// Sends a raw command and returns a int32_t
-// returns 0 on error.... unhandled
+// Sends a raw command and reads a int32_t into value
+// returns false on error and leaves value untouched
 //###########################################################
-int32_t SERVO42C::send_raw_cmd_get_32bit( uint8_t cmd, uint8_t receive_length ){
+bool SERVO42C::send_raw_cmd_get_32bit( uint8_t cmd, uint8_t receive_length, int32_t &value ){
     uint8_t hex_block_set[3] = {0};
     uint8_t response[receive_length];
     hex_block_set[0] = slave_address;
@@ -315,10 +1252,11 @@ int32_t SERVO42C::send_raw_cmd_get_32bit( uint8_t cmd, uint8_t receive_length ){
         result |= ((int32_t)response[2] << 16);
         result |= ((int32_t)response[3] << 8);
         result |= ((int32_t)response[4]);
-        return result;
+        value = result;
+        return true;
     } else {
         // not so good
-        return 0;
+        return false;
     }
 }
 
@@ -336,7 +1274,32 @@ bool SERVO42C::set_move_steps( uint8_t dir, uint8_t speed, uint32_t steps, bool
     if( speed > 127 ){ speed = 127; }
     speed &= 0x7F; // redundant
     uint8_t data = (dir==1 ? 0x80 : 0x00) | speed; // direction and speed is packed into a single byte, first bit is dir, last 7 bits speed, padded with leading zeros if needed
+    lock_bus();
+    if( position_stale && limits.enabled && !limit_override ){
+        sync_position();
+    }
+    if( check_limits( dir, speed, steps ) != MKS_LIMIT_OK ){
+        unlock_bus();
+        return false;
+    }
+    if( !wake_from_idle() ){
+        unlock_bus();
+        return false;
+    }
+    running_continuous = false;
     uint8_t status = send_8bit_32bit_status( CMD_SET_RUN_BY_STEPNUM, data, steps );
+    unsigned long timeout = steps * 100; // 100ms step delay should be ok for a timeout?
+    if( status != 0 ){
+        limit_position += dir == 1 ? -(int64_t)steps : (int64_t)steps;
+        set_motion_command( dir, speed, true, steps );
+    }
+    if( status == 1 ){
+        // flagged before the bus is released so nobody takes the final
+        // status for the answer to its own command. Also without
+        // blocking, the frame still comes and has to be taken out
+        expect_final_status( timeout );
+    }
+    unlock_bus();
     if( status == 0 ){
         //Serial.println("Run failed");
         return false;
@@ -349,19 +1312,12 @@ bool SERVO42C::set_move_steps( uint8_t dir, uint8_t speed, uint32_t steps, bool
         // so this blocking part is somehow almost useless
         // except for ensuring that the function exits after the stepper started
         // moving... 
-        unsigned long start_time = millis();
-        unsigned long time       = start_time;
-        unsigned long timeout    = steps * 100; // 100ms step delay should be ok for a timeout?
-        uint8_t response[MKS_DEFAULT_RECEIVE_LENGTH];
+        // The bus is only taken for each poll, other axes keep working
         while( status == 1 ){
             vTaskDelay(10);
-            if( receive( response, MKS_DEFAULT_RECEIVE_LENGTH ) ){
-                status = extract_status( response );
-            }
-            time = millis();
-            if( ( time - start_time ) > timeout ){
-                break;
-            }
+            lock_bus();
+            status = take_final_status();
+            unlock_bus();
         }
     }
 
@@ -389,6 +1345,12 @@ bool SERVO42C::set_move_steps( uint8_t dir, uint8_t speed, uint32_t steps, bool
 //##################################################################
 bool SERVO42C::set_restore_defaults(){
     uint8_t status = send_raw_cmd_status( CMD_SET_RESTORE_DEFAULT );
+    if( status == 1 ){
+        // nothing applied by the library survives a factory reset
+        lock_bus();
+        params.valid = 0;
+        unlock_bus();
+    }
     return status == 1 ? true : false;
 }
 
@@ -404,11 +1366,25 @@ bool SERVO42C::set_restore_defaults(){
 bool SERVO42C::set_stop_motor(){
     //Serial.println("Stopping motor");
     uint8_t status = send_raw_cmd_status( CMD_SET_STOP_MOTOR );
+    if( status == 1 ){
+        lock_bus();
+        uint8_t index = slave_address - 0xE0;
+        if( index < MKS_MAX_BUS_ADDRESSES && ( ( bus->pending >> index ) & 1 ) ){
+            store_final_status( bus, slave_address, 2 ); // a blocking move returns now
+        }
+        running_continuous = false;
+        last_motion        = millis();
+        position_stale     = true; // a move may have been cut short
+        set_motion_command( 0, 0, false );
+        unlock_bus();
+    }
     return status == 1 ? true : false;
 }
 
 //##############################################################
 // Start calibration
+// Blocks until the drive reports the result, up to MKS_CALIBRATE_TIMEOUT
+// Use SERVO42C_CALIBRATION to calibrate without blocking
 //
 // UART return: 
 // status 1 = Calibrate success - status 2 = Calibrating failed
@@ -417,10 +1393,47 @@ bool SERVO42C::set_stop_motor(){
 // true = success, false = error
 //##################################################################
 bool SERVO42C::set_calibrate(){
-    uint8_t status = send_8bit_status( CMD_ENCODER_CALIBRATE, 0x00 );
+    // not send() with its retries, a retry would restart the calibration
+    // and the final status only comes after the calibration finished.
+    // Status 0 = still calibrating, some firmware sends it first
+    uint8_t response[MKS_DEFAULT_RECEIVE_LENGTH] = {0};
+    uint8_t status = 0;
+    lock_bus();
+    wait_final_status(); // status 2 = failed, see send()
+    _serial->flush();
+    drain_rx();
+    unsigned long start   = millis();
+    bool          success = post_calibrate();
+    while( success && status == 0 ){
+        uint32_t elapsed = millis() - start;
+        success = elapsed < MKS_CALIBRATE_TIMEOUT && receive( response, MKS_DEFAULT_RECEIVE_LENGTH, MKS_CALIBRATE_TIMEOUT - elapsed );
+        status  = success ? extract_status( response ) : 0;
+    }
+    unlock_bus();
     return status == 1 ? true : false;
 }
 
+//##############################################################
+// Start calibration without waiting for the status
+// The status frame (address, 1 = success / 2 = failed, checksum)
+// arrives after up to MKS_CALIBRATE_TIMEOUT and has to be read
+// with read_async(). See SERVO42C_CALIBRATION. A move still running
+// is waited for, its final status looks like a failed calibration
+//##################################################################
+bool SERVO42C::post_calibrate(){
+    uint8_t hex_block_set[4] = {0};
+    get_8bit_hexblocks( CMD_ENCODER_CALIBRATE, 0x00, hex_block_set );
+    lock_bus();
+    wait_final_status();
+    if( !wake_from_idle() ){
+        unlock_bus();
+        return false;
+    }
+    size_t written = write_frame( hex_block_set, 4 );
+    unlock_bus();
+    return written == 4;
+}
+
 //##############################################################
 // Set the motor type
 // 0 = 0.9° step angle, 1 = 1.8" step angle (more common)
@@ -434,6 +1447,10 @@ bool SERVO42C::set_calibrate(){
 bool SERVO42C::set_motor_type( uint8_t value ){
     if( value > 1 ){ value = 1; }
     uint8_t status = send_8bit_status( CMD_SET_MOTOR_TYPE, value );
+    if( status == 1 ){
+        full_steps = value == 0 ? 400 : 200;
+        remember_param( MKS_PARAM_MOTOR_TYPE, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -450,6 +1467,9 @@ bool SERVO42C::set_motor_type( uint8_t value ){
 bool SERVO42C::set_work_mode( uint8_t value ){
     if( value > 2 ){ value = 2; }
     uint8_t status = send_8bit_status( CMD_SET_WORK_MODE, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_WORK_MODE, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -468,13 +1488,25 @@ bool SERVO42C::set_max_current( uint16_t current_ma ){
     // current is send as integer from 0-15 that is then
     // multiplied by 200 on the MKS
     uint8_t value  = round( current_ma / 200 );
+    lock_bus();
     uint8_t status = send_8bit_status( CMD_SET_CURRENT, value );
+    if( status == 1 ){
+        applied_current = current_ma;
+        remember_param( MKS_PARAM_CURRENT, current_ma );
+        if( idle_mode == MKS_IDLE_REDUCE_CURRENT && idle_stats.idle ){
+            // full current is back, the axis is not idle anymore
+            idle_stats.idle       = false;
+            idle_stats.idle_time += millis() - idle_since;
+            last_motion           = millis();
+        }
+    }
+    unlock_bus();
     return status == 1 ? true : false;
 }
 
 //##############################################################
 // Set the subdivision / microsteps
-// Range: 0 - 255 
+// Range: 0 - 255 (0 = 256)
 //
 // UART return:
 // status 1 = Set success - status 0 = Set failed
@@ -485,6 +1517,10 @@ bool SERVO42C::set_max_current( uint16_t current_ma ){
 bool SERVO42C::set_subdivision( uint8_t value ){
     if( value > 255 ){ value = 255; }
     uint8_t status = send_8bit_status( CMD_SET_SUBDIVISION, value );
+    if( status == 1 ){
+        microsteps = value == 0 ? 256 : value;
+        remember_param( MKS_PARAM_SUBDIVISION, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -501,6 +1537,9 @@ bool SERVO42C::set_subdivision( uint8_t value ){
 bool SERVO42C::set_enable_mode( uint8_t value ){
     if( value > 2 ){ value = 2; }
     uint8_t status = send_8bit_status( CMD_SET_ENABLE_PIN_ACTIVE_MODE, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_ENABLE_MODE, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -517,6 +1556,12 @@ bool SERVO42C::set_enable_mode( uint8_t value ){
 bool SERVO42C::set_motor_dir( uint8_t value ){
     if( value > 1 ){ value = 1; }
     uint8_t status = send_8bit_status( CMD_SET_MOTOR_DIRECTION, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_MOTOR_DIR, value );
+        portENTER_CRITICAL( &motion_mux );
+        following_referenced = false; // pulses count the other way now
+        portEXIT_CRITICAL( &motion_mux );
+    }
     return status == 1 ? true : false;
 }
 
@@ -533,6 +1578,9 @@ bool SERVO42C::set_motor_dir( uint8_t value ){
 bool SERVO42C::set_screen_auto_off( uint8_t value ){
     if( value > 1 ){ value = 1; }
     uint8_t status = send_8bit_status( CMD_SET_AUTO_SCREEN_OFF, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_SCREEN_AUTO_OFF, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -549,6 +1597,9 @@ bool SERVO42C::set_screen_auto_off( uint8_t value ){
 bool SERVO42C::set_shaft_lock_protection( uint8_t value ){
     if( value > 1 ){ value = 1; }
     uint8_t status = send_8bit_status( CMD_SET_SHAFT_LOCK_PROTECTION, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_SHAFT_LOCK_PROTECTION, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -566,6 +1617,9 @@ bool SERVO42C::set_shaft_lock_protection( uint8_t value ){
 bool SERVO42C::set_subdivision_interpolation( uint8_t value ){
     if( value > 1 ){ value = 1; }
     uint8_t status = send_8bit_status( CMD_SET_SUBDIVISON_INTERPOLATION, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_SUBDIVISION_INTERPOLATION, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -587,6 +1641,9 @@ bool SERVO42C::set_subdivision_interpolation( uint8_t value ){
 bool SERVO42C::set_baudrate( uint8_t value ){
     if( value > 6 ){ value = 6; } else if( value < 1 ){ value = 1; }
     uint8_t status = send_8bit_status( CMD_SET_BAUDRATE, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_BAUDRATE, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -604,6 +1661,32 @@ bool SERVO42C::set_slave_address( uint8_t value ){
     if( value > 9 ){ value = 9; }
     slave_address = 0xE0 + value; // set internal address
     uint8_t status = send_8bit_status( CMD_SET_SLAVE_ADDRESS, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_SLAVE_ADDRESS, value );
+    }
+    return status == 1 ? true : false;
+}
+
+//##################################################################
+// Move the drive to another UART slave address
+// Range: 0 - 9
+//
+// Unlike set_slave_address() the frame goes to the address the
+// drive answers on now. The drive acks from the old address and
+// the host side switches to the new one only after that ack
+//
+// Function return:
+// true = success, false = error
+//##################################################################
+bool SERVO42C::change_slave_address( uint8_t value ){
+    if( value > 9 ){ value = 9; }
+    lock_bus();
+    uint8_t status = send_8bit_status( CMD_SET_SLAVE_ADDRESS, value );
+    if( status == 1 ){
+        slave_address = 0xE0 + value;
+        remember_param( MKS_PARAM_SLAVE_ADDRESS, value );
+    }
+    unlock_bus();
     return status == 1 ? true : false;
 }
 
@@ -620,6 +1703,9 @@ bool SERVO42C::set_slave_address( uint8_t value ){
 bool SERVO42C::set_zero_mode( uint8_t value ){
     if( value > 2 ){ value = 2; }
     uint8_t status = send_8bit_status( CMD_SET_ZEROMODE_MODE, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_ZERO_MODE, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -651,6 +1737,9 @@ bool SERVO42C::set_zero_position(){
 bool SERVO42C::set_zero_mode_speed( uint8_t value ){
     if( value > 4 ){ value = 4; }
     uint8_t status = send_8bit_status( CMD_SET_ZEROMODE_SPEED, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_ZERO_MODE_SPEED, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -667,6 +1756,9 @@ bool SERVO42C::set_zero_mode_speed( uint8_t value ){
 bool SERVO42C::set_zero_mode_direction( uint8_t value ){
     if( value > 1 ){ value = 1; }
     uint8_t status = send_8bit_status( CMD_SET_ZEROMODE_DIR, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_ZERO_MODE_DIRECTION, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -680,7 +1772,17 @@ bool SERVO42C::set_zero_mode_direction( uint8_t value ){
 // true = success, false = error
 //##################################################################
 bool SERVO42C::set_goto_zero(){
+    lock_bus();
+    if( !wake_from_idle() ){
+        unlock_bus();
+        return false;
+    }
     uint8_t status = send_8bit_status( CMD_SET_ZEROMODE_GOTO_ZERO, 0x00 );
+    if( status == 1 ){
+        position_stale = true; // the drive moves on its own
+        clear_motion_command();
+    }
+    unlock_bus();
     return status == 1 ? true : false;
 }
 
@@ -704,6 +1806,9 @@ bool SERVO42C::set_goto_zero(){
 //##################################################################
 bool SERVO42C::set_pid_kp( uint16_t value ){
     uint8_t status = send_16bit_status( CMD_SET_PID_KP_POS, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_PID_KP, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -720,6 +1825,9 @@ bool SERVO42C::set_pid_kp( uint16_t value ){
 //##################################################################
 bool SERVO42C::set_pid_ki( uint16_t value ){
     uint8_t status = send_16bit_status( CMD_SET_PID_KI_POS, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_PID_KI, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -736,6 +1844,9 @@ bool SERVO42C::set_pid_ki( uint16_t value ){
 //##################################################################
 bool SERVO42C::set_pid_kd( uint16_t value ){
     uint8_t status = send_16bit_status( CMD_SET_PID_KD_POS, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_PID_KD, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -752,6 +1863,9 @@ bool SERVO42C::set_pid_kd( uint16_t value ){
 //##################################################################
 bool SERVO42C::set_acc( uint16_t value ){
     uint8_t status = send_16bit_status( CMD_SET_ACCELERATION, value );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_ACC, value );
+    }
     return status == 1 ? true : false;
 }
 
@@ -768,6 +1882,9 @@ bool SERVO42C::set_acc( uint16_t value ){
 bool SERVO42C::set_max_torque( uint16_t torque ){
     if( torque > MAX_POS_TORQUE ){ torque = MAX_POS_TORQUE; }    
     uint8_t status = send_16bit_status( CMD_SET_MAX_TORQUE, torque );
+    if( status == 1 ){
+        remember_param( MKS_PARAM_MAX_TORQUE, torque );
+    }
     return status == 1 ? true : false;
 }
 
@@ -791,7 +1908,15 @@ bool SERVO42C::set_max_torque( uint16_t torque ){
 //##################################################################
 bool SERVO42C::set_enable( uint8_t value ){
     if( value > 1 ){ value = 1; }
+    lock_bus();
     uint8_t status = send_8bit_status( CMD_SET_ENABLE_STATE, value );
+    if( status == 1 && value == 1 && idle_mode == MKS_IDLE_DISABLE && idle_stats.idle ){
+        // enabled by the application, the axis is not idle anymore
+        idle_stats.idle       = false;
+        idle_stats.idle_time += millis() - idle_since;
+        last_motion           = millis();
+    }
+    unlock_bus();
     return status == 1 ? true : false;
 }
 
@@ -812,10 +1937,82 @@ bool SERVO42C::set_run_continuous( uint8_t dir, uint8_t speed ){
     if( speed > 127 ){ speed = 127; }
     speed &= 0x7F;
     uint8_t value = (dir==1 ? 0x80 : 0x00) | speed;
+    lock_bus();
+    if( check_continuous( dir, speed ) != MKS_LIMIT_OK ){
+        unlock_bus();
+        return false;
+    }
+    if( !wake_from_idle() ){
+        unlock_bus();
+        return false;
+    }
     uint8_t status = send_8bit_status( CMD_SET_RUN_CONTINUOUS, value );
+    if( status == 1 ){
+        running_continuous = speed > 0;
+        position_stale     = true;
+        set_motion_command( dir, speed, false );
+    }
+    unlock_bus();
     return status == 1 ? true : false;
 }
 
+//#########################################################################
+// Write a run continuous frame without waiting for the status
+// The 3 byte status frame has to be collected with read_async(). RX is
+// not drained so status frames of other axes on the bus are kept. Only
+// an idle axis is woken with a blocking transaction first, which drains
+// RX. Check needs_wake() while status frames are outstanding
+//#########################################################################
+bool SERVO42C::post_run_continuous( uint8_t dir, uint8_t speed ){
+    if( speed > 127 ){ speed = 127; }
+    speed &= 0x7F;
+    uint8_t hex_block_set[4] = {0};
+    get_8bit_hexblocks( CMD_SET_RUN_CONTINUOUS, (dir==1 ? 0x80 : 0x00) | speed, hex_block_set );
+    lock_bus();
+    // checked first so get_limit_error() tells a refused setpoint from
+    // a frame that couldn't be written
+    if( check_continuous( dir, speed ) != MKS_LIMIT_OK || is_unsupported( CMD_SET_RUN_CONTINUOUS ) ){
+        unlock_bus();
+        return false;
+    }
+    if( !wake_from_idle() ){
+        unlock_bus();
+        return false;
+    }
+    size_t written = write_frame( hex_block_set, 4 );
+    running_continuous = speed > 0;
+    position_stale     = true;
+    if( speed == 0 ){
+        last_motion = millis();
+    }
+    if( written == 4 ){
+        set_motion_command( dir, speed, false );
+    }
+    unlock_bus();
+    return written == 4;
+}
+
+//#########################################################################
+// Read whatever is in the RX buffer without waiting
+// returns the number of bytes copied into buffer
+//#########################################################################
+uint8_t SERVO42C::read_async( uint8_t *buffer, uint8_t max_length ){
+    uint8_t length = 0;
+    lock_bus();
+    while( length < max_length && _serial->available() > 0 ){
+        buffer[length++] = _serial->read();
+    }
+    if( capture != NULL && length > 0 ){
+        capture->record( true, buffer, length );
+    }
+    unlock_bus();
+    return length;
+}
+
+uint8_t SERVO42C::get_slave_address(){
+    return slave_address;
+}
+
 //#####################################################################
 // Save/Clear status
 // For continuous mode. Motor will start going after power is turned on
@@ -19,24 +19,283 @@
 #include "stdint.h"
 #include <string>
 #include <map>
+#include <atomic>
 #include <HardwareSerial.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "servo42c_capture.h"
 
 static const uint8_t  MKS_MAX_SEND_RETRIES       = 3;
 static const uint32_t MKS_WAIT_TIMEOUT           = 3000;
+static const uint32_t MKS_CALIBRATE_TIMEOUT      = 60000; // encoder calibration takes a lot longer than a normal command
+static const uint32_t MKS_PROBE_TIMEOUT          = 50;    // ms, a supported command answers in a few ms
+static const uint8_t  MKS_PROBE_RETRIES          = 3;     // attempts before a command counts as unsupported
 static const uint32_t MKS_DEFAULT_RECEIVE_LENGTH = 3;
+static const int64_t  MKS_SPEED_STEPS_PER_SECOND = 500;    // microsteps/s per speed unit, Vrpm = speed * 30000 / steps per revolution
+static const uint32_t MKS_PREDICT_HORIZON        = 500000; // us, confidence of a moving prediction reaches 0 after this
+
+//###############################################################
+// Latest telemetry values seen on the wire
+// Every successful getter call updates the matching field.
+// Read it with get_telemetry() without touching the bus
+//###############################################################
+struct servo42c_telemetry {
+    int64_t  encoder;      // unwrapped carrier * 65536 + value
+    int64_t  pulses;       // unwrapped pulses received
+    int16_t  angle_error;  // raw value, 0xFFFF = 360°
+    bool     enabled;      // enable pin state
+    bool     shaft_locked; // shaft lock protection state
+    uint32_t timestamp;    // millis() of the last update
+};
+
+//###############################################################
+// Absolute multi-turn position
+// encoder:         encoder counts, 65536 per revolution
+// steps:           encoder converted to microsteps with the
+//                  configured subdivision and motor type
+// pulses:          microsteps commanded (pulses received)
+// following_error: pulses minus steps, both counted from the
+//                  last set_following_reference(). Pulses are
+//                  counted against the encoder if motor_dir is 1
+//                  or the limits say encoder_inverted
+// following_valid: false until a reference was taken, the
+//                  following error is 0 then
+//###############################################################
+struct servo42c_position {
+    int64_t  encoder;
+    int64_t  steps;
+    int64_t  pulses;
+    int64_t  following_error;
+    bool     following_valid;
+    uint32_t timestamp;
+};
+
+//###############################################################
+// Idle power management
+// After idle_timeout ms without motion the current is reduced
+// or the driver is disabled. The encoder has to read the same
+// twice MKS_IDLE_SETTLE_TIME apart first. The next motion command
+// restores it before the motion frame is sent and fails if that
+// did not work
+//###############################################################
+#define MKS_IDLE_OFF             0
+#define MKS_IDLE_REDUCE_CURRENT  1
+#define MKS_IDLE_DISABLE         2
+
+static const uint32_t MKS_IDLE_SETTLE_TIME = 100; // ms
+
+struct servo42c_idle_stats {
+    bool     idle;          // axis is in idle state right now
+    uint32_t idle_entries;  // times the axis went idle
+    uint32_t wakeups;       // times a motion command restored it
+    uint32_t last_wake_us;  // latency the last wakeup added to the motion command
+    uint32_t max_wake_us;
+    uint32_t idle_time;     // ms spent idle in total
+};
+
+//###############################################################
+// Parameters applied to the drive
+// Every successful setter stores its value in the params of the
+// axis. The ids double as the order used to restore them
+// current is in mA, all other values are the setter arguments
+//###############################################################
+#define MKS_PARAM_WORK_MODE                  0
+#define MKS_PARAM_MOTOR_TYPE                 1
+#define MKS_PARAM_SUBDIVISION                2
+#define MKS_PARAM_SUBDIVISION_INTERPOLATION  3
+#define MKS_PARAM_CURRENT                    4
+#define MKS_PARAM_MAX_TORQUE                 5
+#define MKS_PARAM_PID_KP                     6
+#define MKS_PARAM_PID_KI                     7
+#define MKS_PARAM_PID_KD                     8
+#define MKS_PARAM_ACC                        9
+#define MKS_PARAM_ENABLE_MODE                10
+#define MKS_PARAM_MOTOR_DIR                  11
+#define MKS_PARAM_SCREEN_AUTO_OFF            12
+#define MKS_PARAM_SHAFT_LOCK_PROTECTION      13
+#define MKS_PARAM_ZERO_MODE                  14
+#define MKS_PARAM_ZERO_MODE_SPEED            15
+#define MKS_PARAM_ZERO_MODE_DIRECTION        16
+#define MKS_PARAM_BAUDRATE                   17
+#define MKS_PARAM_SLAVE_ADDRESS              18
+#define MKS_PARAM_COUNT                      19
+
+struct servo42c_params {
+    uint32_t valid; // bit n set = parameter n was applied
+    uint16_t value[MKS_PARAM_COUNT];
+};
+
+//###############################################################
+// Soft limits
+// Motion commands are checked against a tracked position in
+// microsteps before anything is sent. dir 0 counts positive.
+// The position is set with set_position_reference(), usually
+// after homing, and advanced by every accepted move. After a
+// stop or continuous run it is synced from the encoder before
+// the next move. Continuous runs have no end position, they are
+// refused in a direction with a finite limit while the limits are
+// on. encoder_inverted: encoder counts down for dir 0
+// max_speed: highest speed value for moves and continuous runs
+// Start from default_limits(), it has everything open
+//###############################################################
+#define MKS_LIMIT_OK            0
+#define MKS_LIMIT_BELOW_MIN     1
+#define MKS_LIMIT_ABOVE_MAX     2
+#define MKS_LIMIT_SPEED         3
+#define MKS_LIMIT_NO_REFERENCE  4 // limits are on but the position is unknown
+#define MKS_LIMIT_CONTINUOUS    5 // continuous run toward a finite limit
+
+struct servo42c_limits {
+    bool    enabled;
+    int64_t min_steps;
+    int64_t max_steps;
+    uint8_t max_speed;
+    bool    encoder_inverted;
+};
+
+//###############################################################
+// Capabilities found by probe_capabilities()
+// Probed are the reads plus two commands that are harmless at
+// standstill but do change the drive state: 0x3D releases a
+// tripped shaft lock protection, 0xF7 stops the motor. Commands
+// that didn't answer MKS_PROBE_RETRIES times fail at once
+// afterwards without touching the bus, except 0xF7 which is
+// always sent. Not probed commands are always sent. Probe again
+// after a firmware change or clear_capabilities() to send all
+//###############################################################
+#define MKS_CAP_ENCODER       0x0001 // 0x30
+#define MKS_CAP_PULSES        0x0002 // 0x33
+#define MKS_CAP_MOTOR_ANGLE   0x0004 // 0x36, not documented in the manual
+#define MKS_CAP_ANGLE_ERROR   0x0008 // 0x39
+#define MKS_CAP_ENABLE_STATE  0x0010 // 0x3A
+#define MKS_CAP_RELEASE_LOCK  0x0020 // 0x3D
+#define MKS_CAP_LOCK_STATE    0x0040 // 0x3E
+#define MKS_CAP_STOP          0x0080 // 0xF7
+
+//###############################################################
+// Position prediction
+// Extrapolates the last encoder sample to now without touching
+// the bus. The velocity comes from the last motion command, a
+// continuous run or the active move segment that stops at its
+// target. Without a command (goto zero, step/dir input) the
+// velocity measured between the last two samples is used.
+// Acceleration is not modeled, the error is largest right after
+// the speed changed
+// age_us:     time since the encoder sample it is based on
+// confidence: 0 - 100. Standing still it stays at 100, moving it
+//             drops to 0 over MKS_PREDICT_HORIZON. Halved while
+//             no sample was taken since the last command
+//###############################################################
+#define MKS_PREDICT_NONE        0 // no encoder sample yet
+#define MKS_PREDICT_STANDSTILL  1
+#define MKS_PREDICT_COMMANDED   2 // velocity from the last motion command
+#define MKS_PREDICT_MEASURED    3 // velocity from the last two samples
+
+struct servo42c_prediction {
+    int64_t  encoder;    // encoder counts now
+    int64_t  steps;      // encoder converted to microsteps
+    int32_t  velocity;   // encoder counts per second
+    uint32_t age_us;
+    uint8_t  confidence;
+    uint8_t  source;     // MKS_PREDICT_*
+};
+
+//###############################################################
+// Shared state of one UART, see servo42c.cpp
+//###############################################################
+struct servo42c_bus;
+
+//###############################################################
+// Inputs for read_input(), one read command each
+//###############################################################
+#define MKS_INPUT_ENCODER       0 // 0x30
+#define MKS_INPUT_PULSES        1 // 0x33
+#define MKS_INPUT_ANGLE_ERROR   2 // 0x39
+#define MKS_INPUT_ENABLE_STATE  3 // 0x3A
+#define MKS_INPUT_LOCK_STATE    4 // 0x3E
+#define MKS_INPUT_COUNT         5
 
 class SERVO42C {
 
     protected:
         uint16_t microsteps;
+        uint16_t full_steps; // full steps per revolution, 200 = 1.8°, 400 = 0.9°
 
 
     private:
 
         HardwareSerial *_serial;
-        bool locked;
+        SERVO42C_CAPTURE *capture;
+        SERVO42C_REPLAY  *replay;
+        servo42c_bus *bus;
         int slave_address;
 
+        // seqlock protecting the telemetry snapshot
+        // odd sequence = write in progress
+        std::atomic<uint32_t> telemetry_seq;
+        portMUX_TYPE          telemetry_mux;
+        servo42c_telemetry    telemetry;
+
+        // unwrap state for the 32bit carrier and pulse counters
+        // only touched inside a telemetry update
+        bool    encoder_seen;
+        int32_t last_carrier;
+        int64_t encoder_turns;
+        bool    pulses_seen;
+        int32_t last_pulses;
+
+        // idle management, guarded by the bus lock
+        uint16_t      applied_current;
+        uint8_t       idle_mode;
+        uint32_t      idle_timeout;
+        uint16_t      idle_current;
+        bool          running_continuous;
+        unsigned long last_motion;
+        unsigned long idle_since;
+        int64_t       idle_check_encoder;
+        unsigned long idle_check_time;
+        bool          idle_check_valid;   // idle_check_encoder was read after the last motion
+        servo42c_idle_stats idle_stats;
+
+        // applied parameters, guarded by the bus lock
+        servo42c_params params;
+
+        // soft limits, guarded by the bus lock
+        servo42c_limits limits;
+        bool     limit_override;
+        bool     position_referenced;
+        bool     position_stale;     // moved without tracking, sync before the next check
+        int64_t  limit_position;     // tracked position in microsteps
+        int64_t  reference_steps;    // position at the reference point
+        int64_t  reference_encoder;  // encoder at the reference point in microsteps
+        uint8_t  limit_error;
+        uint32_t limit_rejections;
+
+        // probed capabilities, one bit per command byte for the send check
+        bool     probed;
+        uint16_t capabilities;
+        uint8_t  unsupported[32];
+
+        // position prediction, guarded by motion_mux
+        // readers don't take the bus lock
+        portMUX_TYPE motion_mux;
+        uint8_t  sample_count;       // encoder samples seen, stops at 2
+        int64_t  sample_encoder;
+        uint32_t sample_us;          // micros() of the last sample
+        int32_t  measured_velocity;  // counts/s between the last two samples
+        bool     command_active;     // a motion command sets the velocity
+        bool     command_bounded;    // move segment, stops at command_target
+        int32_t  command_velocity;   // counts/s
+        int64_t  command_origin;     // predicted encoder when the command was accepted
+        int64_t  command_target;
+        uint32_t command_us;
+
+        // following error zero point, guarded by motion_mux
+        bool     following_referenced;
+        bool     following_inverted;
+        int64_t  following_pulses;
+        int64_t  following_steps;
+
         // could make those methods static..
         static uint8_t create_checksum( uint8_t *hex_blocks, int block_num );
         static uint8_t extract_status( const uint8_t response[] );
@@ -48,16 +307,41 @@ class SERVO42C {
         uint8_t send_16bit_status( uint8_t cmd, uint16_t value, uint8_t receive_length = MKS_DEFAULT_RECEIVE_LENGTH );
         uint8_t send_8bit_32bit_status( uint8_t cmd, uint8_t value_a, uint32_t value_b, uint8_t receive_length = MKS_DEFAULT_RECEIVE_LENGTH );
         uint8_t send_raw_cmd_status( uint8_t cmd, uint8_t receive_length = MKS_DEFAULT_RECEIVE_LENGTH );
-        int16_t send_raw_cmd_get_16bit( uint8_t cmd, uint8_t receive_length );
-        int32_t send_raw_cmd_get_32bit( uint8_t cmd, uint8_t receive_length );
+        bool    send_raw_cmd_get_16bit( uint8_t cmd, uint8_t receive_length, int16_t &value );
+        bool    send_raw_cmd_get_32bit( uint8_t cmd, uint8_t receive_length, int32_t &value );
+
+        bool    read_encoder( int64_t &encoder );
+        bool    read_pulses( int32_t &pulses );
+        bool    read_angle_error( int16_t &value );
+        uint8_t read_state( uint8_t cmd );
+
+        bool    send( uint8_t *hex_block_set, size_t hex_block_size, uint8_t *response, uint8_t receive_length = MKS_DEFAULT_RECEIVE_LENGTH, 
+                      uint8_t retries = MKS_MAX_SEND_RETRIES, uint32_t timeout = MKS_WAIT_TIMEOUT );
+        bool    receive( uint8_t* response, uint8_t receive_length = MKS_DEFAULT_RECEIVE_LENGTH, uint32_t timeout = MKS_WAIT_TIMEOUT );
+        size_t  write_frame( uint8_t *hex_block_set, size_t hex_block_size );
+        void    drain_rx( void );
+        unsigned long bus_millis( void );
+        void    expect_final_status( uint32_t timeout );
+        uint8_t take_final_status( void );
+
+        bool    wake_from_idle( void );
+        void    remember_param( uint8_t param, uint16_t value );
+        uint8_t check_limits( uint8_t dir, uint8_t speed, uint32_t steps );
+        uint8_t check_continuous( uint8_t dir, uint8_t speed );
+        bool    is_unsupported( uint8_t cmd );
+        void    record_sample( int64_t encoder, uint32_t time_us );
+        void    set_motion_command( uint8_t dir, uint8_t speed, bool bounded, uint32_t steps = 0 );
+        void    clear_motion_command( void );
 
-        bool    send( uint8_t *hex_block_set, size_t hex_block_size, uint8_t *response, uint8_t receive_length = MKS_DEFAULT_RECEIVE_LENGTH );
-        bool    receive( uint8_t* response, uint8_t receive_length = MKS_DEFAULT_RECEIVE_LENGTH );
+        void    begin_telemetry_update( void );
+        void    end_telemetry_update( void );
         
     public:
         SERVO42C();
         ~SERVO42C();
         bool    init( HardwareSerial &serial  );
+        void    set_capture( SERVO42C_CAPTURE *capture );
+        void    set_replay( SERVO42C_REPLAY *replay );
         bool    set_calibrate( void );
         bool    set_motor_type( uint8_t motor_type = 1 );
         bool    set_work_mode( uint8_t mode = 1 );
@@ -70,6 +354,7 @@ class SERVO42C {
         bool    set_subdivision_interpolation( uint8_t value = 1 );
         bool    set_baudrate( uint8_t value = 3 );
         bool    set_slave_address( uint8_t address_num = 0 );
+        bool    change_slave_address( uint8_t address_num = 0 );
         bool    set_restore_defaults( void );
         bool    set_zero_mode( uint8_t value = 0 );
         bool    set_zero_position( void );
@@ -86,12 +371,48 @@ class SERVO42C {
         bool    set_stop_motor( void );
         bool    set_save_clear_state( uint8_t value );
         bool    set_move_steps( uint8_t dir, uint8_t speed, uint32_t steps, bool blocking = true );
+        bool    post_run_continuous( uint8_t dir, uint8_t speed );
+        bool    post_calibrate( void );
+        void    wait_final_status( void );
+        uint8_t read_async( uint8_t *buffer, uint8_t max_length );
+        uint8_t get_slave_address( void );
+        void    lock_bus( void );
+        void    unlock_bus( void );
         bool    get_enable_state( void );
         bool    release_shaft_lock_protection( void );
         bool    get_shaft_lock_protection_state( void );
         int64_t get_encoder_value( void );
         int32_t get_pulses_received( void );
         float   get_shaft_angle_error( void );
+        void    get_telemetry( servo42c_telemetry &snapshot );
+        bool    read_input( uint8_t input );
+        void    set_idle_policy( uint32_t timeout_ms, uint8_t mode = MKS_IDLE_REDUCE_CURRENT, uint16_t idle_current_ma = 200 );
+        bool    poll_idle( void );
+        bool    needs_wake( void );
+        void    get_idle_stats( servo42c_idle_stats &stats );
+        bool    get_position( servo42c_position &position );
+        bool    set_following_reference( void );
+        void    get_cached_position( servo42c_position &position );
+        int64_t encoder_to_steps( int64_t encoder );
+        uint32_t get_steps_per_revolution( void );
+        void    get_params( servo42c_params &params );
+        bool    probe_capabilities( void );
+        bool    is_probed( void );
+        uint16_t get_capabilities( void );
+        void    clear_capabilities( void );
+        bool    is_command_supported( uint8_t cmd );
+        static servo42c_limits default_limits( void );
+        void    set_limits( const servo42c_limits &limits );
+        void    get_limits( servo42c_limits &limits );
+        void    set_limit_override( bool active );
+        bool    set_position_reference( int64_t steps = 0 );
+        bool    sync_position( void );
+        int64_t get_limit_position( void );
+        uint8_t check_move( uint8_t dir, uint8_t speed, uint32_t steps );
+        uint8_t get_limit_error( void );
+        uint32_t get_limit_rejections( void );
+        void    predict_position( servo42c_prediction &prediction );
+        int32_t speed_to_velocity( uint8_t dir, uint8_t speed );
 
 };
 
@@ -0,0 +1,261 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// PID auto tuning
+//
+// The 42C reports the angle error (target - actual) which is all 
+// that is needed to judge a step response. It is sampled as fast as
+// the bus allows while the test move runs. The encoder is only read
+// to confirm the axis reached the target
+//
+//####################################################################
+#include <Arduino.h>
+#include "servo42c_autotune.h"
+
+static const uint32_t MKS_AUTOTUNE_FAILED_COST = 0xFFFFFFFF;
+
+// first round spans 0.5x - 2x, later rounds get narrower
+static const float MKS_AUTOTUNE_WIDE[MKS_AUTOTUNE_CANDIDATES]   = { 0.5f, 0.7f, 1.0f, 1.4f, 2.0f };
+static const float MKS_AUTOTUNE_NARROW[MKS_AUTOTUNE_CANDIDATES] = { 0.8f, 0.9f, 1.0f, 1.1f, 1.25f };
+
+SERVO42C_AUTOTUNE::SERVO42C_AUTOTUNE() : servo( NULL ), experiments( 0 ) {
+    config = default_config();
+}
+
+servo42c_autotune_config SERVO42C_AUTOTUNE::default_config(){
+    servo42c_autotune_config config;
+    config.kp             = 1616;
+    config.ki             = 1;
+    config.kd             = 1616;
+    config.step           = 3200;
+    config.speed          = 40;
+    config.tolerance      = 91;   // ~0.5°
+    config.settle_samples = 5;
+    config.timeout        = 3000;
+    config.iterations     = 2;
+    return config;
+}
+
+void SERVO42C_AUTOTUNE::init( SERVO42C *_servo, const servo42c_autotune_config &_config ){
+    servo  = _servo;
+    config = _config;
+    if( config.settle_samples == 0 ){ config.settle_samples = 1; }
+}
+
+bool SERVO42C_AUTOTUNE::apply_gains( uint16_t kp, uint16_t ki, uint16_t kd ){
+    return servo->set_pid_kp( kp ) && servo->set_pid_ki( ki ) && servo->set_pid_kd( kd );
+}
+
+//#########################################################################
+// Wait until the angle error stayed within the tolerance for
+// settle_samples reads, the axis may still ring from the last move
+//#########################################################################
+bool SERVO42C_AUTOTUNE::wait_at_rest(){
+    servo42c_telemetry snapshot;
+    uint8_t in_tolerance = 0;
+    unsigned long start  = micros();
+    while( ( micros() - start ) < config.timeout * 1000UL ){
+        if( !servo->read_input( MKS_INPUT_ANGLE_ERROR ) ){
+            continue;
+        }
+        servo->get_telemetry( snapshot );
+        int16_t error = snapshot.angle_error;
+        if( ( error < 0 ? -error : error ) > config.tolerance ){
+            in_tolerance = 0;
+        } else if( ++in_tolerance >= config.settle_samples ){
+            return true;
+        }
+    }
+    return false;
+}
+
+//#########################################################################
+// Start a move and sample the angle error until it settled at the target
+// Which way the encoder counts for dir 0 depends on motor_dir and the
+// wiring, so the target is distance away from the start on either side
+// Failed reads are no samples
+//#########################################################################
+bool SERVO42C_AUTOTUNE::measure_move( uint8_t dir, servo42c_step_response &response ){
+    response = servo42c_step_response();
+    servo42c_telemetry snapshot;
+    if( !wait_at_rest() || !servo->read_input( MKS_INPUT_ENCODER ) ){
+        return false;
+    }
+    servo->get_telemetry( snapshot );
+    int64_t start_encoder = snapshot.encoder;
+    int64_t distance      = ( (int64_t)config.step << 16 ) / servo->get_steps_per_revolution();
+    int16_t first_sign    = 0;
+    uint8_t in_tolerance  = 0;
+    ++experiments;
+    unsigned long start = micros();
+    if( !servo->set_move_steps( dir, config.speed, config.step, false ) ){
+        return false;
+    }
+    while( ( micros() - start ) < config.timeout * 1000UL ){
+        if( !servo->read_input( MKS_INPUT_ANGLE_ERROR ) ){
+            continue;
+        }
+        servo->get_telemetry( snapshot );
+        int16_t  error     = snapshot.angle_error;
+        uint16_t abs_error = (uint16_t)( error < 0 ? -error : error );
+        ++response.samples;
+        response.iae += abs_error;
+        if( first_sign == 0 && abs_error > config.tolerance ){
+            first_sign = error < 0 ? -1 : 1;
+        } else if( first_sign != 0 && ( error < 0 ? -1 : 1 ) != first_sign && abs_error > response.overshoot ){
+            response.overshoot = abs_error;
+        }
+        if( abs_error > config.tolerance ){
+            in_tolerance = 0;
+            continue;
+        }
+        if( ++in_tolerance < config.settle_samples ){
+            continue;
+        }
+        // error is small, make sure it is not small because the move did not start yet
+        if( !servo->read_input( MKS_INPUT_ENCODER ) ){
+            in_tolerance = 0;
+            continue;
+        }
+        servo->get_telemetry( snapshot );
+        int64_t moved  = snapshot.encoder - start_encoder;
+        int64_t offset = ( moved < 0 ? -moved : moved ) - distance;
+        if( offset < 0 ){ offset = -offset; }
+        if( offset <= config.tolerance ){
+            response.settled     = true;
+            response.settle_time = micros() - start;
+            return true;
+        }
+        in_tolerance = 0;
+    }
+    servo->set_stop_motor();
+    return false;
+}
+
+bool SERVO42C_AUTOTUNE::step_response( uint16_t kp, uint16_t ki, uint16_t kd, servo42c_step_response &response ){
+    if( !apply_gains( kp, ki, kd ) ){
+        return false;
+    }
+    return measure_move( 0, response );
+}
+
+//#########################################################################
+// Average settle time of a forward and a backward move. The backward move
+// brings the axis back to where it started
+//#########################################################################
+uint32_t SERVO42C_AUTOTUNE::cost( uint16_t kp, uint16_t ki, uint16_t kd, servo42c_step_response &response ){
+    servo42c_step_response backward;
+    if( !apply_gains( kp, ki, kd ) ){
+        return MKS_AUTOTUNE_FAILED_COST;
+    }
+    bool forward_ok  = measure_move( 0, response );
+    bool backward_ok = measure_move( 1, backward );
+    if( !forward_ok || !backward_ok ){
+        return MKS_AUTOTUNE_FAILED_COST;
+    }
+    response.settle_time = ( response.settle_time + backward.settle_time ) / 2;
+    response.overshoot   = response.overshoot > backward.overshoot ? response.overshoot : backward.overshoot;
+    return response.settle_time;
+}
+
+//#########################################################################
+// Try kp or kd * factors, then fit a parabola through the best candidate
+// and its neighbours and try its minimum. Updates the gain and best_cost
+// if something better was found
+//#########################################################################
+void SERVO42C_AUTOTUNE::search( bool tune_kd, uint16_t &kp, uint16_t &kd, const float *factors, uint32_t &best_cost ){
+    uint16_t &gain  = tune_kd ? kd : kp;
+    uint16_t center = gain;
+    uint16_t values[MKS_AUTOTUNE_CANDIDATES];
+    uint32_t costs[MKS_AUTOTUNE_CANDIDATES];
+    uint8_t  best = 0;
+    servo42c_step_response response;
+    for( uint8_t i = 0; i < MKS_AUTOTUNE_CANDIDATES; ++i ){
+        float value = center * factors[i];
+        values[i] = value < 1.0f ? 1 : ( value > 65535.0f ? 65535 : (uint16_t)value );
+        gain      = values[i];
+        costs[i]  = values[i] == center && best_cost != MKS_AUTOTUNE_FAILED_COST ? best_cost : cost( kp, config.ki, kd, response );
+        if( costs[i] < costs[best] ){ best = i; }
+    }
+    gain = values[best];
+    if( costs[best] < best_cost ){
+        best_cost = costs[best];
+    } else {
+        gain = center;
+    }
+    if( best == 0 || best == MKS_AUTOTUNE_CANDIDATES - 1 || costs[best - 1] == MKS_AUTOTUNE_FAILED_COST || costs[best + 1] == MKS_AUTOTUNE_FAILED_COST ){
+        return;
+    }
+    // vertex of the parabola through the three points
+    float x0 = values[best - 1], x1 = values[best], x2 = values[best + 1];
+    float c0 = costs[best - 1],  c1 = costs[best],  c2 = costs[best + 1];
+    float denominator = ( x0 - x1 ) * ( x0 - x2 ) * ( x1 - x2 );
+    float a = ( x2 * ( c1 - c0 ) + x1 * ( c0 - c2 ) + x0 * ( c2 - c1 ) ) / denominator;
+    float b = ( x2 * x2 * ( c0 - c1 ) + x1 * x1 * ( c2 - c0 ) + x0 * x0 * ( c1 - c2 ) ) / denominator;
+    if( a <= 0.0f ){
+        return;
+    }
+    float vertex = -b / ( 2.0f * a );
+    if( vertex <= x0 || vertex >= x2 ){
+        return;
+    }
+    uint16_t fitted = (uint16_t)vertex;
+    if( fitted == values[best] ){
+        return;
+    }
+    uint16_t previous = gain;
+    gain = fitted;
+    uint32_t fitted_cost = cost( kp, config.ki, kd, response );
+    if( fitted_cost < best_cost ){
+        best_cost = fitted_cost;
+    } else {
+        gain = previous;
+    }
+}
+
+//#########################################################################
+// Run the tuning and write the best gains. If nothing settled the start
+// gains are written back and false is returned
+//#########################################################################
+bool SERVO42C_AUTOTUNE::run( servo42c_autotune_result &result ){
+    servo42c_step_response response;
+    experiments = 0;
+    result      = servo42c_autotune_result();
+    uint16_t kp = config.kp;
+    uint16_t kd = config.kd;
+    uint32_t best_cost = cost( kp, config.ki, kd, response );
+    result.initial_settle_time = best_cost;
+
+    for( uint8_t round = 0; round < config.iterations; ++round ){
+        const float *factors = round == 0 ? MKS_AUTOTUNE_WIDE : MKS_AUTOTUNE_NARROW;
+        search( false, kp, kd, factors, best_cost );
+        search( true, kp, kd, factors, best_cost );
+    }
+
+    result.success = best_cost != MKS_AUTOTUNE_FAILED_COST;
+    if( !result.success ){
+        kp = config.kp;
+        kd = config.kd;
+    }
+    // measure again with the final gains, this also writes them
+    cost( kp, config.ki, kd, response );
+    result.kp          = kp;
+    result.ki          = config.ki;
+    result.kd          = kd;
+    result.settle_time = best_cost;
+    result.overshoot   = response.overshoot;
+    result.experiments = experiments;
+    return result.success;
+}
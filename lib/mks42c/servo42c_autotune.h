@@ -0,0 +1,96 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_AUTOTUNE
+#define SERVO42C_MKS_AUTOTUNE
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c.h"
+
+static const uint8_t MKS_AUTOTUNE_CANDIDATES = 5;
+
+//###############################################################
+// Auto tune settings
+// kp, ki, kd:     start gains (library defaults 1616/1/1616)
+// step:           microsteps per test move, the axis moves
+//                 forward and back for every experiment
+// tolerance:      raw angle error / encoder counts that count
+//                 as settled, 65536 = 1 revolution
+// settle_samples: samples in a row within the tolerance
+// timeout:        ms per test move
+// iterations:     search rounds, every round narrows the range
+//###############################################################
+struct servo42c_autotune_config {
+    uint16_t kp;
+    uint16_t ki;
+    uint16_t kd;
+    uint32_t step;
+    uint8_t  speed;
+    uint16_t tolerance;
+    uint8_t  settle_samples;
+    uint32_t timeout;
+    uint8_t  iterations;
+};
+
+struct servo42c_step_response {
+    bool     settled;
+    uint32_t settle_time; // µs from the move command until settled
+    uint16_t overshoot;   // max raw angle error after the error changed sign
+    uint32_t iae;         // sum of the absolute angle error samples
+    uint16_t samples;
+};
+
+struct servo42c_autotune_result {
+    bool     success;
+    uint16_t kp;
+    uint16_t ki;
+    uint16_t kd;
+    uint32_t initial_settle_time; // µs with the start gains
+    uint32_t settle_time;         // µs with the tuned gains
+    uint16_t overshoot;
+    uint16_t experiments;
+};
+
+//###############################################################
+// Tunes kp and kd of one axis with step experiments
+// Each candidate gets a forward and a backward move, the cost is
+// the settle time. The best candidate and its neighbours are
+// fitted with a parabola to get the next guess
+// The axis needs room for step microsteps in forward direction
+//###############################################################
+class SERVO42C_AUTOTUNE {
+
+    private:
+
+        SERVO42C *servo;
+        servo42c_autotune_config config;
+        uint16_t  experiments;
+
+        bool     apply_gains( uint16_t kp, uint16_t ki, uint16_t kd );
+        bool     wait_at_rest( void );
+        bool     measure_move( uint8_t dir, servo42c_step_response &response );
+        uint32_t cost( uint16_t kp, uint16_t ki, uint16_t kd, servo42c_step_response &response );
+        void     search( bool tune_kd, uint16_t &kp, uint16_t &kd, const float *factors, uint32_t &best_cost );
+
+    public:
+        SERVO42C_AUTOTUNE();
+        static servo42c_autotune_config default_config( void );
+        void init( SERVO42C *servo, const servo42c_autotune_config &config = default_config() );
+        bool step_response( uint16_t kp, uint16_t ki, uint16_t kd, servo42c_step_response &response );
+        bool run( servo42c_autotune_result &result );
+
+};
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,184 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c_calibration.h"
+
+SERVO42C_CALIBRATION::SERVO42C_CALIBRATION() : num_axes( 0 ), timeout( MKS_CALIBRATE_TIMEOUT ), callback( NULL ), running( false ), start_time( 0 ) {
+    portMUX_INITIALIZE( &mux );
+}
+
+void SERVO42C_CALIBRATION::set_callback( servo42c_calibration_callback _callback ){
+    callback = _callback;
+}
+
+//#########################################################################
+// Start the job. Returns false if a job is still running or the task
+// could not be created. Returns immediately
+//#########################################################################
+bool SERVO42C_CALIBRATION::start( SERVO42C **_servos, uint8_t _num_axes, uint32_t timeout_ms ){
+    if( running || _num_axes == 0 || _num_axes > MKS_CALIBRATION_MAX_AXES ){
+        return false;
+    }
+    num_axes = _num_axes;
+    timeout  = timeout_ms;
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        servos[i]           = _servos[i];
+        results[i].state    = MKS_CALIBRATION_RUNNING;
+        results[i].duration = 0;
+    }
+    start_time = millis();
+    running    = true;
+    if( xTaskCreate( task, "mks_calibration", MKS_CALIBRATION_STACK, this, MKS_CALIBRATION_PRIORITY, NULL ) != pdPASS ){
+        running = false;
+        return false;
+    }
+    return true;
+}
+
+void SERVO42C_CALIBRATION::task( void *parameter ){
+    SERVO42C_CALIBRATION *job = static_cast<SERVO42C_CALIBRATION*>( parameter );
+    job->run();
+    vTaskDelete( NULL );
+}
+
+//#########################################################################
+// Job task. Sends all calibration frames and then reads status frames
+// (address, status, checksum) until every axis has a result or the
+// timeout expired. Status 0 means still calibrating and is skipped
+//#########################################################################
+void SERVO42C_CALIBRATION::run(){
+    SERVO42C *bus = servos[0];
+    uint8_t   buffer[32];
+    uint8_t   frame[3];
+    uint8_t   frame_length = 0;
+    uint8_t   pending      = 0;
+    bus->lock_bus();
+    // a final status of a move would count as failed calibration, it has
+    // to come in before the stale bytes are dropped
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        servos[i]->wait_final_status();
+    }
+    while( bus->read_async( buffer, sizeof( buffer ) ) > 0 ){} // stale bytes
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        if( servos[i]->post_calibrate() ){
+            ++pending;
+        } else {
+            finish( i, MKS_CALIBRATION_ERROR );
+        }
+    }
+    while( pending > 0 && ( millis() - start_time ) < timeout ){
+        uint8_t length = bus->read_async( buffer, sizeof( buffer ) );
+        for( uint8_t n = 0; n < length; ++n ){
+            frame[frame_length++] = buffer[n];
+            if( frame_length < 3 ){
+                continue;
+            }
+            if( (uint8_t)( frame[0] + frame[1] ) != frame[2] || frame[1] > 2 ){
+                // out of sync, drop the first byte
+                frame[0]     = frame[1];
+                frame[1]     = frame[2];
+                frame_length = 2;
+                continue;
+            }
+            frame_length = 0;
+            for( uint8_t i = 0; i < num_axes; ++i ){
+                if( frame[1] != 0 && results[i].state == MKS_CALIBRATION_RUNNING && servos[i]->get_slave_address() == frame[0] ){
+                    finish( i, frame[1] == 1 ? MKS_CALIBRATION_SUCCESS : MKS_CALIBRATION_FAILED );
+                    --pending;
+                    break;
+                }
+            }
+        }
+        if( length == 0 ){
+            vTaskDelay( MKS_CALIBRATION_POLL_DELAY / portTICK_PERIOD_MS );
+        }
+    }
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        if( results[i].state == MKS_CALIBRATION_RUNNING ){
+            finish( i, MKS_CALIBRATION_TIMED_OUT );
+        }
+    }
+    bus->unlock_bus();
+    running = false;
+}
+
+void SERVO42C_CALIBRATION::finish( uint8_t axis, uint8_t state ){
+    portENTER_CRITICAL( &mux );
+    results[axis].state    = state;
+    results[axis].duration = millis() - start_time;
+    servo42c_calibration_result result = results[axis];
+    portEXIT_CRITICAL( &mux );
+    if( callback != NULL ){
+        callback( servos[axis], result );
+    }
+}
+
+bool SERVO42C_CALIBRATION::is_running(){
+    return running;
+}
+
+//#########################################################################
+// Block the calling task until the job is done
+// returns false if it is still running after timeout_ms
+//#########################################################################
+bool SERVO42C_CALIBRATION::wait( uint32_t timeout_ms ){
+    unsigned long start = millis();
+    while( running ){
+        if( timeout_ms != portMAX_DELAY && ( millis() - start ) >= timeout_ms ){
+            return false;
+        }
+        vTaskDelay( MKS_CALIBRATION_POLL_DELAY / portTICK_PERIOD_MS );
+    }
+    return true;
+}
+
+//#########################################################################
+// Progress: axes with a result and ms since the job started
+//#########################################################################
+uint8_t SERVO42C_CALIBRATION::get_finished_count(){
+    uint8_t count = 0;
+    portENTER_CRITICAL( &mux );
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        if( results[i].state != MKS_CALIBRATION_RUNNING ){
+            ++count;
+        }
+    }
+    portEXIT_CRITICAL( &mux );
+    return count;
+}
+
+uint32_t SERVO42C_CALIBRATION::get_elapsed(){
+    return num_axes == 0 ? 0 : millis() - start_time;
+}
+
+bool SERVO42C_CALIBRATION::get_result( uint8_t axis, servo42c_calibration_result &result ){
+    if( axis >= num_axes ){
+        return false;
+    }
+    portENTER_CRITICAL( &mux );
+    result = results[axis];
+    portEXIT_CRITICAL( &mux );
+    return true;
+}
+
+bool SERVO42C_CALIBRATION::all_successful(){
+    if( running || num_axes == 0 ){
+        return false;
+    }
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        if( results[i].state != MKS_CALIBRATION_SUCCESS ){
+            return false;
+        }
+    }
+    return true;
+}
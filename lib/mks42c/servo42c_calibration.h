@@ -0,0 +1,86 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_CALIBRATION
+#define SERVO42C_MKS_CALIBRATION
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c.h"
+#include "freertos/task.h"
+
+static const uint8_t  MKS_CALIBRATION_MAX_AXES   = 10;
+static const uint32_t MKS_CALIBRATION_STACK      = 3072;
+static const uint8_t  MKS_CALIBRATION_PRIORITY   = 1;
+static const uint32_t MKS_CALIBRATION_POLL_DELAY = 20; // ms between RX checks
+
+#define MKS_CALIBRATION_IDLE       0
+#define MKS_CALIBRATION_RUNNING    1
+#define MKS_CALIBRATION_SUCCESS    2
+#define MKS_CALIBRATION_FAILED     3 // drive reported a failed calibration
+#define MKS_CALIBRATION_TIMED_OUT  4 // no result within the timeout
+#define MKS_CALIBRATION_ERROR      5 // frame could not be sent
+
+//###############################################################
+// Result of one axis
+// duration: ms from the start of the job until the result came in
+//###############################################################
+struct servo42c_calibration_result {
+    uint8_t  state;
+    uint32_t duration;
+};
+
+typedef void (*servo42c_calibration_callback)( SERVO42C *servo, const servo42c_calibration_result &result );
+
+//###############################################################
+// Encoder calibration job
+// Starts the calibration on all axes back to back and collects
+// the results in a background task, so the whole machine takes
+// one calibration time. All axes need to be on the same UART
+// with unique addresses. The bus is locked for the whole job,
+// other calls on the bus block until it is done.
+// The callback is called from the job task
+//###############################################################
+class SERVO42C_CALIBRATION {
+
+    private:
+
+        SERVO42C *servos[MKS_CALIBRATION_MAX_AXES];
+        uint8_t   num_axes;
+        uint32_t  timeout;
+        servo42c_calibration_callback callback;
+
+        volatile bool running;
+        unsigned long start_time;
+        portMUX_TYPE  mux;
+        servo42c_calibration_result results[MKS_CALIBRATION_MAX_AXES];
+
+        static void task( void *parameter );
+        void        run( void );
+        void        finish( uint8_t axis, uint8_t state );
+
+    public:
+        SERVO42C_CALIBRATION();
+        void    set_callback( servo42c_calibration_callback callback );
+        bool    start( SERVO42C **servos, uint8_t num_axes, uint32_t timeout_ms = MKS_CALIBRATE_TIMEOUT );
+        bool    is_running( void );
+        bool    wait( uint32_t timeout_ms = portMAX_DELAY );
+        uint8_t get_finished_count( void );
+        uint32_t get_elapsed( void );
+        bool    get_result( uint8_t axis, servo42c_calibration_result &result );
+        bool    all_successful( void );
+
+};
+
+
+#endif
\ No newline at end of file
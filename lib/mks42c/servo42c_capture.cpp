@@ -0,0 +1,283 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// Record / replay of the UART traffic
+//
+// Recording costs a byte copy per byte plus a few instructions per
+// frame so it can stay enabled. Pull the data out with read() from
+// a low priority task and store or send it somewhere
+//
+//####################################################################
+#include <Arduino.h>
+#include "servo42c_capture.h"
+
+SERVO42C_CAPTURE::SERVO42C_CAPTURE() : buffer( NULL ), size( 0 ), head( 0 ), tail( 0 ), dropped( 0 ), last_time( 0 ), enabled( false ) {}
+
+//#########################################################################
+// The buffer is provided by the caller. One byte stays unused to tell
+// a full buffer from an empty one
+//#########################################################################
+void SERVO42C_CAPTURE::init( uint8_t *_buffer, size_t _size ){
+    buffer    = _buffer;
+    size      = _size;
+    head.store( 0 );
+    tail.store( 0 );
+    dropped.store( 0 );
+    last_time = micros();
+    enabled.store( buffer != NULL && size > MKS_CAPTURE_MAX_RECORD, std::memory_order_release );
+}
+
+//#########################################################################
+// Can be called from any task. A record in progress is finished
+//#########################################################################
+void SERVO42C_CAPTURE::set_enabled( bool _enabled ){
+    enabled.store( _enabled && buffer != NULL && size > MKS_CAPTURE_MAX_RECORD, std::memory_order_release );
+}
+
+size_t SERVO42C_CAPTURE::write_header( uint8_t *out ){
+    out[0] = 'S';
+    out[1] = '4';
+    out[2] = '2';
+    out[3] = 'C';
+    out[4] = MKS_CAPTURE_VERSION;
+    return MKS_CAPTURE_HEADER_SIZE;
+}
+
+//#########################################################################
+// Add a record. Called from the transaction path
+//#########################################################################
+void SERVO42C_CAPTURE::record( bool rx, const uint8_t *data, size_t length ){
+    if( !enabled.load( std::memory_order_acquire ) ){
+        return;
+    }
+    if( length > MKS_CAPTURE_MAX_DATA ){ length = MKS_CAPTURE_MAX_DATA; }
+    uint32_t now   = micros();
+    uint32_t delta = now - last_time;
+    last_time      = now;
+
+    uint8_t record_header[6];
+    size_t  header_length = 0;
+    record_header[header_length++] = ( rx ? MKS_CAPTURE_DIR_RX : 0x00 ) | (uint8_t)length;
+    do {
+        uint8_t byte = delta & 0x7F;
+        delta >>= 7;
+        record_header[header_length++] = delta ? ( byte | 0x80 ) : byte;
+    } while( delta );
+
+    size_t write_pos = head.load( std::memory_order_relaxed );
+    size_t read_pos  = tail.load( std::memory_order_acquire );
+    size_t used      = write_pos >= read_pos ? write_pos - read_pos : size - read_pos + write_pos;
+    if( used + header_length + length >= size ){
+        dropped.fetch_add( 1, std::memory_order_relaxed );
+        return;
+    }
+    for( size_t i = 0; i < header_length; ++i ){
+        buffer[write_pos] = record_header[i];
+        if( ++write_pos == size ){ write_pos = 0; }
+    }
+    for( size_t i = 0; i < length; ++i ){
+        buffer[write_pos] = data[i];
+        if( ++write_pos == size ){ write_pos = 0; }
+    }
+    head.store( write_pos, std::memory_order_release );
+}
+
+size_t SERVO42C_CAPTURE::available(){
+    size_t write_pos = head.load( std::memory_order_acquire );
+    size_t read_pos  = tail.load( std::memory_order_relaxed );
+    return write_pos >= read_pos ? write_pos - read_pos : size - read_pos + write_pos;
+}
+
+//#########################################################################
+// Copy captured bytes out. Records can be split across calls, the
+// stream stays valid if the chunks are stored back to back
+//#########################################################################
+size_t SERVO42C_CAPTURE::read( uint8_t *out, size_t max_length ){
+    size_t write_pos = head.load( std::memory_order_acquire );
+    size_t read_pos  = tail.load( std::memory_order_relaxed );
+    size_t count     = 0;
+    while( read_pos != write_pos && count < max_length ){
+        out[count++] = buffer[read_pos];
+        if( ++read_pos == size ){ read_pos = 0; }
+    }
+    tail.store( read_pos, std::memory_order_release );
+    return count;
+}
+
+uint32_t SERVO42C_CAPTURE::get_dropped(){
+    return dropped.load( std::memory_order_relaxed );
+}
+
+
+
+
+//#########################################################################
+// Replay
+// The UART number is not used, begin() is never called on it
+//#########################################################################
+SERVO42C_REPLAY::SERVO42C_REPLAY( const uint8_t *capture, size_t capture_length ) : HardwareSerial( 0 ), data( capture ), length( capture_length ) {
+    rewind();
+}
+
+void SERVO42C_REPLAY::rewind(){
+    position    = 0;
+    rx_data     = NULL;
+    rx_length   = 0;
+    rx_position = 0;
+    start_time  = 0;
+    record_us   = 0;
+    clock_us    = 0;
+    stats       = servo42c_replay_stats();
+    if( length >= MKS_CAPTURE_HEADER_SIZE && data[0] == 'S' && data[1] == '4' && data[2] == '2' && data[3] == 'C' ){
+        position = MKS_CAPTURE_HEADER_SIZE;
+    }
+}
+
+void SERVO42C_REPLAY::get_stats( servo42c_replay_stats &_stats ){
+    _stats = stats;
+}
+
+//#########################################################################
+// Replay time in ms. It only moves with the records the driver takes
+// and when the driver waits for bytes that were never recorded
+//#########################################################################
+uint32_t SERVO42C_REPLAY::get_millis(){
+    return (uint32_t)( clock_us / 1000 );
+}
+
+//#########################################################################
+// Parse the next record. Bytes are handed out in the order the driver
+// writes and reads, the timestamps only feed the replay clock
+//#########################################################################
+bool SERVO42C_REPLAY::next_record( bool &rx, const uint8_t *&record_data, size_t &record_length ){
+    if( position >= length ){
+        return false;
+    }
+    uint8_t  flags = data[position++];
+    uint64_t delta = 0;
+    uint8_t  shift = 0;
+    while( position < length ){
+        uint8_t byte = data[position++];
+        if( shift < 64 ){ delta |= (uint64_t)( byte & 0x7F ) << shift; }
+        shift += 7;
+        if( !( byte & 0x80 ) ){ break; }
+    }
+    record_us += delta;
+    rx            = ( flags & MKS_CAPTURE_DIR_RX ) != 0;
+    record_length = flags & MKS_CAPTURE_MAX_DATA;
+    record_data   = data + position;
+    if( position + record_length > length ){
+        position = length;
+        return false;
+    }
+    position += record_length;
+    return true;
+}
+
+//#########################################################################
+// Load the next record if it is a RX record. Every receive() call of the
+// driver produced one, so a blocking move can have multiple in a row
+//#########################################################################
+bool SERVO42C_REPLAY::load_rx(){
+    size_t   saved    = position;
+    uint64_t saved_us = record_us;
+    bool rx = false;
+    const uint8_t *record_data;
+    size_t record_length;
+    if( next_record( rx, record_data, record_length ) && rx ){
+        rx_data     = record_data;
+        rx_length   = record_length;
+        rx_position = 0;
+        return true;
+    }
+    position  = saved;
+    record_us = saved_us;
+    check_finished();
+    return false;
+}
+
+void SERVO42C_REPLAY::check_finished(){
+    if( position >= length && rx_position >= rx_length && !stats.finished && stats.tx_frames > 0 ){
+        stats.finished   = true;
+        stats.elapsed_us = micros() - start_time;
+    }
+}
+
+//#########################################################################
+// The driver waits but the capture has nothing more to read before the
+// next write. The recorded driver waited until that write, so the clock
+// jumps there. At the end of the capture it moves in 1 ms steps
+//#########################################################################
+void SERVO42C_REPLAY::advance_clock(){
+    size_t   saved    = position;
+    uint64_t saved_us = record_us;
+    bool rx;
+    const uint8_t *record_data;
+    size_t record_length;
+    uint64_t next_us = clock_us + 1000;
+    if( next_record( rx, record_data, record_length ) && record_us > next_us ){
+        next_us = record_us;
+    }
+    position  = saved;
+    record_us = saved_us;
+    clock_us  = next_us;
+}
+
+size_t SERVO42C_REPLAY::write( uint8_t value ){
+    return write( &value, 1 );
+}
+
+size_t SERVO42C_REPLAY::write( const uint8_t *buffer, size_t size ){
+    if( stats.tx_frames++ == 0 ){
+        start_time = micros();
+    }
+    bool rx = true;
+    const uint8_t *record_data = NULL;
+    size_t record_length = 0;
+    // skip RX bytes the driver did not read before it sent again
+    rx_position = rx_length;
+    while( rx && next_record( rx, record_data, record_length ) ){}
+    if( rx || record_length != size || memcmp( record_data, buffer, size ) != 0 ){
+        ++stats.tx_mismatch;
+    }
+    if( record_us > clock_us ){
+        clock_us = record_us;
+    }
+    return size;
+}
+
+int SERVO42C_REPLAY::available(){
+    if( rx_position >= rx_length && !load_rx() ){
+        advance_clock();
+        return 0;
+    }
+    return (int)( rx_length - rx_position );
+}
+
+int SERVO42C_REPLAY::peek(){
+    return available() > 0 ? rx_data[rx_position] : -1;
+}
+
+int SERVO42C_REPLAY::read(){
+    if( available() <= 0 ){
+        return -1;
+    }
+    ++stats.rx_bytes;
+    int value = rx_data[rx_position++];
+    check_finished();
+    return value;
+}
+
+void SERVO42C_REPLAY::flush(){}
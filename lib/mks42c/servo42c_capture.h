@@ -0,0 +1,123 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_CAPTURE
+#define SERVO42C_MKS_CAPTURE
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "stdint.h"
+#include <atomic>
+#include <HardwareSerial.h>
+
+//###############################################################
+// Capture format
+//
+// File header: "S42C" + version byte
+// Record:      flags, timestamp delta, data
+//   flags:     bit 7 = direction (0 = TX, 1 = RX), bit 0-6 = length
+//   timestamp: µs since the previous record as LEB128 varint
+//   data:      length bytes as seen on the wire
+//
+// A record is at most 1 + 5 + 127 bytes
+//###############################################################
+static const uint8_t MKS_CAPTURE_VERSION     = 1;
+static const uint8_t MKS_CAPTURE_HEADER_SIZE = 5;
+static const uint8_t MKS_CAPTURE_DIR_RX      = 0x80;
+static const uint8_t MKS_CAPTURE_MAX_DATA    = 0x7F;
+static const uint8_t MKS_CAPTURE_MAX_RECORD  = 1 + 5 + MKS_CAPTURE_MAX_DATA;
+
+//###############################################################
+// Lock free single producer / single consumer ring buffer
+// The driver records while holding the bus lock so all drivers
+// on one bus can share one capture. read() can run in any other
+// task. Records that don't fit are dropped and counted
+//###############################################################
+class SERVO42C_CAPTURE {
+
+    private:
+
+        uint8_t *buffer;
+        size_t   size;
+        std::atomic<size_t>   head;    // write position
+        std::atomic<size_t>   tail;    // read position
+        std::atomic<uint32_t> dropped;
+        uint32_t last_time;
+        std::atomic<bool>     enabled;
+
+    public:
+        SERVO42C_CAPTURE();
+        void   init( uint8_t *buffer, size_t size );
+        void   set_enabled( bool enabled );
+        void   record( bool rx, const uint8_t *data, size_t length );
+        size_t read( uint8_t *out, size_t max_length );
+        size_t available( void );
+        uint32_t get_dropped( void );
+        static size_t write_header( uint8_t *out );
+
+};
+
+struct servo42c_replay_stats {
+    uint32_t tx_frames;    // frames written by the driver
+    uint32_t tx_mismatch;  // frames that differ from the capture
+    uint32_t rx_bytes;     // bytes served to the driver
+    uint32_t elapsed_us;   // µs from the first write to the end of the capture
+    bool     finished;
+};
+
+//###############################################################
+// Feeds a capture back into a SERVO42C
+// Pass it to SERVO42C::init() instead of the UART and run the same
+// calls again. RX records are only handed out up to the next TX
+// record, so the driver sees the same bytes in the same order
+// no matter how fast it runs. Pass it to SERVO42C::set_replay()
+// too and receive() times out on the recorded time: a wait
+// with nothing left to read jumps to the time of the next record
+//###############################################################
+class SERVO42C_REPLAY : public HardwareSerial {
+
+    private:
+
+        const uint8_t *data;
+        size_t         length;
+        size_t         position;
+        const uint8_t *rx_data;
+        size_t         rx_length;
+        size_t         rx_position;
+        unsigned long  start_time;
+        uint64_t       record_us;  // recorded time of the record at position
+        uint64_t       clock_us;   // time seen by the driver
+        servo42c_replay_stats stats;
+
+        bool   next_record( bool &rx, const uint8_t *&record_data, size_t &record_length );
+        bool   load_rx( void );
+        void   advance_clock( void );
+        void   check_finished( void );
+
+    public:
+        SERVO42C_REPLAY( const uint8_t *capture, size_t capture_length );
+        void   rewind( void );
+        void   get_stats( servo42c_replay_stats &stats );
+        uint32_t get_millis( void );
+
+        int    available( void );
+        int    peek( void );
+        int    read( void );
+        void   flush( void );
+        size_t write( uint8_t value );
+        size_t write( const uint8_t *buffer, size_t size );
+
+};
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,403 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c_driver.h"
+
+SERVO42C_DRIVER::SERVO42C_DRIVER() : num_axes( 0 ), commands( NULL ), responses( NULL ), task_handle( NULL ), running( false ), stop_request( false ), stats() {
+    portMUX_INITIALIZE( &mux );
+}
+
+servo42c_driver_config SERVO42C_DRIVER::default_config(){
+    servo42c_driver_config config;
+    config.period       = 10;
+    config.priority     = configMAX_PRIORITIES - 2;
+    config.stack_size   = 4096;
+    config.queue_length = 16;
+    config.max_commands = 4;
+    return config;
+}
+
+bool SERVO42C_DRIVER::init( SERVO42C **_axes, uint8_t _num_axes, const servo42c_driver_config &_config ){
+    if( running || _num_axes > MKS_DRIVER_MAX_AXES || _config.period == 0 ){
+        return false;
+    }
+    num_axes = _num_axes;
+    config   = _config;
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        axes[i]          = _axes[i];
+        io[i]            = servo42c_driver_io();
+        outputs[i]       = servo42c_image_outputs();
+        output_status[i] = servo42c_image_status();
+        output_set[i]    = 0;
+        input_valid[i]   = 0;
+        input_seen[i]    = 0;
+        memset( write_attempts[i], 0, sizeof( write_attempts[i] ) );
+    }
+    if( commands == NULL ){
+        commands  = xQueueCreate( config.queue_length, sizeof( servo42c_driver_command ) );
+        responses = xQueueCreate( config.queue_length, sizeof( servo42c_driver_response ) );
+    }
+    return commands != NULL && responses != NULL;
+}
+
+//#########################################################################
+// Change the input divisors of an axis. Takes effect in the next cycle
+//#########################################################################
+bool SERVO42C_DRIVER::set_io( uint8_t axis, const servo42c_driver_io &_io ){
+    if( axis >= num_axes ){
+        return false;
+    }
+    portENTER_CRITICAL( &mux );
+    io[axis] = _io;
+    portEXIT_CRITICAL( &mux );
+    return true;
+}
+
+bool SERVO42C_DRIVER::read_inputs( uint8_t axis, servo42c_telemetry &inputs ){
+    if( axis >= num_axes ){
+        return false;
+    }
+    axes[axis]->get_telemetry( inputs );
+    return true;
+}
+
+bool SERVO42C_DRIVER::get_input_state( uint8_t axis, servo42c_image_input_state &state ){
+    if( axis >= num_axes ){
+        return false;
+    }
+    unsigned long now = millis();
+    portENTER_CRITICAL( &mux );
+    state.valid = input_valid[axis];
+    for( uint8_t n = 0; n < MKS_INPUT_COUNT; ++n ){
+        state.age[n] = ( input_seen[axis] & ( 1 << n ) ) ? now - input_time[axis][n] : UINT32_MAX;
+    }
+    portEXIT_CRITICAL( &mux );
+    return true;
+}
+
+//#########################################################################
+// Output image. Only sets the value and the dirty bit if it changed or
+// the last value was dropped after failed writes
+//#########################################################################
+bool SERVO42C_DRIVER::write_enable( uint8_t axis, uint8_t enable ){
+    if( axis >= num_axes ){
+        return false;
+    }
+    enable = enable ? 1 : 0;
+    portENTER_CRITICAL( &mux );
+    if( outputs[axis].enable != enable || !( output_set[axis] & MKS_IMAGE_OUT_ENABLE ) || ( output_status[axis].failed & MKS_IMAGE_OUT_ENABLE ) ){
+        outputs[axis].enable        = enable;
+        output_status[axis].dirty  |= MKS_IMAGE_OUT_ENABLE;
+        output_set[axis]           |= MKS_IMAGE_OUT_ENABLE;
+        output_status[axis].failed &= ~MKS_IMAGE_OUT_ENABLE;
+        write_attempts[axis][0]     = 0;
+    }
+    portEXIT_CRITICAL( &mux );
+    return true;
+}
+
+bool SERVO42C_DRIVER::write_target( uint8_t axis, int64_t target, uint8_t speed ){
+    if( axis >= num_axes ){
+        return false;
+    }
+    portENTER_CRITICAL( &mux );
+    if( outputs[axis].target != target || outputs[axis].target_speed != speed || !( output_set[axis] & MKS_IMAGE_OUT_TARGET ) || ( output_status[axis].failed & MKS_IMAGE_OUT_TARGET ) ){
+        outputs[axis].target        = target;
+        outputs[axis].target_speed  = speed;
+        output_status[axis].dirty  |= MKS_IMAGE_OUT_TARGET;
+        output_set[axis]           |= MKS_IMAGE_OUT_TARGET;
+        output_status[axis].failed &= ~MKS_IMAGE_OUT_TARGET;
+        write_attempts[axis][1]     = 0;
+    }
+    portEXIT_CRITICAL( &mux );
+    return true;
+}
+
+bool SERVO42C_DRIVER::write_speed( uint8_t axis, uint8_t dir, uint8_t speed ){
+    if( axis >= num_axes ){
+        return false;
+    }
+    dir = dir ? 1 : 0;
+    portENTER_CRITICAL( &mux );
+    if( outputs[axis].dir != dir || outputs[axis].speed != speed || !( output_set[axis] & MKS_IMAGE_OUT_SPEED ) || ( output_status[axis].failed & MKS_IMAGE_OUT_SPEED ) ){
+        outputs[axis].dir           = dir;
+        outputs[axis].speed         = speed;
+        output_status[axis].dirty  |= MKS_IMAGE_OUT_SPEED;
+        output_set[axis]           |= MKS_IMAGE_OUT_SPEED;
+        output_status[axis].failed &= ~MKS_IMAGE_OUT_SPEED;
+        write_attempts[axis][2]     = 0;
+    }
+    portEXIT_CRITICAL( &mux );
+    return true;
+}
+
+bool SERVO42C_DRIVER::get_output_status( uint8_t axis, servo42c_image_status &status ){
+    if( axis >= num_axes ){
+        return false;
+    }
+    portENTER_CRITICAL( &mux );
+    status = output_status[axis];
+    portEXIT_CRITICAL( &mux );
+    return true;
+}
+
+bool SERVO42C_DRIVER::start(){
+    if( running || commands == NULL ){
+        return false;
+    }
+    stop_request = false;
+    running      = true;
+    if( xTaskCreate( task, "mks_driver", config.stack_size, this, config.priority, &task_handle ) != pdPASS ){
+        running = false;
+        return false;
+    }
+    return true;
+}
+
+//#########################################################################
+// Ends the task after the current cycle and waits for it
+//#########################################################################
+void SERVO42C_DRIVER::stop(){
+    stop_request = true;
+    while( running ){
+        vTaskDelay( config.period / portTICK_PERIOD_MS + 1 );
+    }
+}
+
+bool SERVO42C_DRIVER::is_running(){
+    return running;
+}
+
+//#########################################################################
+// Mailboxes. Safe to use from any task
+//#########################################################################
+bool SERVO42C_DRIVER::post( const servo42c_driver_command &command, TickType_t wait ){
+    return commands != NULL && xQueueSend( commands, &command, wait ) == pdTRUE;
+}
+
+bool SERVO42C_DRIVER::get_response( servo42c_driver_response &response, TickType_t wait ){
+    return responses != NULL && xQueueReceive( responses, &response, wait ) == pdTRUE;
+}
+
+void SERVO42C_DRIVER::task( void *parameter ){
+    SERVO42C_DRIVER *driver = static_cast<SERVO42C_DRIVER*>( parameter );
+    driver->run();
+    vTaskDelete( NULL );
+}
+
+//#########################################################################
+// Fixed period loop. vTaskDelayUntil keeps the period independent of the
+// cycle time. After an overrun it returns at once until the schedule
+// caught up, the jitter of those cycles shows up in the stats
+//#########################################################################
+void SERVO42C_DRIVER::run(){
+    TickType_t    last_wake  = xTaskGetTickCount();
+    unsigned long last_start = micros();
+    uint32_t      period_us  = config.period * 1000UL;
+    uint32_t      count      = 0;
+    while( !stop_request ){
+        unsigned long start    = micros();
+        uint32_t      interval = start - last_start;
+        uint32_t      jitter   = interval > period_us ? interval - period_us : period_us - interval;
+        last_start = start;
+        cycle( count++ );
+        uint32_t cycle_us = micros() - start;
+        portENTER_CRITICAL( &mux );
+        if( stats.cycles > 0 ){
+            // the first cycle has no previous start
+            stats.last_jitter_us = jitter;
+            stats.avg_jitter_us  = stats.cycles == 1 ? jitter : stats.avg_jitter_us - ( stats.avg_jitter_us >> 4 ) + ( jitter >> 4 );
+            if( jitter > stats.max_jitter_us ){ stats.max_jitter_us = jitter; }
+        }
+        ++stats.cycles;
+        stats.last_cycle_us = cycle_us;
+        if( cycle_us > stats.max_cycle_us ){ stats.max_cycle_us = cycle_us; }
+        if( cycle_us > period_us ){ ++stats.overruns; }
+        portEXIT_CRITICAL( &mux );
+        vTaskDelayUntil( &last_wake, config.period / portTICK_PERIOD_MS );
+    }
+    running = false;
+}
+
+//#########################################################################
+// One cycle: inputs, dirty outputs, then queued commands
+//#########################################################################
+void SERVO42C_DRIVER::cycle( uint32_t count ){
+    update_inputs( count );
+    write_outputs();
+    servo42c_driver_command command;
+    uint8_t executed = 0;
+    while( executed < config.max_commands && xQueueReceive( commands, &command, 0 ) == pdTRUE ){
+        execute( command );
+        ++executed;
+    }
+    portENTER_CRITICAL( &mux );
+    stats.commands += executed;
+    portEXIT_CRITICAL( &mux );
+}
+
+static inline bool input_due( uint8_t divisor, uint32_t count ){
+    return divisor != 0 && ( count % divisor ) == 0;
+}
+
+void SERVO42C_DRIVER::update_inputs( uint32_t count ){
+    static const uint8_t inputs[] = { MKS_INPUT_ENCODER, MKS_INPUT_PULSES, MKS_INPUT_ANGLE_ERROR, MKS_INPUT_ENABLE_STATE, MKS_INPUT_LOCK_STATE };
+    uint32_t errors = 0;
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        portENTER_CRITICAL( &mux );
+        servo42c_driver_io axis_io = io[i];
+        portEXIT_CRITICAL( &mux );
+        const uint8_t divisors[] = { axis_io.encoder, axis_io.pulses, axis_io.angle_error, axis_io.enable, axis_io.lock };
+        SERVO42C *servo = axes[i];
+        for( uint8_t n = 0; n < sizeof( inputs ); ++n ){
+            if( !input_due( divisors[n], count ) ){
+                continue;
+            }
+            bool          success = servo->read_input( inputs[n] );
+            unsigned long now     = millis();
+            uint8_t       bit     = 1 << inputs[n];
+            portENTER_CRITICAL( &mux );
+            if( success ){
+                input_valid[i]          |= bit;
+                input_seen[i]           |= bit;
+                input_time[i][inputs[n]] = now;
+            } else {
+                input_valid[i] &= ~bit;
+            }
+            portEXIT_CRITICAL( &mux );
+            errors += success ? 0 : 1;
+        }
+        if( axis_io.poll_idle ){ servo->poll_idle(); }
+    }
+    portENTER_CRITICAL( &mux );
+    stats.read_errors += errors;
+    portEXIT_CRITICAL( &mux );
+}
+
+//#########################################################################
+// Send the dirty outputs. The values are copied first so the
+// application can keep writing while the frames are on the wire. A
+// field written again meanwhile stays dirty. A failed write is sent
+// again next cycle until MKS_DRIVER_MAX_WRITE_ATTEMPTS, so a drive that
+// is gone doesn't cost a full timeout every cycle forever
+//#########################################################################
+void SERVO42C_DRIVER::write_outputs(){
+    static const uint8_t fields[] = { MKS_IMAGE_OUT_ENABLE, MKS_IMAGE_OUT_TARGET, MKS_IMAGE_OUT_SPEED };
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        portENTER_CRITICAL( &mux );
+        uint8_t                dirty  = output_status[i].dirty;
+        servo42c_image_outputs values = outputs[i];
+        output_status[i].dirty = 0;
+        portEXIT_CRITICAL( &mux );
+        for( uint8_t f = 0; f < sizeof( fields ); ++f ){
+            if( !( dirty & fields[f] ) ){
+                continue;
+            }
+            bool    success     = write_output( i, fields[f], values );
+            uint8_t limit_error = axes[i]->get_limit_error();
+            portENTER_CRITICAL( &mux );
+            ++output_status[i].writes;
+            ++stats.writes;
+            if( success ){
+                write_attempts[i][f] = 0;
+            } else {
+                ++output_status[i].write_errors;
+                if( fields[f] != MKS_IMAGE_OUT_ENABLE && limit_error != MKS_LIMIT_OK ){
+                    output_status[i].limit_error = limit_error;
+                } else if( ( output_status[i].dirty & fields[f] ) == 0 ){
+                    // not written again meanwhile
+                    if( ++write_attempts[i][f] < MKS_DRIVER_MAX_WRITE_ATTEMPTS ){
+                        output_status[i].dirty |= fields[f];
+                    } else {
+                        output_status[i].failed |= fields[f];
+                        write_attempts[i][f]     = 0;
+                    }
+                }
+            }
+            portEXIT_CRITICAL( &mux );
+        }
+    }
+}
+
+bool SERVO42C_DRIVER::write_output( uint8_t axis, uint8_t field, const servo42c_image_outputs &values ){
+    SERVO42C *servo = axes[axis];
+    switch( field ){
+        case MKS_IMAGE_OUT_ENABLE:
+            return servo->set_enable( values.enable );
+        case MKS_IMAGE_OUT_TARGET: {
+            int64_t delta = values.target - servo->get_limit_position();
+            if( delta == 0 ){
+                return true;
+            }
+            uint8_t dir = delta < 0 ? 1 : 0;
+            return servo->set_move_steps( dir, values.target_speed, (uint32_t)( delta < 0 ? -delta : delta ), false );
+        }
+        case MKS_IMAGE_OUT_SPEED:
+            return servo->set_run_continuous( values.dir, values.speed );
+    }
+    return false;
+}
+
+void SERVO42C_DRIVER::execute( const servo42c_driver_command &command ){
+    servo42c_driver_response response;
+    response.tag         = command.tag;
+    response.axis        = command.axis;
+    response.op          = command.op;
+    response.success     = false;
+    response.limit_error = MKS_LIMIT_OK;
+    if( command.axis < num_axes ){
+        SERVO42C *servo = axes[command.axis];
+        switch( command.op ){
+            case MKS_DRIVER_CMD_MOVE_STEPS:
+                response.success     = servo->set_move_steps( command.dir, command.speed, command.value, false );
+                response.limit_error = servo->get_limit_error();
+                break;
+            case MKS_DRIVER_CMD_RUN_CONTINUOUS:
+                response.success     = servo->set_run_continuous( command.dir, command.speed );
+                response.limit_error = servo->get_limit_error();
+                break;
+            case MKS_DRIVER_CMD_STOP:
+                response.success = servo->set_stop_motor();
+                break;
+            case MKS_DRIVER_CMD_ENABLE:
+                response.success = servo->set_enable( command.value );
+                break;
+            case MKS_DRIVER_CMD_SET_CURRENT:
+                response.success = servo->set_max_current( command.value );
+                break;
+            case MKS_DRIVER_CMD_RELEASE_LOCK:
+                response.success = servo->release_shaft_lock_protection();
+                break;
+            case MKS_DRIVER_CMD_GOTO_ZERO:
+                response.success = servo->set_goto_zero();
+                break;
+        }
+    }
+    if( command.tag != 0 && xQueueSend( responses, &response, 0 ) != pdTRUE ){
+        portENTER_CRITICAL( &mux );
+        ++stats.lost_responses;
+        portEXIT_CRITICAL( &mux );
+    }
+}
+
+void SERVO42C_DRIVER::get_stats( servo42c_driver_stats &_stats ){
+    portENTER_CRITICAL( &mux );
+    _stats = stats;
+    portEXIT_CRITICAL( &mux );
+}
+
+void SERVO42C_DRIVER::reset_stats(){
+    portENTER_CRITICAL( &mux );
+    stats = servo42c_driver_stats();
+    portEXIT_CRITICAL( &mux );
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_DRIVER
+#define SERVO42C_MKS_DRIVER
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+static const uint8_t MKS_DRIVER_MAX_AXES          = 10;
+static const uint8_t MKS_DRIVER_MAX_WRITE_ATTEMPTS = 3; // failed output writes before the field is dropped
+
+//###############################################################
+// Mailbox commands
+//###############################################################
+#define MKS_DRIVER_CMD_MOVE_STEPS      1 // dir, speed, value = steps. Does not block
+#define MKS_DRIVER_CMD_RUN_CONTINUOUS  2 // dir, speed
+#define MKS_DRIVER_CMD_STOP            3
+#define MKS_DRIVER_CMD_ENABLE          4 // value = 0/1
+#define MKS_DRIVER_CMD_SET_CURRENT     5 // value = mA
+#define MKS_DRIVER_CMD_RELEASE_LOCK    6
+#define MKS_DRIVER_CMD_GOTO_ZERO       7
+
+struct servo42c_driver_command {
+    uint8_t  axis;
+    uint8_t  op;
+    uint8_t  dir;
+    uint8_t  speed;
+    uint32_t value;
+    uint32_t tag;   // != 0 = post a response with this tag
+};
+
+struct servo42c_driver_response {
+    uint32_t tag;
+    uint8_t  axis;
+    uint8_t  op;
+    bool     success;
+    uint8_t  limit_error; // MKS_LIMIT_* if a motion command was refused
+};
+
+//###############################################################
+// Process image of one axis
+//
+// Inputs are the telemetry snapshot of the axis. Each field has
+// its own divisor: read every n cycles, 0 = never. Read them with
+// read_inputs() or the SERVO42C snapshot getters. A failed read
+// keeps the old value, get_input_state() tells how old it is.
+//
+// Outputs are written by the application with write_*(). A field
+// is only sent if it changed (dirty bit), in the order enable,
+// target, speed. target is an absolute position in microsteps in
+// the position space of the soft limits (set_position_reference)
+// speed 0 stops a continuous run. Failed writes stay dirty and are
+// sent again next cycle, up to MKS_DRIVER_MAX_WRITE_ATTEMPTS times.
+// Then the field is dropped and flagged as failed until it is
+// written again. Writes refused by the soft limits are dropped at
+// once and reported in the output status
+//###############################################################
+struct servo42c_driver_io {
+    uint8_t encoder;
+    uint8_t pulses;
+    uint8_t angle_error;
+    uint8_t enable;
+    uint8_t lock;
+    bool    poll_idle;  // run the idle policy every cycle
+};
+
+#define MKS_IMAGE_OUT_ENABLE  0x01
+#define MKS_IMAGE_OUT_TARGET  0x02
+#define MKS_IMAGE_OUT_SPEED   0x04
+
+struct servo42c_image_outputs {
+    uint8_t enable;
+    int64_t target;
+    uint8_t target_speed;
+    uint8_t dir;
+    uint8_t speed;
+};
+
+struct servo42c_image_status {
+    uint8_t  dirty;         // MKS_IMAGE_OUT_* not sent yet
+    uint8_t  failed;        // MKS_IMAGE_OUT_* dropped after MKS_DRIVER_MAX_WRITE_ATTEMPTS
+    uint8_t  limit_error;   // MKS_LIMIT_* of the last refused write
+    uint32_t writes;
+    uint32_t write_errors;
+};
+
+//###############################################################
+// Freshness of the inputs of one axis, bits are 1 << MKS_INPUT_*
+// valid: the last read of the input succeeded
+// age:   ms since the last successful read, UINT32_MAX if never
+//###############################################################
+struct servo42c_image_input_state {
+    uint8_t  valid;
+    uint32_t age[MKS_INPUT_COUNT];
+};
+
+//###############################################################
+// period:       cycle time in ms
+// max_commands: mailbox commands executed per cycle, the rest
+//               waits for the next one. Bounds the cycle time
+//###############################################################
+struct servo42c_driver_config {
+    uint32_t    period;
+    UBaseType_t priority;
+    uint32_t    stack_size;
+    uint8_t     queue_length;
+    uint8_t     max_commands;
+};
+
+//###############################################################
+// Timing of the driver task
+// jitter is the deviation of the time between two cycle starts
+// from the period. An overrun is a cycle that took longer than
+// the period
+//###############################################################
+struct servo42c_driver_stats {
+    uint32_t cycles;
+    uint32_t overruns;
+    uint32_t last_cycle_us;
+    uint32_t max_cycle_us;
+    uint32_t last_jitter_us;
+    uint32_t avg_jitter_us;     // moving average over the last ~16 cycles
+    uint32_t max_jitter_us;
+    uint32_t commands;
+    uint32_t read_errors;       // failed input reads
+    uint32_t writes;            // outputs sent
+    uint32_t lost_responses;    // response mailbox was full
+};
+
+//###############################################################
+// Driver task
+// Owns the bus of the given axes and runs a fixed period cycle:
+// inputs of the process image, dirty outputs, then up to 
+// max_commands commands from the mailbox. Application tasks never
+// wait for the UART, they work on the image or post commands
+//###############################################################
+class SERVO42C_DRIVER {
+
+    private:
+
+        SERVO42C *axes[MKS_DRIVER_MAX_AXES];
+        uint8_t   num_axes;
+        servo42c_driver_config config;
+        servo42c_driver_io     io[MKS_DRIVER_MAX_AXES];
+        servo42c_image_outputs outputs[MKS_DRIVER_MAX_AXES];
+        servo42c_image_status  output_status[MKS_DRIVER_MAX_AXES];
+        uint8_t                output_set[MKS_DRIVER_MAX_AXES]; // fields written at least once
+        uint8_t                write_attempts[MKS_DRIVER_MAX_AXES][3]; // failed writes in a row per output field
+        uint8_t                input_valid[MKS_DRIVER_MAX_AXES];
+        uint8_t                input_seen[MKS_DRIVER_MAX_AXES];
+        unsigned long          input_time[MKS_DRIVER_MAX_AXES][MKS_INPUT_COUNT]; // millis() of the last good read
+
+        QueueHandle_t commands;
+        QueueHandle_t responses;
+        TaskHandle_t  task_handle;
+        volatile bool running;
+        volatile bool stop_request;
+
+        portMUX_TYPE          mux;
+        servo42c_driver_stats stats;
+
+        static void task( void *parameter );
+        void        run( void );
+        void        cycle( uint32_t count );
+        void        update_inputs( uint32_t count );
+        void        write_outputs( void );
+        bool        write_output( uint8_t axis, uint8_t field, const servo42c_image_outputs &values );
+        void        execute( const servo42c_driver_command &command );
+
+    public:
+        SERVO42C_DRIVER();
+        static servo42c_driver_config default_config( void );
+        bool init( SERVO42C **axes, uint8_t num_axes, const servo42c_driver_config &config = default_config() );
+        bool set_io( uint8_t axis, const servo42c_driver_io &io );
+        bool read_inputs( uint8_t axis, servo42c_telemetry &inputs );
+        bool get_input_state( uint8_t axis, servo42c_image_input_state &state );
+        bool write_enable( uint8_t axis, uint8_t enable );
+        bool write_target( uint8_t axis, int64_t target, uint8_t speed );
+        bool write_speed( uint8_t axis, uint8_t dir, uint8_t speed );
+        bool get_output_status( uint8_t axis, servo42c_image_status &status );
+        bool start( void );
+        void stop( void );
+        bool is_running( void );
+        bool post( const servo42c_driver_command &command, TickType_t wait = 0 );
+        bool get_response( servo42c_driver_response &response, TickType_t wait = 0 );
+        void get_stats( servo42c_driver_stats &stats );
+        void reset_stats( void );
+
+};
+
+
+#endif
\ No newline at end of file
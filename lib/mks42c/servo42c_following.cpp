@@ -0,0 +1,158 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// Following error / missed step detection
+//
+// The pulses received counter is what the axis was told to do and 
+// the encoder is what it did. The difference converted to microsteps
+// is the following error. A single sample can be noisy while the
+// motor accelerates so the alarm is based on a moving average
+//
+//####################################################################
+#include <Arduino.h>
+#include "servo42c_following.h"
+
+SERVO42C_FOLLOWING::SERVO42C_FOLLOWING() : servo( NULL ), callback( NULL ), status(), following_window(), angle_window(), 
+                                           call_count( 0 ) {
+    config = default_config();
+}
+
+servo42c_following_config SERVO42C_FOLLOWING::default_config(){
+    servo42c_following_config config;
+    config.warning_limit = 64;
+    config.alarm_limit   = 256;
+    config.window        = 8;
+    config.divider       = 1;
+    config.low_overhead  = false;
+    return config;
+}
+
+void SERVO42C_FOLLOWING::init( SERVO42C *_servo, const servo42c_following_config &_config ){
+    servo  = _servo;
+    config = _config;
+    if( config.window == 0 ){ config.window = 1; }
+    if( config.window > MKS_FOLLOWING_MAX_WINDOW ){ config.window = MKS_FOLLOWING_MAX_WINDOW; }
+    if( config.divider == 0 ){ config.divider = 1; }
+}
+
+void SERVO42C_FOLLOWING::set_callback( servo42c_following_callback _callback ){
+    callback = _callback;
+}
+
+//#########################################################################
+// Take the current difference between pulses and encoder as zero and
+// clear the windows. The axis should not move while this is called
+//#########################################################################
+bool SERVO42C_FOLLOWING::reset(){
+    bool success = servo->set_following_reference();
+    following_window = window();
+    angle_window     = window();
+    call_count       = 0;
+    status           = servo42c_following_status();
+    status.timestamp = millis();
+    return success;
+}
+
+//#########################################################################
+// Get one error sample in microsteps. full is false for an angle error
+// sample of low_overhead, these go into the angle window right here.
+// A failed read gives no sample, the telemetry would still hold an
+// older value
+//#########################################################################
+bool SERVO42C_FOLLOWING::sample( int64_t &error, bool &full ){
+    servo42c_telemetry snapshot;
+    if( config.low_overhead ){
+        if( !servo->read_input( MKS_INPUT_ANGLE_ERROR ) ){
+            return false;
+        }
+        servo->get_telemetry( snapshot );
+        // the raw angle error has the same scale as the encoder
+        error = servo->encoder_to_steps( snapshot.angle_error );
+        full  = false;
+        add_to_window( angle_window, error, status.angle_avg, status.angle_max );
+        int64_t abs_error = error < 0 ? -error : error;
+        if( abs_error <= config.warning_limit ){
+            return true;
+        }
+    }
+    servo42c_position position;
+    if( !servo->get_position( position ) || !position.following_valid ){
+        return false;
+    }
+    ++status.full_samples;
+    error = position.following_error;
+    full  = true;
+    return true;
+}
+
+void SERVO42C_FOLLOWING::add_to_window( window &samples, int64_t error, int64_t &avg, int64_t &max ){
+    uint32_t abs_error = (uint32_t)( error < 0 ? -error : error );
+    if( samples.fill == config.window ){
+        samples.sum -= samples.values[samples.head];
+    } else {
+        ++samples.fill;
+    }
+    samples.values[samples.head] = abs_error;
+    samples.sum += abs_error;
+    samples.head = ( samples.head + 1 ) % config.window;
+    uint32_t highest = 0;
+    for( uint8_t i = 0; i < samples.fill; ++i ){
+        if( samples.values[i] > highest ){ highest = samples.values[i]; }
+    }
+    max = highest;
+    avg = (int64_t)( samples.sum / samples.fill );
+}
+
+//#########################################################################
+// Call it at the control loop rate. Only every n-th call samples
+// returns true if a sample was taken
+//#########################################################################
+bool SERVO42C_FOLLOWING::update(){
+    if( ++call_count < config.divider ){
+        return false;
+    }
+    call_count = 0;
+    int64_t error;
+    bool    full;
+    if( !sample( error, full ) ){
+        return false;
+    }
+    ++status.samples;
+    status.error     = error;
+    status.timestamp = millis();
+    if( full ){
+        add_to_window( following_window, error, status.window_avg, status.window_max );
+    }
+
+    servo42c_following_state state = MKS_FOLLOWING_OK;
+    int64_t abs_error = error < 0 ? -error : error;
+    if( status.window_avg > config.alarm_limit || status.angle_avg > config.alarm_limit ){
+        state = MKS_FOLLOWING_ALARM;
+    } else if( abs_error > config.warning_limit ){
+        state = MKS_FOLLOWING_WARNING;
+    }
+    if( state != status.state ){
+        if( state == MKS_FOLLOWING_ALARM ){ ++status.alarms; }
+        status.state = state;
+        if( callback != NULL ){
+            callback( servo, status );
+        }
+    }
+    return true;
+}
+
+void SERVO42C_FOLLOWING::get_status( servo42c_following_status &_status ){
+    _status = status;
+}
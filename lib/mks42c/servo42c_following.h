@@ -0,0 +1,105 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_FOLLOWING
+#define SERVO42C_MKS_FOLLOWING
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c.h"
+
+static const uint8_t MKS_FOLLOWING_MAX_WINDOW = 32;
+
+enum servo42c_following_state {
+    MKS_FOLLOWING_OK      = 0,
+    MKS_FOLLOWING_WARNING = 1,
+    MKS_FOLLOWING_ALARM   = 2
+};
+
+//###############################################################
+// Following error monitor settings, limits are in microsteps
+// warning_limit: a single sample above it raises a warning
+// alarm_limit:   the window average above it raises an alarm
+// window:        number of samples in the moving window
+// divider:       only sample every n-th update() call
+// low_overhead:  read the angle error (one 4 byte response) and
+//                only do the full encoder + pulses sample if it
+//                is above the warning limit. The angle error is
+//                the lag inside the drive's loop, not the error
+//                against the pulses. Both go into their own
+//                window, each can raise the alarm
+//###############################################################
+struct servo42c_following_config {
+    uint32_t warning_limit;
+    uint32_t alarm_limit;
+    uint8_t  window;
+    uint8_t  divider;
+    bool     low_overhead;
+};
+
+struct servo42c_following_status {
+    servo42c_following_state state;
+    int64_t  error;        // last error in microsteps, following or angle error
+    int64_t  window_avg;   // average absolute following error in the window
+    int64_t  window_max;   // max absolute following error in the window
+    int64_t  angle_avg;    // same for the angle error samples of low_overhead
+    int64_t  angle_max;
+    uint32_t samples;      // samples taken since reset
+    uint32_t full_samples; // samples that needed encoder + pulses
+    uint32_t alarms;       // number of times the alarm state was entered
+    uint32_t timestamp;    // millis() of the last sample
+};
+
+typedef void (*servo42c_following_callback)( SERVO42C *servo, const servo42c_following_status &status );
+
+//###############################################################
+// Compares the pulses received with the encoder to catch lost
+// steps. Call reset() once while the axis is at rest, it sets
+// the following reference of the axis
+//###############################################################
+class SERVO42C_FOLLOWING {
+
+    private:
+
+        SERVO42C *servo;
+        servo42c_following_config   config;
+        servo42c_following_callback callback;
+        servo42c_following_status   status;
+
+        struct window {
+            uint32_t values[MKS_FOLLOWING_MAX_WINDOW];
+            uint8_t  head;
+            uint8_t  fill;
+            uint64_t sum;
+        };
+
+        window   following_window;
+        window   angle_window;
+        uint8_t  call_count;
+
+        bool     sample( int64_t &error, bool &full );
+        void     add_to_window( window &samples, int64_t error, int64_t &avg, int64_t &max );
+
+    public:
+        SERVO42C_FOLLOWING();
+        static servo42c_following_config default_config( void );
+        void    init( SERVO42C *servo, const servo42c_following_config &config = default_config() );
+        void    set_callback( servo42c_following_callback callback );
+        bool    reset( void );
+        bool    update( void );
+        void    get_status( servo42c_following_status &status );
+
+};
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,136 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// Homing based on the zero mode commands 0x90 - 0x94
+//
+// The driver does not report when goto zero is done. The encoder is
+// polled instead and the axis counts as homed once the value did not
+// change for a few polls
+//
+//####################################################################
+#include <Arduino.h>
+#include "servo42c_homing.h"
+
+servo42c_homing_config SERVO42C_HOMING::default_config(){
+    servo42c_homing_config config;
+    config.mode             = 1;
+    config.speed            = 2;
+    config.direction        = 0;
+    config.set_zero         = false;
+    config.timeout          = MKS_HOMING_TIMEOUT;
+    config.poll_interval    = MKS_HOMING_POLL_INTERVAL;
+    config.settle_polls     = MKS_HOMING_SETTLE_POLLS;
+    config.settle_tolerance = MKS_HOMING_SETTLE_TOLERANCE;
+    config.min_move_time    = MKS_HOMING_MIN_MOVE_TIME;
+    return config;
+}
+
+//#########################################################################
+// Encoder read that can fail, get_encoder_value() returns 0 instead
+//#########################################################################
+static bool read_encoder( SERVO42C *servo, int64_t &encoder ){
+    if( !servo->read_input( MKS_INPUT_ENCODER ) ){
+        return false;
+    }
+    servo42c_telemetry snapshot;
+    servo->get_telemetry( snapshot );
+    encoder = snapshot.encoder;
+    return true;
+}
+
+//#########################################################################
+// Sends zero mode, speed, direction and optionally the zero position
+//#########################################################################
+bool SERVO42C_HOMING::configure( SERVO42C *servo, const servo42c_homing_config &config ){
+    if( !servo->set_zero_mode( config.mode ) ){ return false; }
+    if( !servo->set_zero_mode_speed( config.speed ) ){ return false; }
+    if( !servo->set_zero_mode_direction( config.direction ) ){ return false; }
+    if( config.set_zero && !servo->set_zero_position() ){ return false; }
+    return true;
+}
+
+bool SERVO42C_HOMING::home( SERVO42C *servo, const servo42c_homing_config &config, servo42c_homing_result &result ){
+    return home( &servo, 1, config, &result );
+}
+
+//#########################################################################
+// Home multiple axes at once
+// returns true if all axes settled before the timeout. The result array
+// needs num_axes entries
+//#########################################################################
+bool SERVO42C_HOMING::home( SERVO42C **axes, uint8_t num_axes, const servo42c_homing_config &config, servo42c_homing_result *results ){
+    if( num_axes > MKS_HOMING_MAX_AXES ){ num_axes = MKS_HOMING_MAX_AXES; }
+    int64_t       last_encoder[MKS_HOMING_MAX_AXES];
+    uint8_t       settle_count[MKS_HOMING_MAX_AXES];
+    bool          moved[MKS_HOMING_MAX_AXES];
+    bool          pending[MKS_HOMING_MAX_AXES];
+    unsigned long move_start[MKS_HOMING_MAX_AXES];
+    uint8_t       num_pending = 0;
+
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        servo42c_homing_result &result = results[i];
+        unsigned long start = millis();
+        result.success      = false;
+        result.move_time    = 0;
+        result.encoder      = 0;
+        pending[i]          = configure( axes[i], config );
+        result.setup_time   = millis() - start;
+        if( !pending[i] ){ continue; }
+        settle_count[i] = 0;
+        moved[i]        = false;
+        move_start[i]   = millis();
+        pending[i]      = read_encoder( axes[i], last_encoder[i] ) && axes[i]->set_goto_zero();
+        if( pending[i] ){ ++num_pending; }
+    }
+
+    while( num_pending > 0 ){
+        vTaskDelay( config.poll_interval );
+        for( uint8_t i = 0; i < num_axes; ++i ){
+            if( !pending[i] ){ continue; }
+            servo42c_homing_result &result = results[i];
+            int64_t encoder;
+            result.move_time = millis() - move_start[i];
+            if( !read_encoder( axes[i], encoder ) ){
+                pending[i] = false; // position unknown, homing failed
+                --num_pending;
+                continue;
+            }
+            int64_t delta   = encoder - last_encoder[i];
+            if( delta < 0 ){ delta = -delta; }
+            if( delta > config.settle_tolerance ){
+                moved[i] = true;
+            }
+            // standing still before the motion started is not done
+            bool may_settle = moved[i] || result.move_time >= config.min_move_time;
+            settle_count[i] = delta <= config.settle_tolerance && may_settle ? settle_count[i] + 1 : 0;
+            last_encoder[i] = encoder;
+            result.encoder   = encoder;
+            if( settle_count[i] >= config.settle_polls ){
+                // home is position 0 for the soft limits
+                result.success = axes[i]->set_position_reference( 0 );
+            } else if( result.move_time < config.timeout ){
+                continue;
+            }
+            pending[i] = false;
+            --num_pending;
+        }
+    }
+
+    bool success = true;
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        success &= results[i].success;
+    }
+    return success;
+}
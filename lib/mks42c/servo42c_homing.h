@@ -0,0 +1,74 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_HOMING
+#define SERVO42C_MKS_HOMING
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c.h"
+
+static const uint8_t  MKS_HOMING_MAX_AXES        = 10;   // slave addresses 0-9
+static const uint32_t MKS_HOMING_TIMEOUT         = 30000;
+static const uint32_t MKS_HOMING_POLL_INTERVAL   = 20;
+static const uint8_t  MKS_HOMING_SETTLE_POLLS    = 5;
+static const uint16_t MKS_HOMING_SETTLE_TOLERANCE = 16;  // encoder counts, 65536 = 1 revolution
+static const uint32_t MKS_HOMING_MIN_MOVE_TIME   = 500;  // ms before an axis that never moved counts as settled
+
+//###############################################################
+// Homing settings, same for all axes of a homing run
+// mode:      0 = disabled, 1 = DirMode, 2 = NearMode
+// speed:     0 - 4
+// direction: 0 = CW, 1 = CCW
+// set_zero:  use the current position as the new zero before 
+//            going to zero. Only for commissioning
+//###############################################################
+struct servo42c_homing_config {
+    uint8_t  mode;
+    uint8_t  speed;
+    uint8_t  direction;
+    bool     set_zero;
+    uint32_t timeout;           // ms per axis
+    uint32_t poll_interval;     // ms between encoder rounds
+    uint8_t  settle_polls;      // unchanged encoder reads needed to count as done
+    uint16_t settle_tolerance;  // max encoder change that still counts as unchanged
+    uint32_t min_move_time;     // ms, settling only counts once the axis moved or after this
+};
+
+struct servo42c_homing_result {
+    bool     success;
+    uint32_t setup_time;  // ms for the zero mode commands
+    uint32_t move_time;   // ms from goto zero until the encoder settled
+    int64_t  encoder;     // encoder value after homing
+};
+
+//###############################################################
+// Homes one or more axes on the same or different buses.
+// All axes get their goto zero command first and are then
+// watched round robin until the encoder settled. The settled
+// position becomes position 0 for the soft limits. An axis that
+// is not seen moving can only settle after min_move_time, the
+// drive may start late. A failed encoder read fails the axis
+//###############################################################
+class SERVO42C_HOMING {
+
+    public:
+        static servo42c_homing_config default_config( void );
+        static bool configure( SERVO42C *servo, const servo42c_homing_config &config );
+        static bool home( SERVO42C *servo, const servo42c_homing_config &config, servo42c_homing_result &result );
+        static bool home( SERVO42C **axes, uint8_t num_axes, const servo42c_homing_config &config, servo42c_homing_result *results );
+
+};
+
+
+#endif
\ No newline at end of file
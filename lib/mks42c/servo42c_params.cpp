@@ -0,0 +1,177 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c_params.h"
+#include "servo42c_rpc_protocol.h"
+#include <Preferences.h>
+
+static const char   *MKS_PARAMS_NAMESPACE = "servo42c";
+static const uint8_t MKS_PARAMS_MAGIC_A    = 'M';
+static const uint8_t MKS_PARAMS_MAGIC_B    = 'P';
+
+static void params_key( uint8_t axis, char *key ){
+    snprintf( key, 8, "axis%u", axis );
+}
+
+//#########################################################################
+// Write the blob into out, needs MKS_PARAMS_BLOB_SIZE bytes
+// returns the number of bytes written
+//#########################################################################
+size_t SERVO42C_PARAMS::serialize( const servo42c_params &params, uint8_t *out ){
+    out[0] = MKS_PARAMS_MAGIC_A;
+    out[1] = MKS_PARAMS_MAGIC_B;
+    out[2] = MKS_PARAMS_VERSION;
+    out[3] = MKS_PARAM_COUNT;
+    servo42c_put_u32( out + 4, params.valid );
+    size_t length = 8;
+    for( uint8_t i = 0; i < MKS_PARAM_COUNT; ++i ){
+        servo42c_put_u16( out + length, params.value[i] );
+        length += 2;
+    }
+    servo42c_put_u16( out + length, servo42c_crc16( out, length ) );
+    return length + 2;
+}
+
+//#########################################################################
+// Parse a blob. Fails on bad magic, unknown version, size or crc
+// Parameters not in the blob are marked as not valid
+//#########################################################################
+bool SERVO42C_PARAMS::deserialize( const uint8_t *in, size_t length, servo42c_params &params ){
+    if( length < 10 || in[0] != MKS_PARAMS_MAGIC_A || in[1] != MKS_PARAMS_MAGIC_B || in[2] != MKS_PARAMS_VERSION ){
+        return false;
+    }
+    uint8_t count = in[3];
+    size_t  size  = 8 + count * 2 + 2;
+    if( length < size || servo42c_crc16( in, size - 2 ) != servo42c_get_u16( in + size - 2 ) ){
+        return false;
+    }
+    if( count > MKS_PARAM_COUNT ){ count = MKS_PARAM_COUNT; }
+    params       = servo42c_params();
+    params.valid = servo42c_get_u32( in + 4 ) & ( ( 1UL << count ) - 1 );
+    for( uint8_t i = 0; i < count; ++i ){
+        params.value[i] = servo42c_get_u16( in + 8 + i * 2 );
+    }
+    return true;
+}
+
+//#########################################################################
+// Store the parameters applied to the servo under the given axis index
+//#########################################################################
+bool SERVO42C_PARAMS::save( SERVO42C *servo, uint8_t axis ){
+    servo42c_params params;
+    uint8_t         blob[MKS_PARAMS_BLOB_SIZE];
+    char            key[8];
+    servo->get_params( params );
+    size_t length = serialize( params, blob );
+    params_key( axis, key );
+    Preferences prefs;
+    if( !prefs.begin( MKS_PARAMS_NAMESPACE, false ) ){
+        return false;
+    }
+    bool success = prefs.putBytes( key, blob, length ) == length;
+    prefs.end();
+    return success;
+}
+
+//#########################################################################
+// Read a snapshot from flash. false if there is none or it is corrupt
+//#########################################################################
+bool SERVO42C_PARAMS::load( uint8_t axis, servo42c_params &params ){
+    uint8_t blob[MKS_PARAMS_BLOB_MAX];
+    char    key[8];
+    params_key( axis, key );
+    Preferences prefs;
+    if( !prefs.begin( MKS_PARAMS_NAMESPACE, true ) ){
+        return false;
+    }
+    size_t length = prefs.getBytesLength( key );
+    // blobs of a newer build can be longer than MKS_PARAMS_BLOB_SIZE
+    // read them whole, the crc covers all values and deserialize
+    // skips the unknown ones. Anything longer is not a valid blob
+    length = length > 0 && length <= sizeof( blob ) ? prefs.getBytes( key, blob, length ) : 0;
+    prefs.end();
+    return deserialize( blob, length, params );
+}
+
+bool SERVO42C_PARAMS::erase( uint8_t axis ){
+    char key[8];
+    params_key( axis, key );
+    Preferences prefs;
+    if( !prefs.begin( MKS_PARAMS_NAMESPACE, false ) ){
+        return false;
+    }
+    bool success = prefs.remove( key );
+    prefs.end();
+    return success;
+}
+
+//#########################################################################
+// Apply all valid parameters in id order while holding the bus
+// Baudrate and slave address change how the drive is reached and are
+// only applied with bus_settings = true, after everything else.
+// Keeps going after a failed parameter and returns false at the end
+//#########################################################################
+bool SERVO42C_PARAMS::restore( SERVO42C *servo, const servo42c_params &params, bool bus_settings ){
+    bool success = true;
+    // other tasks must not talk to the drive while it is half configured
+    servo->lock_bus();
+    for( uint8_t i = 0; i < MKS_PARAM_COUNT; ++i ){
+        if( !( params.valid & ( 1UL << i ) ) ){
+            continue;
+        }
+        uint16_t value = params.value[i];
+        switch( i ){
+            case MKS_PARAM_WORK_MODE:                 success &= servo->set_work_mode( value );                 break;
+            case MKS_PARAM_MOTOR_TYPE:                success &= servo->set_motor_type( value );                break;
+            case MKS_PARAM_SUBDIVISION:               success &= servo->set_subdivision( value );               break;
+            case MKS_PARAM_SUBDIVISION_INTERPOLATION: success &= servo->set_subdivision_interpolation( value ); break;
+            case MKS_PARAM_CURRENT:                   success &= servo->set_max_current( value );               break;
+            case MKS_PARAM_MAX_TORQUE:                success &= servo->set_max_torque( value );                break;
+            case MKS_PARAM_PID_KP:                    success &= servo->set_pid_kp( value );                    break;
+            case MKS_PARAM_PID_KI:                    success &= servo->set_pid_ki( value );                    break;
+            case MKS_PARAM_PID_KD:                    success &= servo->set_pid_kd( value );                    break;
+            case MKS_PARAM_ACC:                       success &= servo->set_acc( value );                       break;
+            case MKS_PARAM_ENABLE_MODE:               success &= servo->set_enable_mode( value );               break;
+            case MKS_PARAM_MOTOR_DIR:                 success &= servo->set_motor_dir( value );                 break;
+            case MKS_PARAM_SCREEN_AUTO_OFF:           success &= servo->set_screen_auto_off( value );           break;
+            case MKS_PARAM_SHAFT_LOCK_PROTECTION:     success &= servo->set_shaft_lock_protection( value );     break;
+            case MKS_PARAM_ZERO_MODE:                 success &= servo->set_zero_mode( value );                 break;
+            case MKS_PARAM_ZERO_MODE_SPEED:           success &= servo->set_zero_mode_speed( value );           break;
+            case MKS_PARAM_ZERO_MODE_DIRECTION:       success &= servo->set_zero_mode_direction( value );       break;
+            default: break;
+        }
+    }
+    if( bus_settings ){
+        // address first, the baudrate change is the last frame the
+        // drive can answer at the old speed
+        if( params.valid & ( 1UL << MKS_PARAM_SLAVE_ADDRESS ) ){
+            success &= servo->change_slave_address( params.value[MKS_PARAM_SLAVE_ADDRESS] );
+        }
+        if( params.valid & ( 1UL << MKS_PARAM_BAUDRATE ) ){
+            success &= servo->set_baudrate( params.value[MKS_PARAM_BAUDRATE] );
+        }
+    }
+    servo->unlock_bus();
+    return success;
+}
+
+//#########################################################################
+// Load the snapshot of the axis from flash and apply it
+//#########################################################################
+bool SERVO42C_PARAMS::restore( SERVO42C *servo, uint8_t axis, bool bus_settings ){
+    servo42c_params params;
+    if( !load( axis, params ) ){
+        return false;
+    }
+    return restore( servo, params, bus_settings );
+}
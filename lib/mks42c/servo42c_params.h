@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_PARAMS
+#define SERVO42C_MKS_PARAMS
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c.h"
+
+//###############################################################
+// Snapshot of the parameters applied to a drive
+// Used to recommission a replaced drive in one call
+//
+// Blob:  'M', 'P', version, count, valid (u32), count * value (u16),
+//        crc16 (u16) over everything before it. Little endian.
+//        count allows newer builds to append parameters: older
+//        blobs with fewer values load with the rest not valid, newer
+//        blobs load the known values and skip the others. A blob with
+//        another version byte or a bad crc is rejected
+//
+// Stored in NVS (namespace "servo42c") with one key per axis
+//###############################################################
+static const uint8_t MKS_PARAMS_VERSION   = 1;
+static const size_t  MKS_PARAMS_BLOB_SIZE = 8 + MKS_PARAM_COUNT * 2 + 2;
+static const size_t  MKS_PARAMS_BLOB_MAX  = 8 + 255 * 2 + 2; // largest count a blob can carry
+
+class SERVO42C_PARAMS {
+
+    public:
+        static size_t serialize( const servo42c_params &params, uint8_t *out );
+        static bool   deserialize( const uint8_t *in, size_t length, servo42c_params &params );
+        static bool   save( SERVO42C *servo, uint8_t axis );
+        static bool   load( uint8_t axis, servo42c_params &params );
+        static bool   erase( uint8_t axis );
+        static bool   restore( SERVO42C *servo, const servo42c_params &params, bool bus_settings = false );
+        static bool   restore( SERVO42C *servo, uint8_t axis, bool bus_settings = false );
+
+};
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,249 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c_poller.h"
+
+SERVO42C_POLLER::SERVO42C_POLLER() : num_axes( 0 ), config( default_config() ), tokens( 0 ), last_refill( 0 ), window_start( 0 ) {
+    portMUX_INITIALIZE( &mux );
+}
+
+servo42c_poller_config SERVO42C_POLLER::default_config(){
+    servo42c_poller_config config;
+    config.budget           = 1920; // half of 38400 baud
+    config.idle_weight      = 1;
+    config.moving_weight    = 8;
+    config.error_weight     = 4;
+    config.error_threshold  = 182;  // 1°
+    config.motion_threshold = 16;
+    config.hold_time        = 500;
+    config.divisor[MKS_INPUT_ENCODER]      = 1;
+    config.divisor[MKS_INPUT_PULSES]       = 4;
+    config.divisor[MKS_INPUT_ANGLE_ERROR]  = 2;
+    config.divisor[MKS_INPUT_ENABLE_STATE] = 20;
+    config.divisor[MKS_INPUT_LOCK_STATE]   = 20;
+    return config;
+}
+
+//#########################################################################
+// servos: the axes to poll, the index is the axis number used later
+// Axes can be on different UARTs but share the budget
+//#########################################################################
+bool SERVO42C_POLLER::init( SERVO42C **servos, uint8_t _num_axes, const servo42c_poller_config &_config ){
+    uint32_t slot_inputs = 0;
+    for( uint8_t i = 0; i < MKS_INPUT_COUNT; ++i ){
+        slot_inputs += _config.divisor[i];
+    }
+    if( _num_axes > MKS_POLLER_MAX_AXES || _config.budget == 0 || _config.idle_weight == 0 || _config.moving_weight == 0 || slot_inputs == 0 ){
+        return false;
+    }
+    config   = _config;
+    num_axes = _num_axes;
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        axes[i]              = axis_state();
+        axes[i].servo        = servos[i];
+        axes[i].stats.weight = config.idle_weight;
+    }
+    tokens       = 0;
+    last_refill  = micros();
+    window_start = millis();
+    return true;
+}
+
+//#########################################################################
+// Add the bytes earned since the last call. Capped so a long pause
+// doesn't end in a burst that blocks the caller
+//#########################################################################
+void SERVO42C_POLLER::refill(){
+    unsigned long now     = micros();
+    uint32_t      elapsed = now - last_refill;
+    int64_t       earned  = (int64_t)elapsed * config.budget / 1000000;
+    if( earned == 0 ){
+        return; // keep the remainder for the next call
+    }
+    // only consume the time that was turned into bytes
+    last_refill += (unsigned long)( earned * 1000000 / config.budget );
+    int64_t cap = (int64_t)config.budget * MKS_POLLER_BURST / 1000;
+    int64_t min_cap = 0;
+    for( uint8_t i = 0; i < MKS_INPUT_COUNT; ++i ){
+        min_cap += MKS_POLLER_FRAME_BYTES[i];
+    }
+    if( cap < min_cap ){
+        cap = min_cap; // a full slot has to fit
+    }
+    int64_t total = tokens + earned;
+    tokens = (int32_t)( total > cap ? cap : total );
+}
+
+//#########################################################################
+// Axis with the lowest pass, ties go to the lower axis number
+//#########################################################################
+uint8_t SERVO42C_POLLER::next_axis(){
+    uint8_t next = 0;
+    for( uint8_t i = 1; i < num_axes; ++i ){
+        if( (int32_t)( axes[i].pass - axes[next].pass ) < 0 ){
+            next = i;
+        }
+    }
+    return next;
+}
+
+static inline bool input_due( uint8_t divisor, uint32_t count ){
+    return divisor != 0 && ( count % divisor ) == 0;
+}
+
+uint32_t SERVO42C_POLLER::slot_cost( axis_state &state ){
+    uint32_t cost = 0;
+    for( uint8_t i = 0; i < MKS_INPUT_COUNT; ++i ){
+        if( input_due( config.divisor[i], state.slot_count ) ){
+            cost += MKS_POLLER_FRAME_BYTES[i];
+        }
+    }
+    return cost;
+}
+
+//#########################################################################
+// Spend the budget. Returns the number of reads done
+//#########################################################################
+uint32_t SERVO42C_POLLER::poll(){
+    uint32_t reads = 0;
+    if( num_axes == 0 ){
+        return reads;
+    }
+    refill();
+    while( true ){
+        axis_state &state = axes[next_axis()];
+        uint32_t    cost  = slot_cost( state );
+        if( (int32_t)cost > tokens ){
+            break;
+        }
+        tokens -= cost;
+        if( cost > 0 ){
+            reads += run_slot( state, cost );
+        }
+        ++state.slot_count;
+        state.pass += MKS_POLLER_STRIDE / state.stats.weight;
+    }
+    update_rates();
+    return reads;
+}
+
+//#########################################################################
+// Read the due inputs of one axis and update its weight
+//#########################################################################
+uint8_t SERVO42C_POLLER::run_slot( axis_state &state, uint32_t cost ){
+    uint8_t  reads = 0;
+    uint32_t done[MKS_INPUT_COUNT] = { 0 };
+    uint32_t errors = 0;
+    for( uint8_t i = 0; i < MKS_INPUT_COUNT; ++i ){
+        if( !input_due( config.divisor[i], state.slot_count ) ){
+            continue;
+        }
+        ++reads;
+        if( state.servo->read_input( i ) ){
+            ++done[i];
+        } else {
+            ++errors;
+        }
+    }
+    uint8_t weight = update_activity( state );
+    portENTER_CRITICAL( &mux );
+    for( uint8_t i = 0; i < MKS_INPUT_COUNT; ++i ){
+        state.stats.reads[i]   += done[i];
+        state.window_reads[i]  += done[i];
+    }
+    state.stats.errors += errors;
+    ++state.stats.slots;
+    ++state.window_slots;
+    state.window_bytes += cost;
+    state.stats.weight  = weight;
+    portEXIT_CRITICAL( &mux );
+    return reads;
+}
+
+//#########################################################################
+// Moving: the encoder changed by more than motion_threshold within
+// hold_time or the last motion command is still running. The angle
+// error is the last one read. Returns the new weight
+//#########################################################################
+uint8_t SERVO42C_POLLER::update_activity( axis_state &state ){
+    servo42c_telemetry snapshot;
+    state.servo->get_telemetry( snapshot );
+    unsigned long now = millis();
+    if( state.encoder_seen ){
+        int64_t moved = snapshot.encoder - state.last_encoder;
+        if( moved > (int64_t)config.motion_threshold || -moved > (int64_t)config.motion_threshold ){
+            state.last_motion = now;
+        }
+    } else {
+        state.last_motion = now - config.hold_time; // unknown, start idle
+    }
+    state.encoder_seen = true;
+    state.last_encoder = snapshot.encoder;
+    servo42c_prediction prediction;
+    state.servo->predict_position( prediction );
+    bool moving     = ( now - state.last_motion ) < config.hold_time || 
+                      ( prediction.source == MKS_PREDICT_COMMANDED && prediction.velocity != 0 );
+    bool high_error = snapshot.angle_error > (int32_t)config.error_threshold || 
+                      -(int32_t)snapshot.angle_error > (int32_t)config.error_threshold;
+    uint32_t weight = ( moving ? config.moving_weight : config.idle_weight ) + ( high_error ? config.error_weight : 0 );
+    portENTER_CRITICAL( &mux );
+    state.stats.moving     = moving;
+    state.stats.high_error = high_error;
+    portEXIT_CRITICAL( &mux );
+    return weight > 255 ? 255 : (uint8_t)weight;
+}
+
+void SERVO42C_POLLER::update_rates(){
+    unsigned long now = millis();
+    if( ( now - window_start ) < MKS_POLLER_RATE_WINDOW ){
+        return;
+    }
+    uint32_t elapsed = now - window_start;
+    portENTER_CRITICAL( &mux );
+    for( uint8_t n = 0; n < num_axes; ++n ){
+        axis_state &state = axes[n];
+        for( uint8_t i = 0; i < MKS_INPUT_COUNT; ++i ){
+            state.stats.rate[i]   = ( state.window_reads[i] * 1000UL + elapsed / 2 ) / elapsed;
+            state.window_reads[i] = 0;
+        }
+        state.stats.slot_rate  = ( state.window_slots * 1000UL + elapsed / 2 ) / elapsed;
+        state.stats.bytes_rate = ( state.window_bytes * 1000UL + elapsed / 2 ) / elapsed;
+        state.window_slots     = 0;
+        state.window_bytes     = 0;
+    }
+    portEXIT_CRITICAL( &mux );
+    window_start = now;
+}
+
+bool SERVO42C_POLLER::get_stats( uint8_t axis, servo42c_poller_stats &stats ){
+    if( axis >= num_axes ){
+        return false;
+    }
+    portENTER_CRITICAL( &mux );
+    stats = axes[axis].stats;
+    portEXIT_CRITICAL( &mux );
+    return true;
+}
+
+void SERVO42C_POLLER::reset_stats(){
+    portENTER_CRITICAL( &mux );
+    for( uint8_t n = 0; n < num_axes; ++n ){
+        servo42c_poller_stats &stats = axes[n].stats;
+        stats.slots  = 0;
+        stats.errors = 0;
+        for( uint8_t i = 0; i < MKS_INPUT_COUNT; ++i ){
+            stats.reads[i] = 0;
+        }
+    }
+    portEXIT_CRITICAL( &mux );
+}
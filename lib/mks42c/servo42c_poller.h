@@ -0,0 +1,126 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_POLLER
+#define SERVO42C_MKS_POLLER
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c.h"
+
+static const uint8_t  MKS_POLLER_MAX_AXES    = 10;
+static const uint32_t MKS_POLLER_RATE_WINDOW = 1000;  // ms window for the effective rates
+static const uint32_t MKS_POLLER_BURST       = 20;    // ms of budget that can pile up while poll() isn't called
+static const uint32_t MKS_POLLER_STRIDE      = 65536; // stride of weight 1
+
+// wire bytes of request and answer per input, indexed by MKS_INPUT_*
+static const uint8_t  MKS_POLLER_FRAME_BYTES[MKS_INPUT_COUNT] = { 3 + 8, 3 + 6, 3 + 4, 3 + 3, 3 + 3 };
+
+//###############################################################
+// budget:           bytes per second the poller may put on the
+//                   wire, request and answer. 38400 baud carries
+//                   3840 bytes/s, leave room for commands
+// idle_weight:      share of an axis at standstill
+// moving_weight:    share of a moving axis
+// error_weight:     added while |angle error| > error_threshold
+// error_threshold:  raw angle error, 0xFFFF = 360°
+// motion_threshold: encoder counts between two samples that
+//                   count as motion
+// hold_time:        ms an axis still counts as moving after the
+//                   last motion seen
+// divisor:          input n is read in every divisor[n]th slot
+//                   of the axis, 0 = never
+//###############################################################
+struct servo42c_poller_config {
+    uint32_t budget;
+    uint8_t  idle_weight;
+    uint8_t  moving_weight;
+    uint8_t  error_weight;
+    uint16_t error_threshold;
+    uint32_t motion_threshold;
+    uint32_t hold_time;
+    uint8_t  divisor[MKS_INPUT_COUNT];
+};
+
+//###############################################################
+// Per axis scheduling statistics
+// rates are samples per second in the last window
+//###############################################################
+struct servo42c_poller_stats {
+    uint8_t  weight;                  // current share
+    bool     moving;
+    bool     high_error;
+    uint32_t slots;                   // slots given to the axis
+    uint32_t reads[MKS_INPUT_COUNT];
+    uint32_t errors;                  // failed reads
+    uint32_t rate[MKS_INPUT_COUNT];
+    uint32_t slot_rate;
+    uint32_t bytes_rate;              // wire bytes per second used by the axis
+};
+
+//###############################################################
+// Adaptive polling
+// Reads the inputs of all axes within a shared byte budget.
+// Every poll slot goes to the axis with the lowest pass value,
+// which then advances by MKS_POLLER_STRIDE / weight. Moving axes
+// and axes with a high angle error get a larger weight and so
+// proportionally more slots. An axis counts as moving if the
+// encoder changed or a motion command is active. The slot runs
+// the inputs due by the divisors. poll() spends what the budget
+// earned since the last call and returns, call it from a loop or
+// a bus task. Readers get the values with get_telemetry()
+//###############################################################
+class SERVO42C_POLLER {
+
+    private:
+
+        struct axis_state {
+            SERVO42C     *servo;
+            uint32_t      pass;
+            uint32_t      slot_count;
+            bool          encoder_seen;
+            int64_t       last_encoder;
+            unsigned long last_motion;  // millis()
+            uint32_t      window_reads[MKS_INPUT_COUNT];
+            uint32_t      window_slots;
+            uint32_t      window_bytes;
+            servo42c_poller_stats stats;
+        };
+
+        axis_state    axes[MKS_POLLER_MAX_AXES];
+        uint8_t       num_axes;
+        servo42c_poller_config config;
+        portMUX_TYPE  mux;
+        int32_t       tokens;          // bytes the budget allows right now
+        unsigned long last_refill;     // micros()
+        unsigned long window_start;    // millis()
+
+        void     refill( void );
+        uint8_t  next_axis( void );
+        uint32_t slot_cost( axis_state &state );
+        uint8_t  run_slot( axis_state &state, uint32_t cost );
+        uint8_t  update_activity( axis_state &state );
+        void     update_rates( void );
+
+    public:
+        SERVO42C_POLLER();
+        static servo42c_poller_config default_config( void );
+        bool init( SERVO42C **servos, uint8_t num_axes, const servo42c_poller_config &config = default_config() );
+        uint32_t poll( void );
+        bool get_stats( uint8_t axis, servo42c_poller_stats &stats );
+        void reset_stats( void );
+
+};
+
+
+#endif
\ No newline at end of file
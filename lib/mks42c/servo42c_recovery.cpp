@@ -0,0 +1,252 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// Shaft lock protection watcher
+//
+// The 42C locks the shaft if the rotor is blocked and the lock
+// protection is enabled. It stays locked until 0x3D is sent. This
+// engine polls the lock state (and optionally the angle error) and 
+// runs a recovery: release, back off a few steps in the opposite
+// direction and retry the remaining part of the move
+//
+//####################################################################
+#include <Arduino.h>
+#include "servo42c_recovery.h"
+
+SERVO42C_RECOVERY::SERVO42C_RECOVERY() : servo( NULL ), callback( NULL ), event_head( 0 ), event_count( 0 ), move_active( false ), 
+                                         move_dir( 0 ), move_speed( 0 ), move_steps( 0 ), move_start_encoder( 0 ), 
+                                         last_encoder( 0 ), settle_count( 0 ), over_limit_count( 0 ) {
+    config = default_config();
+}
+
+servo42c_recovery_config SERVO42C_RECOVERY::default_config(){
+    servo42c_recovery_config config;
+    config.backoff_steps     = MKS_RECOVERY_BACKOFF_STEPS;
+    config.backoff_speed     = MKS_RECOVERY_BACKOFF_SPEED;
+    config.max_attempts      = MKS_RECOVERY_MAX_ATTEMPTS;
+    config.angle_error_limit = 0;
+    config.angle_error_polls = 3;
+    config.retry_move        = true;
+    return config;
+}
+
+void SERVO42C_RECOVERY::init( SERVO42C *_servo, const servo42c_recovery_config &_config ){
+    servo  = _servo;
+    config = _config;
+    if( config.max_attempts == 0 ){ config.max_attempts = 1; }
+}
+
+void SERVO42C_RECOVERY::set_callback( servo42c_lock_callback _callback ){
+    callback = _callback;
+}
+
+//#########################################################################
+// Start a tracked move. Does not block. The move counts as active until
+// the encoder stopped changing for a few polls. Fails without moving if
+// the encoder can't be read, there would be nothing to count the steps from
+//#########################################################################
+bool SERVO42C_RECOVERY::move( uint8_t dir, uint8_t speed, uint32_t steps ){
+    if( !read_encoder( move_start_encoder ) || !servo->set_move_steps( dir, speed, steps, false ) ){
+        move_active = false;
+        return false;
+    }
+    last_encoder     = move_start_encoder;
+    move_active      = true;
+    move_dir         = dir;
+    move_speed       = speed;
+    move_steps       = steps;
+    settle_count     = 0;
+    over_limit_count = 0;
+    return true;
+}
+
+bool SERVO42C_RECOVERY::is_moving(){
+    return move_active;
+}
+
+//#########################################################################
+// Steps done since the move started. Based on the encoder and the
+// steps per revolution of the axis
+//#########################################################################
+uint32_t SERVO42C_RECOVERY::steps_done( int64_t encoder ){
+    int64_t delta = servo->encoder_to_steps( encoder ) - servo->encoder_to_steps( move_start_encoder );
+    if( delta < 0 ){ delta = -delta; }
+    return (uint32_t)delta;
+}
+
+//#########################################################################
+// Encoder from the drive. false if it didn't answer, get_encoder_value()
+// would return 0 and the steps done would be way off
+//#########################################################################
+bool SERVO42C_RECOVERY::read_encoder( int64_t &encoder ){
+    if( !servo->read_input( MKS_INPUT_ENCODER ) ){
+        return false;
+    }
+    servo42c_telemetry snapshot;
+    servo->get_telemetry( snapshot );
+    encoder = snapshot.encoder;
+    return true;
+}
+
+//#########################################################################
+// Lock state from the drive. false if it didn't answer, a comms error
+// must not look like a released lock
+//#########################################################################
+bool SERVO42C_RECOVERY::read_lock_state( bool &locked ){
+    if( !servo->read_input( MKS_INPUT_LOCK_STATE ) ){
+        return false;
+    }
+    servo42c_telemetry snapshot;
+    servo->get_telemetry( snapshot );
+    locked = snapshot.shaft_locked;
+    return true;
+}
+
+//#########################################################################
+// Check the axis once. Costs one transaction while idle, up to three
+// while a move is active. Returns true if a stall was detected
+// A failed read ends the poll without touching the counters, the
+// telemetry would still hold the value of an earlier poll
+//#########################################################################
+bool SERVO42C_RECOVERY::poll(){
+    bool locked;
+    if( !read_lock_state( locked ) ){
+        return false;
+    }
+    if( locked ){
+        recover( true );
+        return true;
+    }
+    if( !move_active ){
+        return false;
+    }
+    servo42c_telemetry snapshot;
+    if( config.angle_error_limit > 0 ){
+        if( !servo->read_input( MKS_INPUT_ANGLE_ERROR ) ){
+            return false;
+        }
+        servo->get_telemetry( snapshot );
+        int32_t error = snapshot.angle_error < 0 ? -snapshot.angle_error : snapshot.angle_error;
+        over_limit_count = error > config.angle_error_limit ? over_limit_count + 1 : 0;
+        if( over_limit_count >= config.angle_error_polls ){
+            recover( false );
+            return true;
+        }
+    }
+    int64_t encoder;
+    if( !read_encoder( encoder ) ){
+        return false;
+    }
+    if( encoder == last_encoder ){
+        if( ++settle_count >= MKS_RECOVERY_SETTLE_POLLS ){
+            move_active = false;
+        }
+    } else {
+        settle_count = 0;
+    }
+    last_encoder = encoder;
+    return false;
+}
+
+//#########################################################################
+// Release the lock (or stop the motor if it was an angle error stall),
+// back off and retry the steps that are left. Logs the event
+// Without an encoder reading at detection the steps left are unknown,
+// the move is not retried then. The event keeps the last known encoder
+//#########################################################################
+bool SERVO42C_RECOVERY::recover( bool protection ){
+    servo42c_lock_event event;
+    servo42c_telemetry  snapshot;
+    servo->get_telemetry( snapshot );
+    event.detected_at   = millis();
+    event.angle_error   = snapshot.angle_error;
+    event.encoder       = snapshot.encoder;
+    event.protection    = protection;
+    event.recovered     = false;
+    event.attempts      = 0;
+
+    uint32_t remaining = 0;
+    if( move_active && read_encoder( event.encoder ) ){
+        uint32_t done = steps_done( event.encoder );
+        remaining     = done < move_steps ? move_steps - done : 0;
+    }
+
+    while( event.attempts < config.max_attempts ){
+        ++event.attempts;
+        if( protection ){
+            servo->release_shaft_lock_protection();
+        } else {
+            servo->set_stop_motor();
+        }
+        vTaskDelay( MKS_RECOVERY_RELEASE_WAIT );
+        bool locked;
+        if( !read_lock_state( locked ) || locked ){
+            continue; // still locked or unknown
+        }
+        if( move_active && config.backoff_steps > 0 ){
+            servo->set_move_steps( move_dir == 1 ? 0 : 1, config.backoff_speed, config.backoff_steps, true );
+            if( !read_lock_state( locked ) || locked ){
+                protection = true;
+                continue; // locked again while backing off
+            }
+        }
+        if( move_active && config.retry_move && remaining > 0 ){
+            uint32_t steps = remaining + config.backoff_steps;
+            if( !read_encoder( move_start_encoder ) || !servo->set_move_steps( move_dir, move_speed, steps, false ) ){
+                continue;
+            }
+            last_encoder     = move_start_encoder;
+            settle_count     = 0;
+            over_limit_count = 0;
+            move_steps       = steps;
+        } else {
+            move_active = false;
+        }
+        event.recovered = true;
+        break;
+    }
+
+    if( !event.recovered ){
+        move_active = false;
+    }
+    event.recovery_time = millis() - event.detected_at;
+    log_event( event );
+    return event.recovered;
+}
+
+void SERVO42C_RECOVERY::log_event( const servo42c_lock_event &event ){
+    events[event_head] = event;
+    event_head = ( event_head + 1 ) % MKS_RECOVERY_LOG_SIZE;
+    if( event_count < MKS_RECOVERY_LOG_SIZE ){ ++event_count; }
+    if( callback != NULL ){
+        callback( servo, event );
+    }
+}
+
+uint8_t SERVO42C_RECOVERY::get_event_count(){
+    return event_count;
+}
+
+//#########################################################################
+// index 0 is the oldest event still in the log
+//#########################################################################
+bool SERVO42C_RECOVERY::get_event( uint8_t index, servo42c_lock_event &event ){
+    if( index >= event_count ){
+        return false;
+    }
+    uint8_t oldest = ( event_head + MKS_RECOVERY_LOG_SIZE - event_count ) % MKS_RECOVERY_LOG_SIZE;
+    event = events[ ( oldest + index ) % MKS_RECOVERY_LOG_SIZE ];
+    return true;
+}
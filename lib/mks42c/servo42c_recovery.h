@@ -0,0 +1,107 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_RECOVERY
+#define SERVO42C_MKS_RECOVERY
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c.h"
+
+static const uint8_t  MKS_RECOVERY_LOG_SIZE          = 8;
+static const uint32_t MKS_RECOVERY_BACKOFF_STEPS     = 200;
+static const uint8_t  MKS_RECOVERY_BACKOFF_SPEED     = 10;
+static const uint8_t  MKS_RECOVERY_MAX_ATTEMPTS      = 3;
+static const uint8_t  MKS_RECOVERY_SETTLE_POLLS      = 3;
+static const uint32_t MKS_RECOVERY_RELEASE_WAIT      = 50;  // ms to wait after a release before checking again
+
+//###############################################################
+// One stall event
+// recovery_time is the time from detection until the axis was
+// released and moving again or the engine gave up
+//###############################################################
+struct servo42c_lock_event {
+    uint32_t detected_at;   // millis() at detection
+    uint32_t recovery_time; // ms
+    int16_t  angle_error;   // raw angle error at detection, 0xFFFF = 360°
+    int64_t  encoder;       // encoder value at detection
+    uint8_t  attempts;
+    bool     protection;    // true = lock protection fired, false = angle error stall
+    bool     recovered;
+};
+
+//###############################################################
+// Recovery policy
+// angle_error_limit: raw angle error that counts as stall if it is
+//                    exceeded angle_error_polls times in a row
+//                    while a move is active. 0 = only use the
+//                    lock protection state
+//###############################################################
+struct servo42c_recovery_config {
+    uint32_t backoff_steps;
+    uint8_t  backoff_speed;
+    uint8_t  max_attempts;
+    uint16_t angle_error_limit;
+    uint8_t  angle_error_polls;
+    bool     retry_move;
+};
+
+typedef void (*servo42c_lock_callback)( SERVO42C *servo, const servo42c_lock_event &event );
+
+//###############################################################
+// Watches a single axis for shaft lock protection and stalls
+// poll() needs to be called periodically. Moves started with
+// move() are tracked and retried after a stall
+//###############################################################
+class SERVO42C_RECOVERY {
+
+    private:
+
+        SERVO42C *servo;
+        servo42c_recovery_config config;
+        servo42c_lock_callback   callback;
+
+        servo42c_lock_event events[MKS_RECOVERY_LOG_SIZE];
+        uint8_t             event_head;
+        uint8_t             event_count;
+
+        bool     move_active;
+        uint8_t  move_dir;
+        uint8_t  move_speed;
+        uint32_t move_steps;
+        int64_t  move_start_encoder;
+        int64_t  last_encoder;
+        uint8_t  settle_count;
+        uint8_t  over_limit_count;
+
+        uint32_t steps_done( int64_t encoder );
+        bool     read_encoder( int64_t &encoder );
+        bool     read_lock_state( bool &locked );
+        bool     recover( bool protection );
+        void     log_event( const servo42c_lock_event &event );
+
+    public:
+        SERVO42C_RECOVERY();
+        static servo42c_recovery_config default_config( void );
+        void    init( SERVO42C *servo, const servo42c_recovery_config &config = default_config() );
+        void    set_callback( servo42c_lock_callback callback );
+        bool    move( uint8_t dir, uint8_t speed, uint32_t steps );
+        bool    is_moving( void );
+        bool    poll( void );
+        uint8_t get_event_count( void );
+        bool    get_event( uint8_t index, servo42c_lock_event &event );
+
+};
+
+
+#endif
\ No newline at end of file
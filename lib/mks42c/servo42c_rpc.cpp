@@ -0,0 +1,272 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// RPC gateway
+//
+// Runs on the USB serial port and lets a host control all axes.
+// One request can contain many commands for many axes. The response
+// has one result per command in the same order
+//
+//####################################################################
+#include <Arduino.h>
+#include "servo42c_rpc.h"
+
+SERVO42C_RPC::SERVO42C_RPC() : port( NULL ), axes( NULL ), num_axes( 0 ), sequence( NULL ), subscribe_mask( 0 ), subscribe_period( 0 ), 
+                               last_telemetry( 0 ), requests( 0 ), errors( 0 ) {}
+
+void SERVO42C_RPC::init( Stream &_port, SERVO42C **_axes, uint8_t _num_axes ){
+    port     = &_port;
+    axes     = _axes;
+    num_axes = _num_axes > MKS_RPC_MAX_AXES ? MKS_RPC_MAX_AXES : _num_axes;
+}
+
+//#########################################################################
+// Sequences can be loaded and started over RPC if one is set. poll()
+// runs it too
+//#########################################################################
+void SERVO42C_RPC::set_sequence( SERVO42C_SEQUENCE *_sequence ){
+    sequence = _sequence;
+}
+
+uint32_t SERVO42C_RPC::get_request_count(){
+    return requests;
+}
+
+uint32_t SERVO42C_RPC::get_error_count(){
+    return errors + parser.crc_errors;
+}
+
+//#########################################################################
+// Process everything the host sent and send telemetry if it is due
+// Call it from loop() or a task
+//#########################################################################
+void SERVO42C_RPC::poll(){
+    while( port->available() > 0 ){
+        if( parser.feed( port->read() ) && parser.type == MKS_RPC_TYPE_REQUEST ){
+            handle_request();
+        }
+    }
+    if( subscribe_period > 0 && ( millis() - last_telemetry ) >= subscribe_period ){
+        last_telemetry = millis();
+        sample_telemetry();
+    }
+    if( sequence != NULL ){
+        sequence->poll();
+    }
+    if( telemetry_encoder.get_count() > 0 && ( millis() - telemetry_encoder.get_base_timestamp() ) >= MKS_RPC_TELEMETRY_MAX_AGE ){
+        flush_telemetry();
+    }
+}
+
+//#########################################################################
+// The payload is built in place after the 4 byte frame header
+//#########################################################################
+void SERVO42C_RPC::send_frame( uint8_t type, uint16_t length ){
+    size_t size = servo42c_rpc_build_frame( type, frame + 4, length, frame );
+    port->write( frame, size );
+}
+
+void SERVO42C_RPC::send_error( uint8_t seq, uint8_t code ){
+    ++errors;
+    frame[4] = seq;
+    frame[5] = code;
+    send_frame( MKS_RPC_TYPE_ERROR, 2 );
+}
+
+//#########################################################################
+// The whole batch is checked before the first command runs. A batch
+// with an error is answered with an error frame and nothing is executed
+//#########################################################################
+void SERVO42C_RPC::handle_request(){
+    ++requests;
+    const uint8_t *in     = parser.payload;
+    uint16_t       length = parser.length;
+    if( length < 1 ){
+        send_error( 0, MKS_RPC_ERROR_TRUNCATED );
+        return;
+    }
+    uint16_t used   = 1;
+    uint16_t pos    = 1;
+    while( pos < length ){
+        if( pos + 2 > length ){
+            send_error( in[0], MKS_RPC_ERROR_TRUNCATED );
+            return;
+        }
+        const servo42c_rpc_op_info *info = servo42c_rpc_find_op( in[pos + 1] );
+        if( info == NULL ){
+            send_error( in[0], MKS_RPC_ERROR_BAD_OP );
+            return;
+        }
+        if( pos + 2 + info->args_length > length ){
+            send_error( in[0], MKS_RPC_ERROR_TRUNCATED );
+            return;
+        }
+        if( used + 3 + info->result_length > MKS_RPC_MAX_PAYLOAD ){
+            send_error( in[0], MKS_RPC_ERROR_OVERFLOW );
+            return;
+        }
+        used += 3 + info->result_length;
+        pos  += 2 + info->args_length;
+    }
+    uint8_t *out = frame + 4;
+    used         = 0;
+    pos          = 1;
+    out[used++]  = in[0]; // seq
+    while( pos < length ){
+        uint8_t axis = in[pos];
+        uint8_t op   = in[pos + 1];
+        const servo42c_rpc_op_info *info = servo42c_rpc_find_op( op );
+        out[used]     = axis;
+        out[used + 1] = op;
+        memset( out + used + 3, 0, info->result_length );
+        out[used + 2] = execute( axis, op, in + pos + 2, out + used + 3 ) ? 1 : 0;
+        used += 3 + info->result_length;
+        pos  += 2 + info->args_length;
+    }
+    send_frame( MKS_RPC_TYPE_RESPONSE, used );
+}
+
+//#########################################################################
+// Run a single command. result has the size listed in MKS_RPC_OPS
+//#########################################################################
+bool SERVO42C_RPC::execute( uint8_t axis, uint8_t op, const uint8_t *args, uint8_t *result ){
+    if( op == MKS_RPC_OP_SUBSCRIBE ){
+        // samples already in the block still go out with it
+        subscribe_mask   = servo42c_get_u16( args );
+        subscribe_period = servo42c_get_u16( args + 2 );
+        last_telemetry   = millis();
+        return true;
+    }
+    switch( op ){
+        case MKS_RPC_OP_SEQ_LOAD:
+            return sequence != NULL && sequence->load( servo42c_get_u16( args ), args + 2, MKS_RPC_SEQ_CHUNK );
+        case MKS_RPC_OP_SEQ_START:
+            return sequence != NULL && sequence->start( servo42c_get_u16( args ) );
+        case MKS_RPC_OP_SEQ_STOP:
+            if( sequence != NULL ){ sequence->stop(); }
+            return sequence != NULL;
+        case MKS_RPC_OP_SEQ_STATUS:
+            if( sequence == NULL ){ return false; }
+            result[0] = (uint8_t)sequence->get_state();
+            servo42c_put_u16( result + 1, sequence->get_pc() );
+            return true;
+    }
+    if( axis >= num_axes ){
+        return false;
+    }
+    SERVO42C *servo = axes[axis];
+    servo42c_telemetry snapshot;
+    switch( op ){
+        case MKS_RPC_OP_GET_ENCODER:
+            if( !servo->read_input( MKS_INPUT_ENCODER ) ){ return false; }
+            servo->get_telemetry( snapshot );
+            servo42c_put_u64( result, (uint64_t)snapshot.encoder );
+            return true;
+        case MKS_RPC_OP_GET_PULSES:
+            if( !servo->read_input( MKS_INPUT_PULSES ) ){ return false; }
+            servo->get_telemetry( snapshot );
+            servo42c_put_u64( result, (uint64_t)snapshot.pulses );
+            return true;
+        case MKS_RPC_OP_GET_ANGLE_ERROR:
+            if( !servo->read_input( MKS_INPUT_ANGLE_ERROR ) ){ return false; }
+            servo->get_telemetry( snapshot );
+            servo42c_put_u16( result, (uint16_t)snapshot.angle_error );
+            return true;
+        case MKS_RPC_OP_GET_ENABLE:
+            if( !servo->read_input( MKS_INPUT_ENABLE_STATE ) ){ return false; }
+            servo->get_telemetry( snapshot );
+            result[0] = snapshot.enabled ? 1 : 0;
+            return true;
+        case MKS_RPC_OP_GET_LOCK:
+            if( !servo->read_input( MKS_INPUT_LOCK_STATE ) ){ return false; }
+            servo->get_telemetry( snapshot );
+            result[0] = snapshot.shaft_locked ? 1 : 0;
+            return true;
+        case MKS_RPC_OP_GET_POSITION: {
+            servo42c_position position;
+            bool success = servo->get_position( position );
+            servo42c_put_u64( result, (uint64_t)position.encoder );
+            servo42c_put_u64( result + 8, (uint64_t)position.pulses );
+            servo42c_put_u64( result + 16, (uint64_t)( position.following_valid ? position.following_error : MKS_RPC_NO_FOLLOWING ) );
+            return success;
+        }
+        case MKS_RPC_OP_SET_ENABLE:
+            return servo->set_enable( args[0] );
+        case MKS_RPC_OP_RUN_CONTINUOUS:
+            return servo->set_run_continuous( args[0], args[1] );
+        case MKS_RPC_OP_STOP:
+            return servo->set_stop_motor();
+        case MKS_RPC_OP_MOVE_STEPS:
+            return servo->set_move_steps( args[0], args[1], servo42c_get_u32( args + 2 ), false );
+        case MKS_RPC_OP_RELEASE_LOCK:
+            return servo->release_shaft_lock_protection();
+        case MKS_RPC_OP_GOTO_ZERO:
+            return servo->set_goto_zero();
+        case MKS_RPC_OP_SET_CURRENT:
+            return servo->set_max_current( servo42c_get_u16( args ) );
+        case MKS_RPC_OP_SET_SUBDIVISION:
+            return servo->set_subdivision( args[0] );
+        case MKS_RPC_OP_SET_ACC:
+            return servo->set_acc( servo42c_get_u16( args ) );
+        case MKS_RPC_OP_SET_MAX_TORQUE:
+            return servo->set_max_torque( servo42c_get_u16( args ) );
+        case MKS_RPC_OP_SET_PID:
+            return servo->set_pid_kp( servo42c_get_u16( args ) ) 
+                && servo->set_pid_ki( servo42c_get_u16( args + 2 ) ) 
+                && servo->set_pid_kd( servo42c_get_u16( args + 4 ) );
+    }
+    return false;
+}
+
+//#########################################################################
+// Reads encoder, pulses and angle error of every subscribed axis into the
+// current block. Enable and lock flags come from the last values seen,
+// they are not read here. An axis with a failed read is left out of this
+// round, the telemetry would still hold values of an earlier one
+//#########################################################################
+void SERVO42C_RPC::sample_telemetry(){
+    for( uint8_t axis = 0; axis < num_axes; ++axis ){
+        if( !( subscribe_mask & ( 1 << axis ) ) ){ continue; }
+        SERVO42C *servo = axes[axis];
+        if( !servo->read_input( MKS_INPUT_ENCODER ) || !servo->read_input( MKS_INPUT_PULSES ) 
+            || !servo->read_input( MKS_INPUT_ANGLE_ERROR ) ){
+            continue;
+        }
+        servo42c_telemetry snapshot;
+        servo->get_telemetry( snapshot );
+        servo42c_telemetry_sample sample;
+        // the sample time, not snapshot.timestamp. The block stores time
+        // deltas, they must not go back from one sample to the next
+        sample.timestamp   = millis();
+        sample.axis        = axis;
+        sample.flags       = ( snapshot.enabled ? MKS_TELEMETRY_FLAG_ENABLED : 0 ) | ( snapshot.shaft_locked ? MKS_TELEMETRY_FLAG_LOCKED : 0 );
+        sample.encoder     = snapshot.encoder;
+        sample.pulses      = snapshot.pulses;
+        sample.angle_error = snapshot.angle_error;
+        if( telemetry_encoder.get_count() == 0 ){
+            telemetry_encoder.begin( sample.timestamp );
+        }
+        telemetry_encoder.add( sample );
+        if( telemetry_encoder.is_full() ){
+            flush_telemetry();
+        }
+    }
+}
+
+void SERVO42C_RPC::flush_telemetry(){
+    memcpy( frame + 4, telemetry_encoder.finish(), MKS_TELEMETRY_BLOCK_SIZE );
+    send_frame( MKS_RPC_TYPE_TELEMETRY, MKS_TELEMETRY_BLOCK_SIZE );
+    telemetry_encoder.begin( millis() );
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_RPC
+#define SERVO42C_MKS_RPC
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c.h"
+#include "servo42c_rpc_protocol.h"
+#include "servo42c_telemetry_codec.h"
+#include "servo42c_sequence.h"
+
+static const uint8_t MKS_RPC_MAX_AXES = 10;
+
+//###############################################################
+// Telemetry frames carry one packed block as payload, see
+// servo42c_telemetry_codec.h. Samples are taken every subscribed
+// period and a block is sent as soon as it is full, that is
+// MKS_TELEMETRY_MAX_SAMPLES or no room left, or older than
+// MKS_RPC_TELEMETRY_MAX_AGE
+//###############################################################
+static const uint16_t MKS_RPC_TELEMETRY_MAX_AGE = 100; // ms
+
+//###############################################################
+// RPC server. Maps requests from the host to SERVO42C calls
+// Axis numbers are the index in the axes array passed to init()
+// poll() never blocks on the host port, only on the drives
+//###############################################################
+class SERVO42C_RPC {
+
+    private:
+
+        Stream    *port;
+        SERVO42C **axes;
+        uint8_t    num_axes;
+        SERVO42C_SEQUENCE *sequence;
+
+        servo42c_rpc_parser parser;
+        uint8_t  frame[MKS_RPC_MAX_FRAME];
+
+        uint16_t      subscribe_mask;
+        uint16_t      subscribe_period;
+        unsigned long last_telemetry;
+        SERVO42C_TELEMETRY_ENCODER telemetry_encoder;
+
+        uint32_t requests;
+        uint32_t errors;
+
+        void handle_request( void );
+        bool execute( uint8_t axis, uint8_t op, const uint8_t *args, uint8_t *result );
+        void send_frame( uint8_t type, uint16_t length );
+        void send_error( uint8_t seq, uint8_t code );
+        void sample_telemetry( void );
+        void flush_telemetry( void );
+
+    public:
+        SERVO42C_RPC();
+        void     init( Stream &port, SERVO42C **axes, uint8_t num_axes );
+        void     set_sequence( SERVO42C_SEQUENCE *sequence );
+        void     poll( void );
+        uint32_t get_request_count( void );
+        uint32_t get_error_count( void );
+
+};
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,225 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_RPC_PROTOCOL
+#define SERVO42C_MKS_RPC_PROTOCOL
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//###############################################################
+// Binary RPC protocol between a host and the MCU
+// Plain C++ without Arduino dependencies so the host side can
+// use the same definitions
+//
+// Frame:     0xA5, type, length (u16), payload, crc16 (u16)
+//            multi byte values are little endian, the crc is 
+//            CRC-16/CCITT-FALSE over type, length and payload
+//
+// Request:   seq, { axis, op, args... } repeated
+// Response:  seq, { axis, op, ok, result... } repeated
+// Telemetry: one block, see servo42c_telemetry_codec.h
+//
+// Args and results have a fixed length per op so a batch can be
+// parsed without extra length fields
+//###############################################################
+#include "stdint.h"
+#include <string.h>
+
+static const uint8_t  MKS_RPC_SOF              = 0xA5;
+static const uint16_t MKS_RPC_MAX_PAYLOAD      = 512;
+static const uint16_t MKS_RPC_FRAME_OVERHEAD   = 6;
+static const uint16_t MKS_RPC_MAX_FRAME        = MKS_RPC_MAX_PAYLOAD + MKS_RPC_FRAME_OVERHEAD;
+static const uint8_t  MKS_RPC_ALL_AXES         = 0xFF;
+static const int64_t  MKS_RPC_NO_FOLLOWING     = INT64_MIN; // following error of GET_POSITION without a reference
+
+// frame types
+static const uint8_t  MKS_RPC_TYPE_REQUEST     = 0x01;
+static const uint8_t  MKS_RPC_TYPE_RESPONSE    = 0x81;
+static const uint8_t  MKS_RPC_TYPE_TELEMETRY   = 0x82;
+static const uint8_t  MKS_RPC_TYPE_ERROR       = 0x8F;
+
+// ops
+#define MKS_RPC_OP_GET_ENCODER       0x01 // result: i64 encoder
+#define MKS_RPC_OP_GET_PULSES        0x02 // result: i64 pulses received
+#define MKS_RPC_OP_GET_ANGLE_ERROR   0x03 // result: i16 raw angle error
+#define MKS_RPC_OP_GET_ENABLE        0x04 // result: u8
+#define MKS_RPC_OP_GET_LOCK          0x05 // result: u8
+#define MKS_RPC_OP_GET_POSITION      0x06 // result: i64 encoder, i64 pulses, i64 following error or MKS_RPC_NO_FOLLOWING
+#define MKS_RPC_OP_SET_ENABLE        0x10 // args: u8
+#define MKS_RPC_OP_RUN_CONTINUOUS    0x11 // args: u8 dir, u8 speed
+#define MKS_RPC_OP_STOP              0x12
+#define MKS_RPC_OP_MOVE_STEPS        0x13 // args: u8 dir, u8 speed, u32 steps. Does not block
+#define MKS_RPC_OP_RELEASE_LOCK      0x14
+#define MKS_RPC_OP_GOTO_ZERO         0x15
+#define MKS_RPC_OP_SET_CURRENT       0x16 // args: u16 mA
+#define MKS_RPC_OP_SET_SUBDIVISION   0x17 // args: u8
+#define MKS_RPC_OP_SET_ACC           0x18 // args: u16
+#define MKS_RPC_OP_SET_MAX_TORQUE    0x19 // args: u16
+#define MKS_RPC_OP_SET_PID           0x1A // args: u16 kp, u16 ki, u16 kd
+#define MKS_RPC_OP_SUBSCRIBE         0x20 // args: u16 axis mask, u16 period ms (0 = stop). Axis is ignored
+#define MKS_RPC_OP_SEQ_LOAD          0x30 // args: u16 offset, 16 bytes code. Axis is ignored
+#define MKS_RPC_OP_SEQ_START         0x31 // args: u16 length. Axis is ignored
+#define MKS_RPC_OP_SEQ_STOP          0x32 // axis is ignored
+#define MKS_RPC_OP_SEQ_STATUS        0x33 // result: u8 state, u16 pc. Axis is ignored
+
+static const uint8_t  MKS_RPC_SEQ_CHUNK        = 16;
+
+// error codes in MKS_RPC_TYPE_ERROR frames (payload: seq, code)
+static const uint8_t  MKS_RPC_ERROR_BAD_OP     = 1;
+static const uint8_t  MKS_RPC_ERROR_TRUNCATED  = 2;
+static const uint8_t  MKS_RPC_ERROR_OVERFLOW   = 3;
+
+struct servo42c_rpc_op_info {
+    uint8_t op;
+    uint8_t args_length;
+    uint8_t result_length;
+};
+
+static const servo42c_rpc_op_info MKS_RPC_OPS[] = {
+    { MKS_RPC_OP_GET_ENCODER,     0, 8  },
+    { MKS_RPC_OP_GET_PULSES,      0, 8  },
+    { MKS_RPC_OP_GET_ANGLE_ERROR, 0, 2  },
+    { MKS_RPC_OP_GET_ENABLE,      0, 1  },
+    { MKS_RPC_OP_GET_LOCK,        0, 1  },
+    { MKS_RPC_OP_GET_POSITION,    0, 24 },
+    { MKS_RPC_OP_SET_ENABLE,      1, 0  },
+    { MKS_RPC_OP_RUN_CONTINUOUS,  2, 0  },
+    { MKS_RPC_OP_STOP,            0, 0  },
+    { MKS_RPC_OP_MOVE_STEPS,      6, 0  },
+    { MKS_RPC_OP_RELEASE_LOCK,    0, 0  },
+    { MKS_RPC_OP_GOTO_ZERO,       0, 0  },
+    { MKS_RPC_OP_SET_CURRENT,     2, 0  },
+    { MKS_RPC_OP_SET_SUBDIVISION, 1, 0  },
+    { MKS_RPC_OP_SET_ACC,         2, 0  },
+    { MKS_RPC_OP_SET_MAX_TORQUE,  2, 0  },
+    { MKS_RPC_OP_SET_PID,         6, 0  },
+    { MKS_RPC_OP_SUBSCRIBE,       4, 0  },
+    { MKS_RPC_OP_SEQ_LOAD,        18, 0 },
+    { MKS_RPC_OP_SEQ_START,       2, 0  },
+    { MKS_RPC_OP_SEQ_STOP,        0, 0  },
+    { MKS_RPC_OP_SEQ_STATUS,      0, 3  },
+};
+
+static inline const servo42c_rpc_op_info *servo42c_rpc_find_op( uint8_t op ){
+    for( size_t i = 0; i < sizeof( MKS_RPC_OPS ) / sizeof( MKS_RPC_OPS[0] ); ++i ){
+        if( MKS_RPC_OPS[i].op == op ){
+            return &MKS_RPC_OPS[i];
+        }
+    }
+    return NULL;
+}
+
+static inline void servo42c_put_u16( uint8_t *out, uint16_t value ){
+    out[0] = value & 0xFF;
+    out[1] = ( value >> 8 ) & 0xFF;
+}
+
+static inline void servo42c_put_u32( uint8_t *out, uint32_t value ){
+    servo42c_put_u16( out, value & 0xFFFF );
+    servo42c_put_u16( out + 2, value >> 16 );
+}
+
+static inline void servo42c_put_u64( uint8_t *out, uint64_t value ){
+    servo42c_put_u32( out, value & 0xFFFFFFFF );
+    servo42c_put_u32( out + 4, value >> 32 );
+}
+
+static inline uint16_t servo42c_get_u16( const uint8_t *in ){
+    return (uint16_t)( in[0] | ( in[1] << 8 ) );
+}
+
+static inline uint32_t servo42c_get_u32( const uint8_t *in ){
+    return (uint32_t)servo42c_get_u16( in ) | ( (uint32_t)servo42c_get_u16( in + 2 ) << 16 );
+}
+
+static inline uint64_t servo42c_get_u64( const uint8_t *in ){
+    return (uint64_t)servo42c_get_u32( in ) | ( (uint64_t)servo42c_get_u32( in + 4 ) << 32 );
+}
+
+static inline uint16_t servo42c_crc16( const uint8_t *data, size_t length, uint16_t crc = 0xFFFF ){
+    for( size_t i = 0; i < length; ++i ){
+        crc ^= (uint16_t)data[i] << 8;
+        for( uint8_t bit = 0; bit < 8; ++bit ){
+            crc = ( crc & 0x8000 ) ? (uint16_t)( ( crc << 1 ) ^ 0x1021 ) : (uint16_t)( crc << 1 );
+        }
+    }
+    return crc;
+}
+
+//###############################################################
+// Build a frame into out. out needs length + 6 bytes
+// returns the frame size
+//###############################################################
+static inline size_t servo42c_rpc_build_frame( uint8_t type, const uint8_t *payload, uint16_t length, uint8_t *out ){
+    out[0] = MKS_RPC_SOF;
+    out[1] = type;
+    servo42c_put_u16( out + 2, length );
+    if( length > 0 && payload != out + 4 ){
+        memmove( out + 4, payload, length );
+    }
+    servo42c_put_u16( out + 4 + length, servo42c_crc16( out + 1, 3 + length ) );
+    return 4 + length + 2;
+}
+
+//###############################################################
+// Byte wise frame parser. feed() returns true when a complete
+// frame with a valid crc is in type/payload/length. Garbage and
+// frames with a bad crc are skipped
+//###############################################################
+struct servo42c_rpc_parser {
+    uint8_t  type;
+    uint16_t length;
+    uint8_t  payload[MKS_RPC_MAX_PAYLOAD];
+    uint8_t  header[4];
+    uint8_t  crc_low;
+    uint16_t position;
+    uint16_t crc_errors;
+
+    servo42c_rpc_parser() : type( 0 ), length( 0 ), crc_low( 0 ), position( 0 ), crc_errors( 0 ) {}
+
+    bool feed( uint8_t byte ){
+        if( position == 0 ){
+            if( byte == MKS_RPC_SOF ){ header[position++] = byte; }
+            return false;
+        }
+        if( position < 4 ){
+            header[position++] = byte;
+            if( position == 4 ){
+                type   = header[1];
+                length = servo42c_get_u16( header + 2 );
+                if( length > MKS_RPC_MAX_PAYLOAD ){ position = 0; }
+            }
+            return false;
+        }
+        uint16_t index = position++ - 4;
+        if( index < length ){
+            payload[index] = byte;
+            return false;
+        }
+        if( index == length ){
+            crc_low = byte;
+            return false;
+        }
+        position = 0;
+        uint16_t crc = servo42c_crc16( header + 1, 3 );
+        crc = servo42c_crc16( payload, length, crc );
+        if( crc != (uint16_t)( crc_low | ( byte << 8 ) ) ){
+            ++crc_errors;
+            return false;
+        }
+        return true;
+    }
+};
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,254 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// Sequence interpreter
+//
+// A sequence is compiled on the host (tools/rpc_client) and loaded
+// in chunks over the RPC gateway, no reflash needed. The format is
+// described in servo42c_sequence_code.h
+//
+//####################################################################
+#include <Arduino.h>
+#include "servo42c_sequence.h"
+#include "servo42c_rpc_protocol.h"
+
+SERVO42C_SEQUENCE::SERVO42C_SEQUENCE() : axes( NULL ), num_axes( 0 ), code_length( 0 ), pc( 0 ), state( MKS_SEQUENCE_IDLE ), 
+                                         axis( 0 ), speed( 0 ), moved_axes( 0 ), delay_start( 0 ), delay_time( 0 ), 
+                                         last_encoder( 0 ), settle_count( 0 ), moved( false ), wait_start( 0 ), loop_depth( 0 ) {}
+
+void SERVO42C_SEQUENCE::init( SERVO42C **_axes, uint8_t _num_axes ){
+    axes     = _axes;
+    num_axes = _num_axes > MKS_SEQUENCE_MAX_AXES ? MKS_SEQUENCE_MAX_AXES : _num_axes;
+}
+
+servo42c_sequence_state SERVO42C_SEQUENCE::get_state(){
+    return state;
+}
+
+uint16_t SERVO42C_SEQUENCE::get_pc(){
+    return pc;
+}
+
+//#########################################################################
+// Copy a chunk of the program. Not possible while a sequence runs
+//#########################################################################
+bool SERVO42C_SEQUENCE::load( uint16_t offset, const uint8_t *data, uint16_t length ){
+    if( ( state != MKS_SEQUENCE_IDLE && state != MKS_SEQUENCE_DONE && state != MKS_SEQUENCE_ERROR ) 
+        || (uint32_t)offset + length > MKS_SEQUENCE_MAX_SIZE ){
+        return false;
+    }
+    memcpy( code + offset, data, length );
+    return true;
+}
+
+//#########################################################################
+// Check the header and every instruction once so the interpreter does not
+// need bounds checks for the operands and IF_ENC skips
+//#########################################################################
+bool SERVO42C_SEQUENCE::start( uint16_t length ){
+    if( length < MKS_SEQUENCE_HEADER_SIZE || length > MKS_SEQUENCE_MAX_SIZE || code[0] != 'S' || code[1] != 'Q' 
+        || code[2] != MKS_SEQUENCE_VERSION || code[3] > num_axes ){
+        return false;
+    }
+    code_length = MKS_SEQUENCE_HEADER_SIZE + servo42c_get_u16( code + 4 );
+    if( code_length > length ){
+        return false;
+    }
+    uint8_t boundary[MKS_SEQUENCE_MAX_SIZE / 8 + 1] = {0};
+    for( uint16_t position = MKS_SEQUENCE_HEADER_SIZE; position < code_length; ){
+        int operands = servo42c_sequence_operands( code[position] );
+        if( operands < 0 || position + 1 + operands > code_length ){
+            return false;
+        }
+        boundary[position >> 3] |= 1 << ( position & 7 );
+        position += 1 + operands;
+    }
+    boundary[code_length >> 3] |= 1 << ( code_length & 7 );
+    // IF_ENC skips have to land on an instruction and may not jump into
+    // or out of a loop
+    for( uint16_t position = MKS_SEQUENCE_HEADER_SIZE; position < code_length; position += 1 + servo42c_sequence_operands( code[position] ) ){
+        if( code[position] != MKS_SEQ_OP_IF_ENC ){
+            continue;
+        }
+        uint16_t from   = position + 1 + servo42c_sequence_operands( MKS_SEQ_OP_IF_ENC );
+        uint32_t target = (uint32_t)from + servo42c_get_u16( code + position + 1 + 16 );
+        if( target > code_length || !( ( boundary[target >> 3] >> ( target & 7 ) ) & 1 ) ){
+            return false;
+        }
+        int depth = 0;
+        for( uint16_t skipped = from; skipped < target && depth >= 0; skipped += 1 + servo42c_sequence_operands( code[skipped] ) ){
+            if( code[skipped] == MKS_SEQ_OP_LOOP ){ ++depth; }
+            else if( code[skipped] == MKS_SEQ_OP_ENDLOOP ){ --depth; }
+        }
+        if( depth != 0 ){
+            return false;
+        }
+    }
+    pc         = MKS_SEQUENCE_HEADER_SIZE;
+    axis       = 0;
+    speed      = 0;
+    loop_depth = 0;
+    moved_axes = 0;
+    state      = MKS_SEQUENCE_RUNNING;
+    return true;
+}
+
+//#########################################################################
+// Stop every axis the sequence moved. Moves to other axes before a WAIT
+// on the current one may still be running
+//#########################################################################
+void SERVO42C_SEQUENCE::stop(){
+    if( state == MKS_SEQUENCE_RUNNING || state == MKS_SEQUENCE_WAITING || state == MKS_SEQUENCE_DELAYING ){
+        for( uint8_t i = 0; i < num_axes; ++i ){
+            if( ( moved_axes >> i ) & 1 ){
+                axes[i]->set_stop_motor();
+            }
+        }
+    }
+    state = MKS_SEQUENCE_IDLE;
+}
+
+void SERVO42C_SEQUENCE::fail(){
+    state = MKS_SEQUENCE_ERROR;
+}
+
+//#########################################################################
+// Encoder read that can fail, get_encoder_value() returns 0 instead
+//#########################################################################
+bool SERVO42C_SEQUENCE::read_encoder( int64_t &encoder ){
+    if( !axes[axis]->read_input( MKS_INPUT_ENCODER ) ){
+        return false;
+    }
+    servo42c_telemetry snapshot;
+    axes[axis]->get_telemetry( snapshot );
+    encoder = snapshot.encoder;
+    return true;
+}
+
+//#########################################################################
+// A move counts as done if the encoder did not change for a few polls
+// after it was seen moving. The drive may start late, an axis that was
+// never seen moving needs MKS_SEQUENCE_MIN_MOVE_TIME. A failed read
+// stops the sequence with an error
+//#########################################################################
+bool SERVO42C_SEQUENCE::wait_done(){
+    int64_t encoder;
+    if( !read_encoder( encoder ) ){
+        fail();
+        return false;
+    }
+    int64_t delta   = encoder - last_encoder;
+    if( delta < 0 ){ delta = -delta; }
+    last_encoder = encoder;
+    if( delta > MKS_SEQUENCE_SETTLE_TOLERANCE ){
+        moved = true;
+    }
+    bool may_settle = moved || ( millis() - wait_start ) >= MKS_SEQUENCE_MIN_MOVE_TIME;
+    settle_count = delta <= MKS_SEQUENCE_SETTLE_TOLERANCE && may_settle ? settle_count + 1 : 0;
+    return settle_count >= MKS_SEQUENCE_SETTLE_POLLS;
+}
+
+//#########################################################################
+// Run instructions until the sequence has to wait or is done
+//#########################################################################
+void SERVO42C_SEQUENCE::poll(){
+    if( state == MKS_SEQUENCE_WAITING ){
+        if( !wait_done() ){ return; }
+        state = MKS_SEQUENCE_RUNNING;
+    } else if( state == MKS_SEQUENCE_DELAYING ){
+        if( ( millis() - delay_start ) < delay_time ){ return; }
+        state = MKS_SEQUENCE_RUNNING;
+    }
+    while( state == MKS_SEQUENCE_RUNNING && step() ){}
+}
+
+//#########################################################################
+// Execute one instruction. Returns false if the sequence has to wait
+//#########################################################################
+bool SERVO42C_SEQUENCE::step(){
+    if( pc >= code_length ){
+        state = MKS_SEQUENCE_DONE;
+        return false;
+    }
+    uint8_t        op       = code[pc];
+    const uint8_t *operands = code + pc + 1;
+    pc += 1 + servo42c_sequence_operands( op );
+    SERVO42C *servo = axes[axis];
+    switch( op ){
+        case MKS_SEQ_OP_END:
+            state = MKS_SEQUENCE_DONE;
+            return false;
+        case MKS_SEQ_OP_AXIS:
+            if( operands[0] >= num_axes ){ fail(); return false; }
+            axis = operands[0];
+            return true;
+        case MKS_SEQ_OP_SPEED:
+            speed = operands[0];
+            return true;
+        case MKS_SEQ_OP_MOVE:
+            moved_axes |= 1 << axis; // also if it failed, the drive may have taken it
+            if( !servo->set_move_steps( operands[0], speed, servo42c_get_u32( operands + 1 ), false ) ){ fail(); return false; }
+            return true;
+        case MKS_SEQ_OP_WAIT:
+            if( !read_encoder( last_encoder ) ){ fail(); return false; }
+            settle_count = 0;
+            moved        = false;
+            wait_start   = millis();
+            state        = MKS_SEQUENCE_WAITING;
+            return false;
+        case MKS_SEQ_OP_ENABLE:
+            if( !servo->set_enable( operands[0] ) ){ fail(); return false; }
+            return true;
+        case MKS_SEQ_OP_DELAY:
+            delay_start = millis();
+            delay_time  = servo42c_get_u32( operands );
+            state       = MKS_SEQUENCE_DELAYING;
+            return false;
+        case MKS_SEQ_OP_LOOP:
+            if( loop_depth >= MKS_SEQUENCE_MAX_LOOPS ){ fail(); return false; }
+            loop_start[loop_depth] = pc;
+            loop_count[loop_depth] = servo42c_get_u16( operands );
+            ++loop_depth;
+            return true;
+        case MKS_SEQ_OP_ENDLOOP:
+            if( loop_depth == 0 ){ fail(); return false; }
+            if( loop_count[loop_depth - 1] > 1 ){
+                --loop_count[loop_depth - 1];
+                pc = loop_start[loop_depth - 1];
+            } else {
+                --loop_depth;
+            }
+            return true;
+        case MKS_SEQ_OP_IF_ENC: {
+            int64_t min     = (int64_t)servo42c_get_u64( operands );
+            int64_t max     = (int64_t)servo42c_get_u64( operands + 8 );
+            int64_t encoder;
+            if( !read_encoder( encoder ) ){ fail(); return false; }
+            if( encoder < min || encoder > max ){
+                pc += servo42c_get_u16( operands + 16 );
+            }
+            return true;
+        }
+        case MKS_SEQ_OP_RUN:
+            moved_axes |= 1 << axis;
+            if( !servo->set_run_continuous( operands[0], speed ) ){ fail(); return false; }
+            return true;
+        case MKS_SEQ_OP_STOP:
+            if( !servo->set_stop_motor() ){ fail(); return false; }
+            return true;
+    }
+    fail();
+    return false;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_SEQUENCE
+#define SERVO42C_MKS_SEQUENCE
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c.h"
+#include "servo42c_sequence_code.h"
+
+static const uint8_t  MKS_SEQUENCE_MAX_AXES      = 10;
+static const uint8_t  MKS_SEQUENCE_SETTLE_POLLS  = 3;
+static const uint16_t MKS_SEQUENCE_SETTLE_TOLERANCE = 16;
+static const uint32_t MKS_SEQUENCE_MIN_MOVE_TIME    = 500; // ms before WAIT accepts an axis that never moved
+
+enum servo42c_sequence_state {
+    MKS_SEQUENCE_IDLE     = 0,
+    MKS_SEQUENCE_RUNNING  = 1,
+    MKS_SEQUENCE_WAITING  = 2,
+    MKS_SEQUENCE_DELAYING = 3,
+    MKS_SEQUENCE_DONE     = 4,
+    MKS_SEQUENCE_ERROR    = 5
+};
+
+//###############################################################
+// Runs a sequence loaded as bytecode. poll() runs instructions
+// until it has to wait (WAIT, DELAY) and returns, so it never
+// blocks longer than the UART transactions it issues. Commands
+// for different axes between two waits go out back to back
+//###############################################################
+class SERVO42C_SEQUENCE {
+
+    private:
+
+        SERVO42C **axes;
+        uint8_t    num_axes;
+
+        uint8_t  code[MKS_SEQUENCE_MAX_SIZE];
+        uint16_t code_length;
+        uint16_t pc;
+        servo42c_sequence_state state;
+
+        uint8_t  axis;
+        uint8_t  speed;
+        uint16_t moved_axes; // bit per axis a MOVE or RUN was sent to, stop() stops them all
+        unsigned long delay_start;
+        uint32_t delay_time;
+        int64_t  last_encoder;
+        uint8_t  settle_count;
+        bool     moved;
+        unsigned long wait_start;
+
+        uint16_t loop_start[MKS_SEQUENCE_MAX_LOOPS];
+        uint16_t loop_count[MKS_SEQUENCE_MAX_LOOPS];
+        uint8_t  loop_depth;
+
+        bool     step( void );
+        bool     wait_done( void );
+        bool     read_encoder( int64_t &encoder );
+        void     fail( void );
+
+    public:
+        SERVO42C_SEQUENCE();
+        void     init( SERVO42C **axes, uint8_t num_axes );
+        bool     load( uint16_t offset, const uint8_t *data, uint16_t length );
+        bool     start( uint16_t length );
+        void     stop( void );
+        void     poll( void );
+        servo42c_sequence_state get_state( void );
+        uint16_t get_pc( void );
+
+};
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_SEQUENCE_CODE
+#define SERVO42C_MKS_SEQUENCE_CODE
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//###############################################################
+// Sequence bytecode
+// Plain C++ without Arduino dependencies, shared with the host
+// side compiler
+//
+// Header:      'S', 'Q', version, axis count used, u16 code length
+// Instruction: op byte followed by the operands, little endian
+//
+//   END                               stop the sequence
+//   AXIS      u8 axis                 select the axis for the next instructions
+//   SPEED     u8 speed                speed for MOVE and RUN (0 - 127)
+//   MOVE      u8 dir, u32 steps       start a move, does not wait
+//   WAIT                              wait until the axis moved and stopped
+//   ENABLE    u8 value                enable / disable the axis
+//   DELAY     u32 ms
+//   LOOP      u16 count               repeat until ENDLOOP count times
+//   ENDLOOP
+//   IF_ENC    i64 min, i64 max, u16 n skip n code bytes if the encoder
+//                                     is outside of min - max
+//   RUN       u8 dir                  run continuous with SPEED
+//   STOP                              stop the axis
+//###############################################################
+#include "stdint.h"
+
+static const uint8_t  MKS_SEQUENCE_VERSION     = 1;
+static const uint8_t  MKS_SEQUENCE_HEADER_SIZE = 6;
+static const uint16_t MKS_SEQUENCE_MAX_SIZE    = 1024;
+static const uint8_t  MKS_SEQUENCE_MAX_LOOPS   = 4;   // nesting depth
+
+#define MKS_SEQ_OP_END       0x00
+#define MKS_SEQ_OP_AXIS      0x01
+#define MKS_SEQ_OP_SPEED     0x02
+#define MKS_SEQ_OP_MOVE      0x03
+#define MKS_SEQ_OP_WAIT      0x04
+#define MKS_SEQ_OP_ENABLE    0x05
+#define MKS_SEQ_OP_DELAY     0x06
+#define MKS_SEQ_OP_LOOP      0x07
+#define MKS_SEQ_OP_ENDLOOP   0x08
+#define MKS_SEQ_OP_IF_ENC    0x09
+#define MKS_SEQ_OP_RUN       0x0A
+#define MKS_SEQ_OP_STOP      0x0B
+
+//###############################################################
+// Operand bytes per op, -1 = unknown op
+//###############################################################
+static inline int servo42c_sequence_operands( uint8_t op ){
+    switch( op ){
+        case MKS_SEQ_OP_END:     return 0;
+        case MKS_SEQ_OP_AXIS:    return 1;
+        case MKS_SEQ_OP_SPEED:   return 1;
+        case MKS_SEQ_OP_MOVE:    return 5;
+        case MKS_SEQ_OP_WAIT:    return 0;
+        case MKS_SEQ_OP_ENABLE:  return 1;
+        case MKS_SEQ_OP_DELAY:   return 4;
+        case MKS_SEQ_OP_LOOP:    return 2;
+        case MKS_SEQ_OP_ENDLOOP: return 0;
+        case MKS_SEQ_OP_IF_ENC:  return 18;
+        case MKS_SEQ_OP_RUN:     return 1;
+        case MKS_SEQ_OP_STOP:    return 0;
+    }
+    return -1;
+}
+
+
+#endif
\ No newline at end of file
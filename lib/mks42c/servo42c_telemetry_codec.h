@@ -0,0 +1,252 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_TELEMETRY_CODEC
+#define SERVO42C_MKS_TELEMETRY_CODEC
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//###############################################################
+// Packed telemetry blocks
+// Plain C++ without Arduino dependencies, used by the MCU to
+// encode and by the host to decode
+//
+// Block (MKS_TELEMETRY_BLOCK_SIZE bytes):
+//   u16 seq, u8 sample count, u32 base timestamp (ms),
+//   samples, zero padding, u16 crc16 over everything before it
+//
+// Sample:
+//   u8 axis (bit 0-3) and flags (bit 4-7)
+//   varint    timestamp delta to the previous sample in the block
+//   zigzag varint deltas of encoder, pulses and angle error to
+//   the previous sample of the same axis in the block
+//
+// References reset with every block so a lost block does not
+// break the ones after it. An idle axis costs 5 bytes per
+// sample, a moving one 7-10 bytes. A block is full when a worst
+// case sample does not fit or it has MKS_TELEMETRY_MAX_SAMPLES
+//###############################################################
+#include "servo42c_rpc_protocol.h"
+
+static const uint16_t MKS_TELEMETRY_BLOCK_SIZE   = 128;
+static const uint8_t  MKS_TELEMETRY_HEADER_SIZE  = 7;
+static const uint8_t  MKS_TELEMETRY_MAX_SAMPLE   = 1 + 5 + 10 + 10 + 3;
+static const uint8_t  MKS_TELEMETRY_MAX_AXES     = 16;
+static const uint8_t  MKS_TELEMETRY_MAX_SAMPLES  = 16;
+static const uint8_t  MKS_TELEMETRY_FLAG_ENABLED = 0x01;
+static const uint8_t  MKS_TELEMETRY_FLAG_LOCKED  = 0x02;
+
+struct servo42c_telemetry_sample {
+    uint32_t timestamp;
+    uint8_t  axis;
+    uint8_t  flags;
+    int64_t  encoder;
+    int64_t  pulses;
+    int16_t  angle_error;
+};
+
+static inline size_t servo42c_put_varint( uint8_t *out, uint64_t value ){
+    size_t length = 0;
+    while( value >= 0x80 ){
+        out[length++] = (uint8_t)( value | 0x80 );
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+static inline size_t servo42c_put_zigzag( uint8_t *out, int64_t value ){
+    return servo42c_put_varint( out, ( (uint64_t)value << 1 ) ^ (uint64_t)( value >> 63 ) );
+}
+
+//###############################################################
+// returns the number of bytes used, 0 if the varint does not
+// end before end
+//###############################################################
+static inline size_t servo42c_get_varint( const uint8_t *in, const uint8_t *end, uint64_t &value ){
+    value = 0;
+    for( size_t i = 0; i < 10 && in + i < end; ++i ){
+        value |= (uint64_t)( in[i] & 0x7F ) << ( 7 * i );
+        if( !( in[i] & 0x80 ) ){
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static inline size_t servo42c_get_zigzag( const uint8_t *in, const uint8_t *end, int64_t &value ){
+    uint64_t raw;
+    size_t length = servo42c_get_varint( in, end, raw );
+    value = (int64_t)( raw >> 1 ) ^ -(int64_t)( raw & 1 );
+    return length;
+}
+
+struct servo42c_telemetry_reference {
+    int64_t encoder;
+    int64_t pulses;
+    int16_t angle_error;
+};
+
+//###############################################################
+// Fills one block. Send it with finish() once is_full(), add()
+// returns false if it is called on a full block anyway
+//###############################################################
+class SERVO42C_TELEMETRY_ENCODER {
+
+    private:
+
+        uint8_t  block[MKS_TELEMETRY_BLOCK_SIZE];
+        uint16_t used;
+        uint16_t seq;
+        uint8_t  count;
+        uint32_t last_timestamp;
+        servo42c_telemetry_reference reference[MKS_TELEMETRY_MAX_AXES];
+
+    public:
+        SERVO42C_TELEMETRY_ENCODER() : seq( 0 ) {
+            begin( 0 );
+        }
+
+        void begin( uint32_t timestamp ){
+            memset( block, 0, sizeof( block ) );
+            memset( reference, 0, sizeof( reference ) );
+            used           = MKS_TELEMETRY_HEADER_SIZE;
+            count          = 0;
+            last_timestamp = timestamp;
+            servo42c_put_u32( block + 3, timestamp );
+        }
+
+        uint8_t get_count( void ){
+            return count;
+        }
+
+        uint32_t get_base_timestamp( void ){
+            return servo42c_get_u32( block + 3 );
+        }
+
+        bool is_full( void ){
+            return used + MKS_TELEMETRY_MAX_SAMPLE > MKS_TELEMETRY_BLOCK_SIZE - 2 || count >= MKS_TELEMETRY_MAX_SAMPLES;
+        }
+
+        bool add( const servo42c_telemetry_sample &sample ){
+            if( is_full() ){
+                return false;
+            }
+            servo42c_telemetry_reference &ref = reference[sample.axis & 0x0F];
+            block[used++] = ( sample.axis & 0x0F ) | ( sample.flags << 4 );
+            used += servo42c_put_varint( block + used, sample.timestamp - last_timestamp );
+            used += servo42c_put_zigzag( block + used, sample.encoder - ref.encoder );
+            used += servo42c_put_zigzag( block + used, sample.pulses - ref.pulses );
+            used += servo42c_put_zigzag( block + used, (int64_t)sample.angle_error - ref.angle_error );
+            last_timestamp  = sample.timestamp;
+            ref.encoder     = sample.encoder;
+            ref.pulses      = sample.pulses;
+            ref.angle_error = sample.angle_error;
+            ++count;
+            return true;
+        }
+
+        //###########################################################
+        // Write header and crc. The block is valid until begin()
+        //###########################################################
+        const uint8_t *finish( void ){
+            servo42c_put_u16( block, seq++ );
+            block[2] = count;
+            servo42c_put_u16( block + MKS_TELEMETRY_BLOCK_SIZE - 2, servo42c_crc16( block, MKS_TELEMETRY_BLOCK_SIZE - 2 ) );
+            return block;
+        }
+
+};
+
+//###############################################################
+// Decodes blocks and counts lost ones by the sequence number
+//###############################################################
+class SERVO42C_TELEMETRY_DECODER {
+
+    private:
+
+        bool     started;
+        uint16_t next_seq;
+        uint32_t lost;
+        uint32_t corrupt;
+
+    public:
+        SERVO42C_TELEMETRY_DECODER() : started( false ), next_seq( 0 ), lost( 0 ), corrupt( 0 ) {}
+
+        uint32_t get_lost( void ){
+            return lost;
+        }
+
+        uint32_t get_corrupt( void ){
+            return corrupt;
+        }
+
+        //###########################################################
+        // returns the number of samples or -1 if the block is bad
+        // samples needs room for 255 entries to be safe
+        //###########################################################
+        int decode( const uint8_t *block, size_t length, servo42c_telemetry_sample *samples, int max_samples ){
+            if( length != MKS_TELEMETRY_BLOCK_SIZE || 
+                servo42c_crc16( block, MKS_TELEMETRY_BLOCK_SIZE - 2 ) != servo42c_get_u16( block + MKS_TELEMETRY_BLOCK_SIZE - 2 ) ){
+                ++corrupt;
+                return -1;
+            }
+            uint16_t seq = servo42c_get_u16( block );
+            if( started ){
+                lost += (uint16_t)( seq - next_seq );
+            }
+            started  = true;
+            next_seq = seq + 1;
+
+            servo42c_telemetry_reference reference[MKS_TELEMETRY_MAX_AXES];
+            memset( reference, 0, sizeof( reference ) );
+            uint8_t        count     = block[2];
+            uint32_t       timestamp = servo42c_get_u32( block + 3 );
+            const uint8_t *in        = block + MKS_TELEMETRY_HEADER_SIZE;
+            const uint8_t *end       = block + MKS_TELEMETRY_BLOCK_SIZE - 2;
+            int            decoded   = 0;
+            for( uint8_t i = 0; i < count && decoded < max_samples; ++i ){
+                if( in >= end ){ break; }
+                servo42c_telemetry_sample &sample = samples[decoded];
+                uint64_t time_delta;
+                int64_t  encoder_delta, pulses_delta, error_delta;
+                sample.axis  = *in & 0x0F;
+                sample.flags = *in >> 4;
+                ++in;
+                size_t length;
+                if( !( length = servo42c_get_varint( in, end, time_delta ) ) ){ break; }
+                in += length;
+                if( !( length = servo42c_get_zigzag( in, end, encoder_delta ) ) ){ break; }
+                in += length;
+                if( !( length = servo42c_get_zigzag( in, end, pulses_delta ) ) ){ break; }
+                in += length;
+                if( !( length = servo42c_get_zigzag( in, end, error_delta ) ) ){ break; }
+                in += length;
+                servo42c_telemetry_reference &ref = reference[sample.axis];
+                timestamp         += (uint32_t)time_delta;
+                ref.encoder       += encoder_delta;
+                ref.pulses        += pulses_delta;
+                ref.angle_error    = (int16_t)( ref.angle_error + error_delta );
+                sample.timestamp   = timestamp;
+                sample.encoder     = ref.encoder;
+                sample.pulses      = ref.pulses;
+                sample.angle_error = ref.angle_error;
+                ++decoded;
+            }
+            return decoded;
+        }
+
+};
+
+
+#endif
\ No newline at end of file
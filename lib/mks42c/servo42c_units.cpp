@@ -0,0 +1,90 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c_units.h"
+
+SERVO42C_UNITS::SERVO42C_UNITS() : servo( NULL ), um_per_rev( 0 ) {}
+
+//#########################################################################
+// um_per_rev: travel per motor revolution in um, 0 = no linear units
+//#########################################################################
+void SERVO42C_UNITS::init( SERVO42C *_servo, uint32_t _um_per_rev ){
+    servo      = _servo;
+    um_per_rev = _um_per_rev;
+}
+
+//#########################################################################
+// Subdivision as a plain number 1 - 256 instead of the raw byte
+//#########################################################################
+bool SERVO42C_UNITS::set_microsteps( uint16_t microsteps ){
+    if( microsteps < 1 || microsteps > 256 ){
+        return false;
+    }
+    return servo->set_subdivision( microsteps == 256 ? 0 : (uint8_t)microsteps );
+}
+
+int64_t SERVO42C_UNITS::mdeg_to_steps( int64_t mdeg ){
+    return servo42c_div_round( mdeg * servo->get_steps_per_revolution(), MKS_MDEG_PER_REV );
+}
+
+int64_t SERVO42C_UNITS::steps_to_mdeg( int64_t steps ){
+    return servo42c_div_round( steps * MKS_MDEG_PER_REV, servo->get_steps_per_revolution() );
+}
+
+int64_t SERVO42C_UNITS::um_to_steps( int64_t um ){
+    return um_per_rev == 0 ? 0 : servo42c_div_round( um * servo->get_steps_per_revolution(), um_per_rev );
+}
+
+int64_t SERVO42C_UNITS::steps_to_um( int64_t steps ){
+    return um_per_rev == 0 ? 0 : servo42c_div_round( steps * um_per_rev, servo->get_steps_per_revolution() );
+}
+
+int64_t SERVO42C_UNITS::encoder_to_mdeg( int64_t encoder ){
+    return servo42c_div_round( encoder * MKS_MDEG_PER_REV, MKS_ENCODER_PER_REV );
+}
+
+int64_t SERVO42C_UNITS::encoder_to_um( int64_t encoder ){
+    return um_per_rev == 0 ? 0 : servo42c_div_round( encoder * um_per_rev, MKS_ENCODER_PER_REV );
+}
+
+//#########################################################################
+// Speed value for set_run_continuous / set_move_steps, clamped to 0 - 127
+//#########################################################################
+uint8_t SERVO42C_UNITS::rpm_to_speed( uint32_t rpm ){
+    return servo42c_clamp_speed( servo42c_div_round( (int64_t)rpm * servo->get_steps_per_revolution(), MKS_SPEED_RPM_FACTOR ) );
+}
+
+uint32_t SERVO42C_UNITS::speed_to_rpm( uint8_t speed ){
+    return (uint32_t)servo42c_div_round( (int64_t)speed * MKS_SPEED_RPM_FACTOR, servo->get_steps_per_revolution() );
+}
+
+//#########################################################################
+// Relative moves. Negative values move with dir 1. Fails if the
+// distance doesn't fit into a single move command
+//#########################################################################
+bool SERVO42C_UNITS::move( int64_t steps, uint8_t speed, bool blocking ){
+    uint8_t dir = steps < 0 ? 1 : 0;
+    if( steps < 0 ){ steps = -steps; }
+    if( steps > (int64_t)UINT32_MAX ){
+        return false;
+    }
+    return steps == 0 ? true : servo->set_move_steps( dir, speed, (uint32_t)steps, blocking );
+}
+
+bool SERVO42C_UNITS::move_mdeg( int64_t mdeg, uint8_t speed, bool blocking ){
+    return move( mdeg_to_steps( mdeg ), speed, blocking );
+}
+
+bool SERVO42C_UNITS::move_um( int64_t um, uint8_t speed, bool blocking ){
+    return um_per_rev != 0 && move( um_to_steps( um ), speed, blocking );
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_UNITS
+#define SERVO42C_MKS_UNITS
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c.h"
+
+//###############################################################
+// Unit conversion without floats
+// Angles are in millidegrees, lengths in micrometers (um), the
+// library works in microsteps and encoder counts (65536 per
+// revolution). um_per_rev is the travel of one motor revolution:
+// lead of the screw or pulley teeth * belt pitch, divided by the
+// gear ratio. All conversions round half away from zero
+//
+// SERVO42C_UNITS_STATIC resolves the scale at compile time if the
+// motor type and subdivision are fixed in the firmware.
+// SERVO42C_UNITS reads the subdivision and motor type last applied
+// to the drive and follows set_subdivision() / set_motor_type()
+//###############################################################
+static const int64_t MKS_MDEG_PER_REV     = 360000;
+static const int64_t MKS_ENCODER_PER_REV  = 65536;
+static const int64_t MKS_SPEED_RPM_FACTOR = 30000; // Vrpm = speed * 30000 / steps per revolution
+
+static inline constexpr int64_t servo42c_div_round( int64_t value, int64_t divisor ){
+    return value >= 0 ? ( value + divisor / 2 ) / divisor : -( ( -value + divisor / 2 ) / divisor );
+}
+
+static inline constexpr uint8_t servo42c_clamp_speed( int64_t speed ){
+    return speed < 0 ? 0 : ( speed > 127 ? 127 : (uint8_t)speed );
+}
+
+//###############################################################
+// FULL_STEPS: 200 = 1.8° motor, 400 = 0.9° motor
+// MICROSTEPS: 1 - 256
+// UM_PER_REV: 0 if the axis has no linear units
+//###############################################################
+template< uint16_t FULL_STEPS, uint16_t MICROSTEPS, uint32_t UM_PER_REV = 0 >
+class SERVO42C_UNITS_STATIC {
+
+    static_assert( FULL_STEPS == 200 || FULL_STEPS == 400, "the 42C only knows 1.8° and 0.9° motors" );
+    static_assert( MICROSTEPS >= 1 && MICROSTEPS <= 256, "subdivision range is 1 - 256" );
+
+    public:
+        static constexpr int64_t steps_per_rev = (int64_t)FULL_STEPS * MICROSTEPS;
+        static constexpr uint8_t motor_type    = FULL_STEPS == 400 ? 0 : 1;
+        static constexpr uint8_t subdivision   = MICROSTEPS == 256 ? 0 : (uint8_t)MICROSTEPS;
+
+        static constexpr int64_t mdeg_to_steps( int64_t mdeg ){ return servo42c_div_round( mdeg * steps_per_rev, MKS_MDEG_PER_REV ); }
+        static constexpr int64_t steps_to_mdeg( int64_t steps ){ return servo42c_div_round( steps * MKS_MDEG_PER_REV, steps_per_rev ); }
+        static constexpr int64_t um_to_steps( int64_t um ){ return check_linear() ? servo42c_div_round( um * steps_per_rev, UM_PER_REV ) : 0; }
+        static constexpr int64_t steps_to_um( int64_t steps ){ return check_linear() ? servo42c_div_round( steps * UM_PER_REV, steps_per_rev ) : 0; }
+        static constexpr int64_t encoder_to_mdeg( int64_t encoder ){ return servo42c_div_round( encoder * MKS_MDEG_PER_REV, MKS_ENCODER_PER_REV ); }
+        static constexpr int64_t encoder_to_um( int64_t encoder ){ return check_linear() ? servo42c_div_round( encoder * UM_PER_REV, MKS_ENCODER_PER_REV ) : 0; }
+        static constexpr uint8_t rpm_to_speed( uint32_t rpm ){ return servo42c_clamp_speed( servo42c_div_round( (int64_t)rpm * steps_per_rev, MKS_SPEED_RPM_FACTOR ) ); }
+        static constexpr uint32_t speed_to_rpm( uint8_t speed ){ return (uint32_t)servo42c_div_round( (int64_t)speed * MKS_SPEED_RPM_FACTOR, steps_per_rev ); }
+
+        // applies motor type and subdivision so the drive matches the scale
+        static bool configure( SERVO42C *servo ){
+            return servo->set_motor_type( motor_type ) && servo->set_subdivision( subdivision );
+        }
+
+    private:
+        static constexpr bool check_linear( void ){ return UM_PER_REV > 0; }
+
+};
+
+// C++11 needs the definitions if the constants are bound to references
+template< uint16_t FULL_STEPS, uint16_t MICROSTEPS, uint32_t UM_PER_REV >
+constexpr int64_t SERVO42C_UNITS_STATIC<FULL_STEPS, MICROSTEPS, UM_PER_REV>::steps_per_rev;
+template< uint16_t FULL_STEPS, uint16_t MICROSTEPS, uint32_t UM_PER_REV >
+constexpr uint8_t SERVO42C_UNITS_STATIC<FULL_STEPS, MICROSTEPS, UM_PER_REV>::motor_type;
+template< uint16_t FULL_STEPS, uint16_t MICROSTEPS, uint32_t UM_PER_REV >
+constexpr uint8_t SERVO42C_UNITS_STATIC<FULL_STEPS, MICROSTEPS, UM_PER_REV>::subdivision;
+
+//###############################################################
+// Runtime conversion for axes configured at run time
+//###############################################################
+class SERVO42C_UNITS {
+
+    private:
+
+        SERVO42C *servo;
+        uint32_t  um_per_rev;
+
+        bool      move( int64_t steps, uint8_t speed, bool blocking );
+
+    public:
+        SERVO42C_UNITS();
+        void     init( SERVO42C *servo, uint32_t um_per_rev = 0 );
+        bool     set_microsteps( uint16_t microsteps );
+        int64_t  mdeg_to_steps( int64_t mdeg );
+        int64_t  steps_to_mdeg( int64_t steps );
+        int64_t  um_to_steps( int64_t um );
+        int64_t  steps_to_um( int64_t steps );
+        int64_t  encoder_to_mdeg( int64_t encoder );
+        int64_t  encoder_to_um( int64_t encoder );
+        uint8_t  rpm_to_speed( uint32_t rpm );
+        uint32_t speed_to_rpm( uint8_t speed );
+        bool     move_mdeg( int64_t mdeg, uint8_t speed, bool blocking = false );
+        bool     move_um( int64_t um, uint8_t speed, bool blocking = false );
+
+};
+
+
+#endif
\ No newline at end of file
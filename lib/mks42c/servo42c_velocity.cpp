@@ -0,0 +1,282 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c_velocity.h"
+
+SERVO42C_VELOCITY::SERVO42C_VELOCITY() : num_axes( 0 ), bus_locked( false ), wake_waiting( false ), window_start( 0 ), byte_time( 0 ), ack_length( 0 ) {
+    portMUX_INITIALIZE( &mux );
+}
+
+//#########################################################################
+// servos: axes on one UART, the index is the axis number used later
+// baudrate: of that UART, used for the ack deadlines
+//#########################################################################
+bool SERVO42C_VELOCITY::init( SERVO42C **servos, uint8_t _num_axes, uint32_t baudrate ){
+    if( _num_axes > MKS_VELOCITY_MAX_AXES || baudrate == 0 ){
+        return false;
+    }
+    num_axes  = _num_axes;
+    byte_time = ( 10000000UL + baudrate - 1 ) / baudrate;
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        axes[i]         = axis_state();
+        axes[i].servo   = servos[i];
+        axes[i].address = servos[i]->get_slave_address();
+    }
+    ack_length   = 0;
+    window_start = millis();
+    return true;
+}
+
+//#########################################################################
+// Store a new setpoint. Safe to call from any task at any rate
+// dir: 0/1, speed: 0 - 127 as in set_run_continuous(), 0 = stop
+//#########################################################################
+bool SERVO42C_VELOCITY::set_speed( uint8_t axis, uint8_t dir, uint8_t speed ){
+    if( axis >= num_axes ){
+        return false;
+    }
+    if( speed > 127 ){ speed = 127; }
+    unsigned long now = micros();
+    axis_state &state = axes[axis];
+    portENTER_CRITICAL( &mux );
+    ++state.stats.setpoints;
+    if( state.dirty ){
+        ++state.stats.coalesced;
+    } else {
+        state.set_at = now;
+    }
+    state.dir   = dir ? 1 : 0;
+    state.speed = speed;
+    state.dirty = true;
+    portEXIT_CRITICAL( &mux );
+    return true;
+}
+
+//#########################################################################
+// Call from the control loop or a bus task as often as possible
+// Never waits for the drives
+//#########################################################################
+void SERVO42C_VELOCITY::poll(){
+    if( num_axes == 0 ){
+        return;
+    }
+    collect_acks();
+    expire_acks();
+    uint8_t in_flight = 0;
+    bool    waiting   = false;
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        in_flight += axes[i].in_flight ? 1 : 0;
+    }
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        axis_state &state = axes[i];
+        if( state.in_flight ){
+            continue;
+        }
+        portENTER_CRITICAL( &mux );
+        bool dirty = state.dirty;
+        portEXIT_CRITICAL( &mux );
+        if( !dirty ){
+            continue;
+        }
+        // the wake would drain the status frames in flight
+        bool wake = state.servo->needs_wake();
+        if( ( wake && in_flight > 0 ) || ( !wake && wake_waiting ) ){
+            waiting |= wake;
+            continue;
+        }
+        portENTER_CRITICAL( &mux );
+        uint8_t       dir    = state.dir;
+        uint8_t       speed  = state.speed;
+        unsigned long set_at = state.set_at;
+        state.dirty = false;
+        portEXIT_CRITICAL( &mux );
+        if( !bus_locked ){
+            axes[0].servo->lock_bus();
+            bus_locked = true;
+        }
+        if( !state.servo->post_run_continuous( dir, speed ) ){
+            portENTER_CRITICAL( &mux );
+            if( state.servo->get_limit_error() != MKS_LIMIT_OK ){
+                ++state.stats.rejected;
+            } else {
+                // not sent, try again in the next poll unless replaced
+                ++state.stats.write_errors;
+                if( !state.dirty ){
+                    state.dir    = dir;
+                    state.speed  = speed;
+                    state.dirty  = true;
+                    state.set_at = set_at;
+                }
+            }
+            portEXIT_CRITICAL( &mux );
+            continue;
+        }
+        unsigned long now  = micros();
+        uint32_t latency   = now - set_at;
+        // the drive answers after its frame and all frames ahead of it
+        // are received, the status queues behind the ones still due
+        ++in_flight;
+        state.in_flight    = true;
+        state.sent_at      = now;
+        state.ack_timeout  = in_flight * ( MKS_VELOCITY_FRAME_BYTES + MKS_VELOCITY_ACK_BYTES ) * byte_time + MKS_VELOCITY_ACK_MARGIN;
+        state.sent_dir     = dir;
+        state.sent_speed   = speed;
+        portENTER_CRITICAL( &mux );
+        ++state.window_frames;
+        ++state.stats.frames;
+        state.stats.last_latency_us = latency;
+        state.stats.avg_latency_us  = state.stats.frames == 1 ? latency : state.stats.avg_latency_us - ( state.stats.avg_latency_us >> 4 ) + ( latency >> 4 );
+        if( latency > state.stats.max_latency_us ){
+            state.stats.max_latency_us = latency;
+        }
+        portEXIT_CRITICAL( &mux );
+    }
+    wake_waiting = waiting;
+    unsigned long now = millis();
+    if( ( now - window_start ) >= MKS_VELOCITY_RATE_WINDOW ){
+        uint32_t elapsed = now - window_start;
+        portENTER_CRITICAL( &mux );
+        for( uint8_t i = 0; i < num_axes; ++i ){
+            axes[i].stats.update_rate   = ( axes[i].window_frames * 1000UL + elapsed / 2 ) / elapsed;
+            axes[i].window_frames       = 0;
+        }
+        portEXIT_CRITICAL( &mux );
+        window_start = now;
+    }
+    update_lock();
+}
+
+//#########################################################################
+// Parse status frames: address, status, checksum
+// Bytes that don't fit an axis with a frame in flight are skipped
+//#########################################################################
+void SERVO42C_VELOCITY::collect_acks(){
+    uint8_t buffer[32];
+    uint8_t length;
+    while( ( length = axes[0].servo->read_async( buffer, sizeof( buffer ) ) ) > 0 ){
+        for( uint8_t n = 0; n < length; ++n ){
+            ack[ack_length++] = buffer[n];
+            if( ack_length < 3 ){
+                continue;
+            }
+            if( (uint8_t)( ack[0] + ack[1] ) == ack[2] && ack[1] <= 1 ){
+                handle_ack( ack[0], ack[1] );
+                ack_length = 0;
+            } else {
+                // out of sync, drop the first byte
+                ack[0]     = ack[1];
+                ack[1]     = ack[2];
+                ack_length = 2;
+            }
+        }
+    }
+    if( ack_length > 0 ){
+        // a status frame can't start with an address nobody waits for
+        bool expected = false;
+        for( uint8_t i = 0; i < num_axes; ++i ){
+            expected |= axes[i].in_flight && axes[i].address == ack[0];
+        }
+        if( !expected ){
+            ack_length = 0;
+        }
+    }
+}
+
+void SERVO42C_VELOCITY::handle_ack( uint8_t address, uint8_t status ){
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        axis_state &state = axes[i];
+        if( !state.in_flight || state.address != address ){
+            continue;
+        }
+        state.in_flight = false;
+        portENTER_CRITICAL( &mux );
+        if( status == 1 ){
+            ++state.stats.acks;
+            portEXIT_CRITICAL( &mux );
+            return;
+        }
+        ++state.stats.nacks;
+        if( !state.dirty ){
+            // send the rejected setpoint again
+            state.dir    = state.sent_dir;
+            state.speed  = state.sent_speed;
+            state.dirty  = true;
+            state.set_at = micros();
+        }
+        portEXIT_CRITICAL( &mux );
+        return;
+    }
+}
+
+void SERVO42C_VELOCITY::expire_acks(){
+    unsigned long now = micros();
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        axis_state &state = axes[i];
+        if( state.in_flight && ( now - state.sent_at ) > state.ack_timeout ){
+            state.in_flight = false;
+            portENTER_CRITICAL( &mux );
+            ++state.stats.timeouts;
+            if( !state.dirty ){
+                state.dir    = state.sent_dir;
+                state.speed  = state.sent_speed;
+                state.dirty  = true;
+                state.set_at = now;
+            }
+            portEXIT_CRITICAL( &mux );
+        }
+    }
+}
+
+//#########################################################################
+// Keep the bus only while status frames are outstanding
+//#########################################################################
+void SERVO42C_VELOCITY::update_lock(){
+    if( !bus_locked || !is_idle() ){
+        return;
+    }
+    ack_length = 0;
+    bus_locked = false;
+    axes[0].servo->unlock_bus();
+}
+
+//#########################################################################
+// true if no frame is waiting for its status
+//#########################################################################
+bool SERVO42C_VELOCITY::is_idle(){
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        if( axes[i].in_flight ){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SERVO42C_VELOCITY::get_stats( uint8_t axis, servo42c_velocity_stats &stats ){
+    if( axis >= num_axes ){
+        return false;
+    }
+    portENTER_CRITICAL( &mux );
+    stats = axes[axis].stats;
+    portEXIT_CRITICAL( &mux );
+    return true;
+}
+
+void SERVO42C_VELOCITY::reset_stats(){
+    portENTER_CRITICAL( &mux );
+    for( uint8_t i = 0; i < num_axes; ++i ){
+        axes[i].stats         = servo42c_velocity_stats();
+        axes[i].window_frames = 0;
+    }
+    portEXIT_CRITICAL( &mux );
+    window_start = millis();
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_VELOCITY
+#define SERVO42C_MKS_VELOCITY
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "servo42c.h"
+
+static const uint8_t  MKS_VELOCITY_MAX_AXES    = 10;
+static const uint32_t MKS_VELOCITY_ACK_MARGIN  = 10000; // us the drive may take to answer on top of the wire time
+static const uint8_t  MKS_VELOCITY_FRAME_BYTES = 4;     // 0xF6 frame: address, command, speed, checksum
+static const uint8_t  MKS_VELOCITY_ACK_BYTES   = 3;     // status frame: address, status, checksum
+static const uint32_t MKS_VELOCITY_RATE_WINDOW = 1000;  // ms window for the update rate
+
+//###############################################################
+// Per axis streaming statistics
+// latency is the time from set_speed() until the frame that
+// carries the setpoint was written to the UART
+//###############################################################
+struct servo42c_velocity_stats {
+    uint32_t setpoints;       // set_speed() calls
+    uint32_t coalesced;       // setpoints replaced before they were sent
+    uint32_t frames;          // frames written
+    uint32_t acks;            // status 1 received
+    uint32_t nacks;           // status 0 received, setpoint is sent again
+    uint32_t timeouts;        // no status within the ack deadline of the frame
+    uint32_t rejected;        // setpoints refused by the soft limits, not sent
+    uint32_t write_errors;    // frames that couldn't be written, setpoint is sent again
+    uint32_t last_latency_us;
+    uint32_t avg_latency_us;  // moving average over the last ~16 frames
+    uint32_t max_latency_us;
+    uint32_t update_rate;     // frames per second in the last window
+};
+
+//###############################################################
+// Velocity streaming for control loops
+// set_speed() only stores the setpoint and never touches the bus.
+// poll() writes the latest setpoint of every changed axis back
+// to back without waiting for the status frames. They are matched
+// by slave address in later polls. One frame per axis is in
+// flight at a time, setpoints arriving meanwhile are coalesced.
+// All axes need to be on the same UART with unique addresses.
+// A status counts as lost after the wire time of all frames and
+// status frames queued ahead of it at the given baudrate plus
+// MKS_VELOCITY_ACK_MARGIN.
+// The bus stays locked while status frames are outstanding so
+// other tasks can't drain them with a blocking transaction.
+// Waking an idle axis is one too. That axis waits until no
+// status is outstanding, the other axes hold back meanwhile
+//###############################################################
+class SERVO42C_VELOCITY {
+
+    private:
+
+        struct axis_state {
+            SERVO42C     *servo;
+            uint8_t       address;
+            // written by set_speed(), guarded by mux
+            uint8_t       dir;
+            uint8_t       speed;
+            bool          dirty;
+            unsigned long set_at;      // micros() of the oldest unsent setpoint
+            // only touched by poll()
+            bool          in_flight;
+            unsigned long sent_at;     // micros() the frame was written
+            uint32_t      ack_timeout; // us after sent_at until the status counts as lost
+            uint8_t       sent_dir;
+            uint8_t       sent_speed;
+            uint32_t      window_frames;
+            servo42c_velocity_stats stats;
+        };
+
+        axis_state    axes[MKS_VELOCITY_MAX_AXES];
+        uint8_t       num_axes;
+        portMUX_TYPE  mux;
+        bool          bus_locked;
+        bool          wake_waiting;    // an idle axis waits for the bus to get quiet
+        unsigned long window_start;
+        uint32_t      byte_time;       // us per byte on the wire, 10 bits
+
+        uint8_t ack[3];
+        uint8_t ack_length;
+
+        void collect_acks( void );
+        void handle_ack( uint8_t address, uint8_t status );
+        void expire_acks( void );
+        void update_lock( void );
+
+    public:
+        SERVO42C_VELOCITY();
+        bool init( SERVO42C **servos, uint8_t num_axes, uint32_t baudrate = 38400 );
+        bool set_speed( uint8_t axis, uint8_t dir, uint8_t speed );
+        void poll( void );
+        bool is_idle( void );
+        bool get_stats( uint8_t axis, servo42c_velocity_stats &stats );
+        void reset_stats( void );
+
+};
+
+
+#endif
\ No newline at end of file
@@ -55,8 +55,13 @@
 
 #include "main.h"
 #include "servo42c.h"
+#include "servo42c_rpc.h"
+#include "servo42c_driver.h"
 
 SERVO42C *servo_stepper;
+SERVO42C_RPC rpc_gateway;
+SERVO42C_SEQUENCE sequence_runner;
+SERVO42C_DRIVER driver_task;
 
 HardwareSerial mks_serial(0);
 
@@ -71,12 +76,31 @@ void setup() {
   servo_stepper = new SERVO42C();
   servo_stepper->init( mks_serial );
   servo_stepper->set_slave_address( MKS42C_ADDRESS_DEFAULT );  // set the drivers slave address (this needs to be the same as set on the stepper driver itself)
+  if( servo_stepper->probe_capabilities() ){                  // commands the firmware doesn't answer fail at once from now on
+    Serial.printf( "Capabilities: 0x%04X\n", servo_stepper->get_capabilities() );
+  } else {
+    Serial.println( "Drive not answering" );
+  }
   servo_stepper->set_max_current( MKS42C_MAXCURRENT_DEFAULT ); // set max current
   servo_stepper->set_max_torque( MKS42C_MAXTORQUE_DEFAULT );   // set max torque
   servo_stepper->set_enable_mode( MKS42C_ENABLEMODE_DEFAULT ); // set enable mode to active low (enable pin low = motor enabled )
   servo_stepper->set_subdivision( MKS42C_MICROSTEPS_DEFAULT ); // set microsteps
   servo_stepper->set_subdivision_interpolation( MKS42C_ENABLEMICROSTEPS_DEFAULT ); // enable microstepping I guess
   vTaskDelay(50);
+  servo_stepper->set_following_reference(); // pulses and encoder count from here for the following error
+#if MKS42C_RPC_GATEWAY
+  rpc_gateway.init( Serial, &servo_stepper, 1 ); // the host talks binary on the USB serial from now on
+  sequence_runner.init( &servo_stepper, 1 );
+  rpc_gateway.set_sequence( &sequence_runner );   // sequences can be uploaded and started by the host
+#endif
+#if MKS42C_DRIVER_TASK
+  servo42c_driver_config driver_config = SERVO42C_DRIVER::default_config();
+  driver_config.period = MKS42C_DRIVER_PERIOD;
+  driver_task.init( &servo_stepper, 1, driver_config );
+  servo42c_driver_io driver_io = { 1, 1, 1, 10, 10, false }; // encoder, pulses, angle error every cycle, enable and lock every 10th
+  driver_task.set_io( 0, driver_io );
+  driver_task.start();
+#endif
   //servo_stepper->set_move_steps( 0, 80, 6000 ); // dir, speed, steps
   //vTaskDelay(1000); // let it run a little
   //servo_stepper->set_stop_motor(); // enforce motor to stop
@@ -84,16 +108,34 @@ void setup() {
 
 void loop(){ 
 
+#if MKS42C_RPC_GATEWAY
+  rpc_gateway.poll();
+  vTaskDelay(1);
+  return;
+#endif
+
   Serial.println("");
+  servo42c_position position;
+#if MKS42C_DRIVER_TASK
+  // the driver task keeps the snapshot fresh, no bus traffic here
+  servo42c_telemetry telemetry;
+  servo42c_driver_stats stats;
+  servo_stepper->get_telemetry( telemetry );
+  servo_stepper->get_cached_position( position );
+  driver_task.get_stats( stats );
+  float aerr = ( static_cast<float>( telemetry.angle_error ) / 0xFFFF ) * 360.0f;
+  Serial.printf( "  Cycles: %u  Overruns: %u  Jitter avg/max: %u/%u us", stats.cycles, stats.overruns, stats.avg_jitter_us, stats.max_jitter_us );
+#else
   float aerr = servo_stepper->get_shaft_angle_error();
-  int prec = servo_stepper->get_pulses_received();
-  int encv = servo_stepper->get_encoder_value();
+  servo_stepper->get_position( position ); // encoder and pulses as 64bit, no truncation on long runs
+#endif
   Serial.print( "  Shaft error: " );
   Serial.print(aerr);
-  Serial.print( "  Pulses: " );
-  Serial.print(prec);
-  Serial.print( "  Encoder: " );
-  Serial.print(encv);
+  Serial.printf( "  Pulses: %lld", position.pulses );
+  Serial.printf( "  Encoder: %lld", position.encoder );
+  if( position.following_valid ){
+    Serial.printf( "  Following error: %lld", position.following_error );
+  }
   Serial.print("  ");
   //digitalWrite(D0, HIGH); // make tiny LED go blink
   //vTaskDelay(500);
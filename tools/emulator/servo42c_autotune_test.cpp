@@ -0,0 +1,87 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// servo42c_autotune_test
+//
+// Runs SERVO42C_AUTOTUNE on Linux against the plant model of the
+// bus emulator, once with the encoder counting up for dir 0 and
+// once counting down. Checks:
+//  - the step response with the start gains settles
+//  - the tuning succeeds and does not end slower than it started
+//  - the axis is back at its start position
+// Exits with 1 if a check failed
+//
+// Build:
+//   g++ -std=gnu++11 -O2 -pthread -Istubs -I../../lib/mks42c servo42c_host_shim.cpp servo42c_emulator.cpp 
+//       ../../lib/mks42c/*.cpp servo42c_autotune_test.cpp -o servo42c_autotune_test
+//
+//####################################################################
+#include "servo42c_emulator.h"
+#include "servo42c_autotune.h"
+#include <stdio.h>
+
+static const int64_t TEST_START_ENCODER = 100000;
+
+static bool run_case( bool encoder_inverted ){
+    SERVO42C_EMULATOR bus;
+    bus.add_drive( 0 );
+    bus.set_encoder_inverted( 0, encoder_inverted );
+    bus.set_encoder( 0, TEST_START_ENCODER );
+    bus.set_plant( 0, true );
+    SERVO42C servo;
+    servo.init( bus );
+
+    SERVO42C_AUTOTUNE autotune;
+    servo42c_autotune_config config = SERVO42C_AUTOTUNE::default_config();
+    autotune.init( &servo, config );
+
+    bool passed = true;
+    servo42c_step_response response;
+    bool settled = autotune.step_response( config.kp, config.ki, config.kd, response ) && response.settled;
+    printf( "encoder %s: start gains settle in %u us, overshoot %u, %u samples\n", encoder_inverted ? "inverted" : "normal",
+            response.settle_time, response.overshoot, response.samples );
+    if( !settled ){
+        printf( "  FAIL step response did not settle\n" );
+        passed = false;
+    }
+    // step_response() only moved forward, go back to the start
+    servo.set_move_steps( 1, config.speed, config.step, true );
+
+    servo42c_autotune_result result;
+    bool success = autotune.run( result );
+    printf( "  tuned kp %u kd %u, settle %u -> %u us, overshoot %u, %u experiments\n", result.kp, result.kd,
+            result.initial_settle_time, result.settle_time, result.overshoot, result.experiments );
+    if( !success ){
+        printf( "  FAIL tuning did not succeed\n" );
+        passed = false;
+    } else if( result.settle_time > result.initial_settle_time ){
+        printf( "  FAIL tuned gains are slower than the start gains\n" );
+        passed = false;
+    }
+    vTaskDelay( 200 );
+    int64_t offset = bus.get_encoder( 0 ) - TEST_START_ENCODER;
+    if( offset < -(int64_t)config.tolerance || offset > (int64_t)config.tolerance ){
+        printf( "  FAIL axis ended %lld counts away from the start\n", (long long)offset );
+        passed = false;
+    }
+    return passed;
+}
+
+int main(){
+    bool passed = run_case( false );
+    passed      = run_case( true ) && passed;
+    printf( "%s\n", passed ? "PASS" : "FAIL" );
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,232 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// servo42c_bus_stress [seconds]
+//
+// Multi-thread stress test of the bus sharing in SERVO42C, built for
+// Linux against the host stand-ins in stubs/ and the bus emulator.
+// Four drives share one emulated bus at 38400 baud. Every drive has
+// its own encoder, pulse and angle error values, so an answer that
+// ends up at the wrong axis or the wrong request shows as a wrong
+// value. Axis 0 runs blocking moves in a loop, axis 2 non-blocking
+// moves that sometimes replace a move still running, each followed
+// by a setter. Other threads read all axes. Checks:
+//  - no value read from the bus belongs to another axis or command,
+//    a final status is never taken for an enable state or a setter
+//  - blocking moves return after about the move time, the final
+//    status was not taken by another reader
+//  - readers of axes without moves are not held up for the move time
+// A second run without moves adds dropped and corrupted answers
+// Exits with 1 if a check failed
+//
+// Build:
+//   g++ -std=gnu++11 -O2 -pthread -Istubs -I../../lib/mks42c servo42c_host_shim.cpp servo42c_emulator.cpp 
+//       ../../lib/mks42c/*.cpp servo42c_bus_stress.cpp -o servo42c_bus_stress
+//
+//####################################################################
+#include "servo42c_emulator.h"
+#include "servo42c.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+static const uint8_t  STRESS_AXES        = 4;
+static const uint8_t  STRESS_MOVE_SPEED  = 20;    // 10000 microsteps/s
+static const uint32_t STRESS_MOVE_STEPS  = 2000;  // 200 ms per move
+static const uint32_t STRESS_MAX_WAIT_US = 100000; // half a move, readers of other axes must not wait for one
+static const uint8_t  STRESS_ASYNC_AXIS  = 2;     // runs non-blocking moves
+
+static int64_t  expected_encoder( uint8_t axis ){ return ( (int64_t)axis << 20 ) + 12345 * axis; }
+static int32_t  expected_pulses( uint8_t axis ){ return 0x01000000 * ( axis + 1 ) + axis; }
+static int16_t  expected_angle_error( uint8_t axis ){ return 100 * ( axis + 1 ); }
+
+static uint64_t now_us(){
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+struct reader_result {
+    uint32_t reads;
+    uint32_t failed;
+    uint32_t wrong;     // cross-wired
+    uint32_t max_us;
+};
+
+struct mover_result {
+    uint32_t moves;
+    uint32_t failed;
+    uint32_t early;     // returned before the move could be done
+    uint32_t max_us;
+    uint64_t total_us;
+    std::atomic<bool> done;
+};
+
+//#########################################################################
+// Reads all inputs of one axis in a loop and compares them. The encoder
+// of the moving axis is only compared where it can't have changed
+//#########################################################################
+static void run_reader( SERVO42C *servo, uint8_t axis, bool moving, std::atomic<bool> *stop, reader_result *result ){
+    static const uint8_t inputs[] = { MKS_INPUT_ENCODER, MKS_INPUT_PULSES, MKS_INPUT_ANGLE_ERROR, MKS_INPUT_ENABLE_STATE };
+    uint32_t n = 0;
+    while( !stop->load() ){
+        uint8_t  input = inputs[n++ % sizeof( inputs )];
+        uint64_t start = now_us();
+        bool     ok    = servo->read_input( input );
+        uint32_t took  = now_us() - start;
+        ++result->reads;
+        result->max_us = std::max( result->max_us, took );
+        if( !ok ){
+            ++result->failed;
+            continue;
+        }
+        servo42c_telemetry snapshot;
+        servo->get_telemetry( snapshot );
+        bool right = true;
+        switch( input ){
+            case MKS_INPUT_ENCODER:      right = moving || snapshot.encoder == expected_encoder( axis ); break;
+            case MKS_INPUT_PULSES:       right = snapshot.pulses == expected_pulses( axis ); break;
+            case MKS_INPUT_ANGLE_ERROR:  right = snapshot.angle_error == expected_angle_error( axis ); break;
+            case MKS_INPUT_ENABLE_STATE: right = snapshot.enabled; break; // the final status of a move looks like "disabled"
+        }
+        if( !right ){
+            ++result->wrong;
+        }
+    }
+}
+
+static void run_mover( SERVO42C *servo, std::atomic<bool> *stop, mover_result *result ){
+    uint8_t dir = 0;
+    while( !stop->load() ){
+        uint64_t start = now_us();
+        bool     ok    = servo->set_move_steps( dir, STRESS_MOVE_SPEED, STRESS_MOVE_STEPS, true );
+        uint32_t took  = now_us() - start;
+        ++result->moves;
+        if( !ok ){
+            ++result->failed;
+            continue;
+        }
+        if( took < STRESS_MOVE_STEPS * 1000000ULL / ( STRESS_MOVE_SPEED * 500 ) ){
+            ++result->early;
+        }
+        result->max_us    = std::max( result->max_us, took );
+        result->total_us += took;
+        dir ^= 1;
+    }
+    result->done.store( true );
+}
+
+//#########################################################################
+// Non-blocking moves with a setter after each. The next move starts
+// after 50 - 150% of the move time, so some replace a running move
+//#########################################################################
+static void run_async_mover( SERVO42C *servo, std::atomic<bool> *stop, mover_result *result ){
+    uint32_t move_us = STRESS_MOVE_STEPS * 1000000ULL / ( STRESS_MOVE_SPEED * 500 );
+    uint8_t  dir     = 0;
+    while( !stop->load() ){
+        ++result->moves;
+        if( !servo->set_move_steps( dir, STRESS_MOVE_SPEED, STRESS_MOVE_STEPS, false ) || !servo->set_enable( 1 ) ){
+            ++result->failed;
+        }
+        dir ^= 1;
+        std::this_thread::sleep_for( std::chrono::microseconds( move_us / 2 + rand() % move_us ) );
+    }
+    result->done.store( true );
+}
+
+static bool run( const char *name, const servo42c_emulator_config &config, bool moves, uint32_t seconds ){
+    SERVO42C_EMULATOR bus( config );
+    SERVO42C          servos[STRESS_AXES];
+    for( uint8_t i = 0; i < STRESS_AXES; ++i ){
+        bus.add_drive( i );
+        bus.set_encoder( i, expected_encoder( i ) );
+        bus.set_pulses( i, expected_pulses( i ) );
+        bus.set_angle_error( i, expected_angle_error( i ) );
+        servos[i].init( bus );
+        servos[i].set_slave_address( i ); // host side only, the drive already has it
+    }
+
+    std::atomic<bool>        stop( false );
+    std::vector<std::thread> threads;
+    reader_result            readers[STRESS_AXES + 1] = {};
+    mover_result             mover = {};
+    mover_result             async_mover = {};
+    mover.done.store( false );
+    async_mover.done.store( false );
+    for( uint8_t i = 0; i < STRESS_AXES; ++i ){
+        threads.push_back( std::thread( run_reader, &servos[i], i, moves && ( i == 0 || i == STRESS_ASYNC_AXIS ), &stop, &readers[i] ) );
+    }
+    // a second reader on a quiet axis doubles the contention
+    threads.push_back( std::thread( run_reader, &servos[1], 1, false, &stop, &readers[STRESS_AXES] ) );
+    if( moves ){
+        threads.push_back( std::thread( run_mover, &servos[0], &stop, &mover ) );
+        threads.push_back( std::thread( run_async_mover, &servos[STRESS_ASYNC_AXIS], &stop, &async_mover ) );
+    }
+    std::this_thread::sleep_for( std::chrono::seconds( seconds ) );
+    stop.store( true );
+    // a mover stuck on a lost final status would never come back
+    uint64_t deadline = now_us() + 2000000;
+    while( moves && !mover.done.load() ){
+        if( now_us() > deadline ){
+            printf( "%s\n  FAIL: blocking move did not return\n", name );
+            fflush( stdout );
+            _Exit( 1 );
+        }
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
+    for( size_t i = 0; i < threads.size(); ++i ){
+        threads[i].join();
+    }
+
+    bool ok = true;
+    printf( "%s\n", name );
+    for( uint8_t i = 0; i <= STRESS_AXES; ++i ){
+        uint8_t axis = i < STRESS_AXES ? i : 1;
+        printf( "  reader axis %u: %7u reads %5u failed %3u wrong  max wait %6u us\n", axis, readers[i].reads, readers[i].failed, readers[i].wrong, readers[i].max_us );
+        ok &= readers[i].wrong == 0;
+        if( moves && axis != 0 && axis != STRESS_ASYNC_AXIS ){
+            ok &= readers[i].max_us < STRESS_MAX_WAIT_US;
+        }
+        if( config.drop_per_mille == 0 && config.corrupt_per_mille == 0 ){
+            ok &= readers[i].failed == 0;
+        }
+    }
+    if( moves ){
+        printf( "  mover axis 0:  %7u moves %5u failed %3u early  mean %6u us  max %6u us\n", mover.moves, mover.failed, mover.early,
+                mover.moves > mover.failed ? (uint32_t)( mover.total_us / ( mover.moves - mover.failed ) ) : 0, mover.max_us );
+        ok &= mover.moves > 0 && mover.failed == 0 && mover.early == 0;
+        ok &= mover.max_us < 2 * STRESS_MOVE_STEPS * 1000000ULL / ( STRESS_MOVE_SPEED * 500 );
+        printf( "  mover axis %u:  %7u non-blocking moves %5u failed\n", STRESS_ASYNC_AXIS, async_mover.moves, async_mover.failed );
+        ok &= async_mover.moves > 0 && async_mover.failed == 0;
+    }
+    servo42c_emulator_stats stats;
+    bus.get_stats( stats );
+    printf( "  bus: %u frames %u answers %u dropped %u corrupted %u bad frames\n", stats.frames, stats.responses, stats.dropped, stats.corrupted, stats.bad_frames );
+    printf( "  %s\n", ok ? "PASS" : "FAIL" );
+    return ok;
+}
+
+int main( int argc, char **argv ){
+    uint32_t seconds = argc > 1 ? atoi( argv[1] ) : 5;
+    servo42c_emulator_config config = SERVO42C_EMULATOR::default_config();
+    config.baudrate = 38400;
+    bool ok = run( "blocking moves on axis 0, non-blocking on axis 2, readers on all axes", config, true, seconds );
+    config.drop_per_mille    = 10;
+    config.corrupt_per_mille = 10;
+    ok &= run( "readers only, 1% dropped and 1% corrupted answers", config, false, seconds );
+    return ok ? 0 : 1;
+}
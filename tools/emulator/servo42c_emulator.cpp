@@ -0,0 +1,530 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// Emulated drives, see servo42c_emulator.h
+//
+// Command set and answer lengths follow servo42c.cpp. 0x36 is not
+// answered, like on the drives the library was written against.
+// Goto zero runs at ( zero speed + 1 ) * 16 speed units
+//
+//####################################################################
+#include "servo42c_emulator.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+
+static const double MKS_EMULATOR_STEPS_PER_SPEED = 500.0; // microsteps/s per speed unit
+static const double MKS_EMULATOR_PLANT_STEP_US   = 20.0;
+static const double MKS_EMULATOR_PLANT_FREQUENCY = 2.0 * M_PI * 30.0; // rad/s at the default gains
+static const double MKS_EMULATOR_PLANT_DAMPING   = 0.35;
+static const double MKS_EMULATOR_PLANT_MAX_ACC   = 2000000.0;          // microsteps/s²
+static const double MKS_EMULATOR_DEFAULT_GAIN    = 1616.0;
+
+//#########################################################################
+// Bytes the host sends per command, see the send helpers of SERVO42C
+//#########################################################################
+static uint8_t request_length( uint8_t cmd ){
+    switch( cmd ){
+        case 0x30: case 0x33: case 0x36: case 0x39: case 0x3A: 
+        case 0x3D: case 0x3E: case 0x3F: case 0xF7:
+            return 3;
+        case 0xA1: case 0xA2: case 0xA3: case 0xA4: case 0xA5:
+            return 5;
+        case 0xFD:
+            return 8;
+    }
+    return 4;
+}
+
+static uint8_t checksum( const uint8_t *data, uint8_t length ){
+    uint8_t sum = 0;
+    for( uint8_t i = 0; i < length; ++i ){
+        sum += data[i];
+    }
+    return sum;
+}
+
+servo42c_emulator_config SERVO42C_EMULATOR::default_config(){
+    servo42c_emulator_config config;
+    config.baudrate          = 0;
+    config.latency_us        = 200;
+    config.drop_per_mille    = 0;
+    config.corrupt_per_mille = 0;
+    config.seed              = 1;
+    config.calibrate_time    = 2000;
+    config.goto_zero_delay   = 0;
+    return config;
+}
+
+SERVO42C_EMULATOR::SERVO42C_EMULATOR( const servo42c_emulator_config &_config ) : HardwareSerial( 1 ), config( _config ), stats(), 
+                                                                                  host_tx_free( 0 ), drive_tx_free( 0 ), random_state( _config.seed | 1 ) {
+    memset( drives, 0, sizeof( drives ) );
+}
+
+uint64_t SERVO42C_EMULATOR::now_us(){
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+//#########################################################################
+// 8N1, ten bits per byte
+//#########################################################################
+uint64_t SERVO42C_EMULATOR::byte_time_us(){
+    return config.baudrate == 0 ? 0 : 10000000ULL / config.baudrate;
+}
+
+uint32_t SERVO42C_EMULATOR::next_random(){
+    // xorshift32, same sequence for the same seed
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+int SERVO42C_EMULATOR::find_drive( uint8_t address ){
+    for( int i = 0; i < MKS_EMULATOR_MAX_DRIVES; ++i ){
+        if( drives[i].present && drives[i].address == address ){
+            return i;
+        }
+    }
+    return -1;
+}
+
+//#########################################################################
+// Drives are set up like after a factory reset, enabled and at encoder 0
+//#########################################################################
+void SERVO42C_EMULATOR::add_drive( uint8_t address_num, uint16_t microsteps ){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    if( address_num >= MKS_EMULATOR_MAX_DRIVES ){
+        return;
+    }
+    drive &axis = drives[address_num];
+    memset( &axis, 0, sizeof( axis ) );
+    axis.present    = true;
+    axis.address    = 0xE0 + address_num;
+    axis.enabled    = true;
+    axis.microsteps = microsteps;
+    axis.full_steps = 200;
+    axis.start_us   = now_us();
+    axis.kp         = 1616;
+    axis.kd         = 1616;
+    axis.unsupported[0x36 >> 3] |= 1 << ( 0x36 & 7 );
+}
+
+//#########################################################################
+// Motion
+//#########################################################################
+double SERVO42C_EMULATOR::position( const drive &axis, uint64_t time_us ){
+    if( time_us <= axis.start_us ){
+        return axis.origin;
+    }
+    if( axis.end_us != 0 && time_us > axis.end_us ){
+        time_us = axis.end_us;
+    }
+    return axis.origin + axis.velocity * (double)( time_us - axis.start_us ) / 1000000.0;
+}
+
+double SERVO42C_EMULATOR::velocity( const drive &axis, uint64_t time_us ){
+    if( time_us <= axis.start_us || ( axis.end_us != 0 && time_us > axis.end_us ) ){
+        return 0;
+    }
+    return axis.velocity;
+}
+
+//#########################################################################
+// Shaft position in microsteps. Runs the plant up to time_us in fixed
+// steps, the commanded position is the reference
+//#########################################################################
+double SERVO42C_EMULATOR::shaft( drive &axis, uint64_t time_us ){
+    if( !axis.plant ){
+        return position( axis, time_us );
+    }
+    double frequency = MKS_EMULATOR_PLANT_FREQUENCY * sqrt( axis.kp / MKS_EMULATOR_DEFAULT_GAIN );
+    double damping   = MKS_EMULATOR_PLANT_DAMPING * ( axis.kd / MKS_EMULATOR_DEFAULT_GAIN ) / sqrt( axis.kp / MKS_EMULATOR_DEFAULT_GAIN );
+    double dt        = MKS_EMULATOR_PLANT_STEP_US / 1000000.0;
+    while( axis.plant_us + MKS_EMULATOR_PLANT_STEP_US <= time_us ){
+        axis.plant_us += MKS_EMULATOR_PLANT_STEP_US;
+        double error        = position( axis, axis.plant_us ) - axis.plant_position;
+        double rate_error   = velocity( axis, axis.plant_us ) - axis.plant_velocity;
+        double acceleration = frequency * frequency * error + 2.0 * damping * frequency * rate_error;
+        acceleration        = std::max( -MKS_EMULATOR_PLANT_MAX_ACC, std::min( MKS_EMULATOR_PLANT_MAX_ACC, acceleration ) );
+        axis.plant_velocity += acceleration * dt;
+        axis.plant_position += axis.plant_velocity * dt;
+    }
+    return axis.plant_position;
+}
+
+void SERVO42C_EMULATOR::set_segment( drive &axis, uint64_t start_us, double velocity, double distance, bool move_final ){
+    uint64_t now     = now_us();
+    axis.origin      = position( axis, now );
+    axis.start_us    = start_us;
+    axis.velocity    = velocity;
+    axis.end_us      = 0;
+    axis.move_final  = false;
+    if( velocity != 0 && distance >= 0 ){
+        axis.end_us = start_us + (uint64_t)( distance / fabs( velocity ) * 1000000.0 );
+        if( move_final ){
+            scheduled_frame frame = { axis.end_us, (uint8_t)( &axis - drives ), 2, true };
+            scheduled.push_back( frame );
+        }
+    }
+}
+
+void SERVO42C_EMULATOR::stop( drive &axis, uint64_t time_us ){
+    axis.origin   = position( axis, time_us );
+    axis.start_us = time_us;
+    axis.velocity = 0;
+    axis.end_us   = 0;
+    uint8_t index = &axis - drives;
+    for( size_t i = 0; i < scheduled.size(); ){
+        if( scheduled[i].drive == index && scheduled[i].move ){
+            scheduled.erase( scheduled.begin() + i );
+        } else {
+            ++i;
+        }
+    }
+}
+
+int64_t SERVO42C_EMULATOR::get_encoder( uint8_t address_num ){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    drive &axis = drives[address_num];
+    double  counts = shaft( axis, now_us() ) * 65536.0 / ( (double)axis.microsteps * axis.full_steps );
+    int64_t value  = (int64_t)floor( counts + 0.5 );
+    return ( axis.encoder_inverted ? -value : value ) + axis.encoder_offset;
+}
+
+void SERVO42C_EMULATOR::set_encoder( uint8_t address_num, int64_t encoder ){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    drives[address_num].encoder_offset += encoder - get_encoder( address_num );
+}
+
+void SERVO42C_EMULATOR::set_encoder_inverted( uint8_t address_num, bool inverted ){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    int64_t encoder = get_encoder( address_num );
+    drives[address_num].encoder_inverted = inverted;
+    set_encoder( address_num, encoder );
+}
+
+void SERVO42C_EMULATOR::set_pulses( uint8_t address_num, int32_t pulses ){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    drives[address_num].pulses = pulses;
+}
+
+void SERVO42C_EMULATOR::set_angle_error( uint8_t address_num, int16_t angle_error ){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    drives[address_num].angle_error = angle_error;
+}
+
+void SERVO42C_EMULATOR::set_shaft_locked( uint8_t address_num, bool locked ){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    drives[address_num].shaft_locked = locked;
+}
+
+void SERVO42C_EMULATOR::set_plant( uint8_t address_num, bool enabled ){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    drive &axis = drives[address_num];
+    uint64_t now = now_us();
+    axis.plant_position = position( axis, now );
+    axis.plant_velocity = velocity( axis, now );
+    axis.plant_us       = now;
+    axis.plant          = enabled;
+}
+
+void SERVO42C_EMULATOR::set_command_supported( uint8_t address_num, uint8_t cmd, bool supported ){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    if( supported ){
+        drives[address_num].unsupported[cmd >> 3] &= ~( 1 << ( cmd & 7 ) );
+    } else {
+        drives[address_num].unsupported[cmd >> 3] |= 1 << ( cmd & 7 );
+    }
+}
+
+//#########################################################################
+// The next count answers of the drive are lost
+//#########################################################################
+void SERVO42C_EMULATOR::drop_responses( uint8_t address_num, uint8_t count ){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    drives[address_num].drop_next = count;
+}
+
+bool SERVO42C_EMULATOR::is_moving( uint8_t address_num ){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    const drive &axis = drives[address_num];
+    uint64_t now = now_us();
+    return axis.velocity != 0 && now >= axis.start_us && ( axis.end_us == 0 || now < axis.end_us );
+}
+
+void SERVO42C_EMULATOR::get_stats( servo42c_emulator_stats &_stats ){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    _stats = stats;
+}
+
+//#########################################################################
+// Answers go out one after the other on the shared TX line
+//#########################################################################
+void SERVO42C_EMULATOR::queue_frame( drive &axis, const uint8_t *data, uint8_t length, uint64_t ready_us ){
+    uint8_t frame[MKS_EMULATOR_MAX_FRAME];
+    memcpy( frame, data, length );
+    frame[length] = checksum( frame, length );
+    ++length;
+    if( axis.drop_next > 0 ){
+        --axis.drop_next;
+        ++stats.dropped;
+        return;
+    }
+    if( config.drop_per_mille > 0 && next_random() % 1000 < config.drop_per_mille ){
+        ++stats.dropped;
+        return;
+    }
+    if( config.corrupt_per_mille > 0 && next_random() % 1000 < config.corrupt_per_mille ){
+        frame[length - 1] ^= 0x5A;
+        ++stats.corrupted;
+    }
+    uint64_t time = std::max( ready_us, drive_tx_free );
+    for( uint8_t i = 0; i < length; ++i ){
+        time += byte_time_us();
+        rx.push_back( frame[i] );
+        rx_due.push_back( time );
+    }
+    drive_tx_free = time;
+    ++stats.responses;
+}
+
+void SERVO42C_EMULATOR::queue_status( drive &axis, uint8_t status, uint64_t ready_us ){
+    uint8_t frame[2] = { axis.address, status };
+    queue_frame( axis, frame, 2, ready_us );
+}
+
+//#########################################################################
+// Final status frames whose time has come
+//#########################################################################
+void SERVO42C_EMULATOR::run_scheduled( uint64_t time_us ){
+    std::sort( scheduled.begin(), scheduled.end(), []( const scheduled_frame &a, const scheduled_frame &b ){ return a.due_us < b.due_us; } );
+    size_t done = 0;
+    while( done < scheduled.size() && scheduled[done].due_us <= time_us ){
+        const scheduled_frame &frame = scheduled[done++];
+        queue_status( drives[frame.drive], frame.status, frame.due_us );
+    }
+    scheduled.erase( scheduled.begin(), scheduled.begin() + done );
+}
+
+//#########################################################################
+// One valid frame from the host. ready_us = time the drive answers
+//#########################################################################
+void SERVO42C_EMULATOR::execute( const uint8_t *frame, uint8_t length, uint64_t ready_us ){
+    int index = find_drive( frame[0] );
+    if( index < 0 ){
+        return; // nobody on the bus with this address
+    }
+    drive  &axis = drives[index];
+    uint8_t cmd  = frame[1];
+    ++stats.frames;
+    if( ( axis.unsupported[cmd >> 3] >> ( cmd & 7 ) ) & 1 ){
+        return;
+    }
+    uint8_t data[8] = { axis.address };
+    double  speed   = 0;
+    switch( cmd ){
+        case 0x30: {
+            int64_t encoder = get_encoder( index );
+            int32_t carrier = (int32_t)( encoder >> 16 );
+            data[1] = carrier >> 24; data[2] = carrier >> 16; data[3] = carrier >> 8; data[4] = carrier;
+            data[5] = encoder >> 8;  data[6] = encoder;
+            queue_frame( axis, data, 7, ready_us );
+            break;
+        }
+        case 0x33:
+            data[1] = axis.pulses >> 24; data[2] = axis.pulses >> 16; data[3] = axis.pulses >> 8; data[4] = axis.pulses;
+            queue_frame( axis, data, 5, ready_us );
+            break;
+        case 0x39: {
+            int16_t angle_error = axis.angle_error;
+            if( axis.plant ){
+                uint64_t now    = now_us();
+                double   counts = ( position( axis, now ) - shaft( axis, now ) ) * 65536.0 / ( (double)axis.microsteps * axis.full_steps );
+                angle_error     = (int16_t)std::max( -32768.0, std::min( 32767.0, floor( counts + 0.5 ) ) );
+            }
+            data[1] = angle_error >> 8; data[2] = angle_error;
+            queue_frame( axis, data, 3, ready_us );
+            break;
+        }
+        case 0x3A:
+            queue_status( axis, axis.enabled ? 1 : 2, ready_us );
+            break;
+        case 0x3D:
+            axis.shaft_locked = false;
+            queue_status( axis, 1, ready_us );
+            break;
+        case 0x3E:
+            queue_status( axis, axis.shaft_locked ? 1 : 2, ready_us );
+            break;
+        case 0x3F:
+            axis.microsteps = 16;
+            axis.full_steps = 200;
+            queue_status( axis, 1, ready_us );
+            break;
+        case 0x80:
+            // no answer until the calibration is done
+            {
+                scheduled_frame done = { ready_us + config.calibrate_time * 1000ULL, (uint8_t)index, 1, false };
+                scheduled.push_back( done );
+            }
+            break;
+        case 0x81:
+        case 0x84: {
+            // keep the encoder where it is, only the microstep scale changes
+            int64_t encoder = get_encoder( index );
+            stop( axis, now_us() );
+            if( cmd == 0x81 ){
+                axis.full_steps = frame[2] == 0 ? 400 : 200;
+            } else {
+                axis.microsteps = frame[2] == 0 ? 256 : frame[2];
+            }
+            axis.origin = 0;
+            axis.encoder_offset = 0;
+            axis.plant_position = 0;
+            axis.plant_velocity = 0;
+            set_encoder( index, encoder );
+            queue_status( axis, 1, ready_us );
+            break;
+        }
+        case 0x8B:
+            queue_status( axis, 1, ready_us ); // still from the old address
+            axis.address = 0xE0 + frame[2];
+            break;
+        case 0x91:
+            set_encoder( index, 0 );
+            queue_status( axis, 1, ready_us );
+            break;
+        case 0x92:
+            axis.zero_speed = frame[2];
+            queue_status( axis, 1, ready_us );
+            break;
+        case 0x94: {
+            stop( axis, now_us() );
+            int64_t encoder  = get_encoder( index );
+            double  distance = fabs( (double)encoder ) * axis.microsteps * axis.full_steps / 65536.0;
+            bool    down     = ( encoder > 0 ) != axis.encoder_inverted;
+            speed = ( axis.zero_speed + 1 ) * 16 * MKS_EMULATOR_STEPS_PER_SPEED;
+            set_segment( axis, ready_us + config.goto_zero_delay * 1000ULL, down ? -speed : speed, distance, false );
+            queue_status( axis, 1, ready_us );
+            break;
+        }
+        case 0xA1:
+            axis.kp = ( (uint16_t)frame[2] << 8 ) | frame[3];
+            queue_status( axis, 1, ready_us );
+            break;
+        case 0xA3:
+            axis.kd = ( (uint16_t)frame[2] << 8 ) | frame[3];
+            queue_status( axis, 1, ready_us );
+            break;
+        case 0xF3:
+            axis.enabled = frame[2] != 0;
+            queue_status( axis, 1, ready_us );
+            break;
+        case 0xF6:
+            stop( axis, now_us() );
+            speed = ( frame[2] & 0x7F ) * MKS_EMULATOR_STEPS_PER_SPEED;
+            set_segment( axis, ready_us, ( frame[2] & 0x80 ) ? -speed : speed, -1, false );
+            queue_status( axis, 1, ready_us );
+            break;
+        case 0xF7:
+            stop( axis, now_us() );
+            queue_status( axis, 1, ready_us );
+            break;
+        case 0xFD: {
+            uint32_t steps = ( (uint32_t)frame[3] << 24 ) | ( (uint32_t)frame[4] << 16 ) | ( (uint32_t)frame[5] << 8 ) | frame[6];
+            speed = ( frame[2] & 0x7F ) * MKS_EMULATOR_STEPS_PER_SPEED;
+            if( speed == 0 || !axis.enabled ){
+                queue_status( axis, 0, ready_us );
+                break;
+            }
+            stop( axis, now_us() );
+            queue_status( axis, 1, ready_us );
+            set_segment( axis, ready_us, ( frame[2] & 0x80 ) ? -speed : speed, steps, true );
+            break;
+        }
+        default:
+            queue_status( axis, 1, ready_us );
+            break;
+    }
+    (void)length;
+}
+
+//#########################################################################
+// HardwareSerial
+//#########################################################################
+int SERVO42C_EMULATOR::available(){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    uint64_t now = now_us();
+    run_scheduled( now );
+    int count = 0;
+    while( count < (int)rx_due.size() && rx_due[count] <= now ){
+        ++count;
+    }
+    return count;
+}
+
+int SERVO42C_EMULATOR::read(){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    if( available() == 0 ){
+        return -1;
+    }
+    int value = rx.front();
+    rx.pop_front();
+    rx_due.pop_front();
+    return value;
+}
+
+int SERVO42C_EMULATOR::peek(){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    return available() == 0 ? -1 : rx.front();
+}
+
+//#########################################################################
+// Writes complete at once, the wire time is added to the answer
+//#########################################################################
+void SERVO42C_EMULATOR::flush(){}
+
+size_t SERVO42C_EMULATOR::write( uint8_t value ){
+    return write( &value, 1 );
+}
+
+size_t SERVO42C_EMULATOR::write( const uint8_t *buffer, size_t size ){
+    std::lock_guard<std::recursive_mutex> guard( lock );
+    uint64_t now = now_us();
+    host_tx_free = std::max( now, host_tx_free ) + size * byte_time_us();
+    request.insert( request.end(), buffer, buffer + size );
+    while( request.size() >= 2 ){
+        if( request[0] < 0xE0 || request[0] > 0xEF ){
+            request.erase( request.begin() );
+            ++stats.bad_frames;
+            continue;
+        }
+        uint8_t length = request_length( request[1] );
+        if( request.size() < length ){
+            break;
+        }
+        if( checksum( request.data(), length - 1 ) != request[length - 1] ){
+            request.erase( request.begin() );
+            ++stats.bad_frames;
+            continue;
+        }
+        uint64_t ready = host_tx_free + config.latency_us;
+        run_scheduled( ready );
+        execute( request.data(), length, ready );
+        request.erase( request.begin(), request.begin() + length );
+    }
+    return size;
+}
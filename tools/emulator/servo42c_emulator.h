@@ -0,0 +1,163 @@
+#pragma once
+
+#ifndef SERVO42C_HOST_EMULATOR
+#define SERVO42C_HOST_EMULATOR
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//###############################################################
+// Bus emulator for host builds of the library
+// A HardwareSerial that answers like up to MKS_EMULATOR_MAX_DRIVES
+// drives on one bus. The motion is computed from the time, moves
+// answer status 1 and status 2 once the target is reached, goto
+// zero runs to encoder 0 and calibration answers after a while.
+// Optional wire time from the baudrate, answers drop or corrupt
+// at random with a fixed seed. Thread safe
+//
+// With set_plant() the shaft follows the commanded motion like a
+// second order system tuned by kp and kd (0xA1, 0xA3). At the
+// default gains it rings at about 30 Hz with a damping of 0.35,
+// kp scales the frequency, kd the damping. ki is not modelled.
+// The angle error is the commanded minus the shaft position and
+// the encoder reads the shaft. Without it the shaft is always at
+// the commanded position and the angle error is set by hand
+//###############################################################
+#include <Arduino.h>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+static const uint8_t MKS_EMULATOR_MAX_DRIVES = 10;
+static const uint8_t MKS_EMULATOR_MAX_FRAME  = 8;
+
+//###############################################################
+// baudrate:          0 = no wire time
+// latency_us:        drive processing time before it answers
+// drop_per_mille:    answers not sent
+// corrupt_per_mille: answers with a wrong checksum
+// seed:              random generator for drop and corrupt
+// calibrate_time:    ms until calibration reports success
+// goto_zero_delay:   ms between goto zero and the first motion
+//###############################################################
+struct servo42c_emulator_config {
+    uint32_t baudrate;
+    uint32_t latency_us;
+    uint16_t drop_per_mille;
+    uint16_t corrupt_per_mille;
+    uint32_t seed;
+    uint32_t calibrate_time;
+    uint32_t goto_zero_delay;
+};
+
+struct servo42c_emulator_stats {
+    uint32_t frames;     // valid frames addressed to a drive
+    uint32_t responses;  // answers sent including final status
+    uint32_t dropped;
+    uint32_t corrupted;
+    uint32_t bad_frames; // checksum errors and unknown addresses
+};
+
+class SERVO42C_EMULATOR : public HardwareSerial {
+
+    private:
+
+        // motion segment, position in microsteps, dir 0 counts up
+        struct drive {
+            bool     present;
+            uint8_t  address;
+            uint64_t start_us;
+            uint64_t end_us;        // 0 = runs until the next command
+            double   origin;
+            double   velocity;      // microsteps/s
+            bool     move_final;    // send status 2 at end_us
+            int64_t  encoder_offset;
+            bool     encoder_inverted;
+            int32_t  pulses;
+            int16_t  angle_error;
+            bool     enabled;
+            bool     shaft_locked;
+            uint16_t microsteps;
+            uint16_t full_steps;
+            uint8_t  zero_speed;
+            uint8_t  drop_next;     // answers to drop before the random ones
+            uint8_t  unsupported[32];
+            bool     plant;
+            uint64_t plant_us;      // time the plant was simulated to
+            double   plant_position;
+            double   plant_velocity;
+            uint16_t kp;
+            uint16_t kd;
+        };
+
+        struct scheduled_frame {
+            uint64_t due_us;
+            uint8_t  drive;
+            uint8_t  status;
+            bool     move;          // final status of a move, dropped by a stop
+        };
+
+        std::recursive_mutex          lock;
+        servo42c_emulator_config      config;
+        servo42c_emulator_stats       stats;
+        drive                         drives[MKS_EMULATOR_MAX_DRIVES];
+        std::vector<scheduled_frame>  scheduled;
+        std::deque<uint64_t>          rx_due;
+        std::deque<uint8_t>           rx;
+        std::vector<uint8_t>          request;
+        uint64_t                      host_tx_free;
+        uint64_t                      drive_tx_free;
+        uint32_t                      random_state;
+
+        static uint64_t now_us( void );
+        uint64_t byte_time_us( void );
+        uint32_t next_random( void );
+        int      find_drive( uint8_t address );
+        double   position( const drive &axis, uint64_t time_us );
+        double   velocity( const drive &axis, uint64_t time_us );
+        double   shaft( drive &axis, uint64_t time_us );
+        void     set_segment( drive &axis, uint64_t start_us, double velocity, double distance, bool move_final );
+        void     stop( drive &axis, uint64_t time_us );
+        void     run_scheduled( uint64_t time_us );
+        void     queue_frame( drive &axis, const uint8_t *data, uint8_t length, uint64_t ready_us );
+        void     queue_status( drive &axis, uint8_t status, uint64_t ready_us );
+        void     execute( const uint8_t *frame, uint8_t length, uint64_t ready_us );
+        
+    public:
+        SERVO42C_EMULATOR( const servo42c_emulator_config &config = default_config() );
+        static servo42c_emulator_config default_config( void );
+
+        void    add_drive( uint8_t address_num, uint16_t microsteps = 16 );
+        void    set_encoder( uint8_t address_num, int64_t encoder );
+        int64_t get_encoder( uint8_t address_num );
+        void    set_encoder_inverted( uint8_t address_num, bool inverted );
+        void    set_pulses( uint8_t address_num, int32_t pulses );
+        void    set_angle_error( uint8_t address_num, int16_t angle_error );
+        void    set_shaft_locked( uint8_t address_num, bool locked );
+        void    set_plant( uint8_t address_num, bool enabled );
+        void    set_command_supported( uint8_t address_num, uint8_t cmd, bool supported );
+        void    drop_responses( uint8_t address_num, uint8_t count );
+        bool    is_moving( uint8_t address_num );
+        void    get_stats( servo42c_emulator_stats &stats );
+
+        int     available( void );
+        int     read( void );
+        int     peek( void );
+        void    flush( void );
+        size_t  write( uint8_t value );
+        size_t  write( const uint8_t *buffer, size_t size );
+
+};
+
+
+#endif
\ No newline at end of file
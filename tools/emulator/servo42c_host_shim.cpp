@@ -0,0 +1,290 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// Host implementation of the stand-ins in stubs/
+// Link it with the library sources and the tool, see the build line
+// at the top of each tool
+//
+//####################################################################
+#include <Arduino.h>
+#include <Preferences.h>
+#include "freertos/queue.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdarg.h>
+#include <stdio.h>
+
+static const std::chrono::steady_clock::time_point host_start = std::chrono::steady_clock::now();
+
+unsigned long millis(){
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - host_start ).count();
+}
+
+unsigned long micros(){
+    // 32bit like on the MCU so wrap handling gets exercised the same way
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - host_start ).count();
+}
+
+void delay( uint32_t ms ){
+    std::this_thread::sleep_for( std::chrono::milliseconds( ms ) );
+}
+
+void delayMicroseconds( uint32_t us ){
+    std::this_thread::sleep_for( std::chrono::microseconds( us ) );
+}
+
+//#########################################################################
+// Critical sections. One lock for all muxes is enough on the host
+//#########################################################################
+static std::recursive_mutex &critical_lock(){
+    static std::recursive_mutex lock;
+    return lock;
+}
+
+void servo42c_host_enter_critical( portMUX_TYPE *mux ){
+    critical_lock().lock();
+    ++mux->count;
+}
+
+void servo42c_host_exit_critical( portMUX_TYPE *mux ){
+    --mux->count;
+    critical_lock().unlock();
+}
+
+//#########################################################################
+// Tasks
+//#########################################################################
+BaseType_t xTaskCreate( TaskFunction_t function, const char *, uint32_t, void *parameter, UBaseType_t, TaskHandle_t *handle ){
+    std::thread thread( function, parameter );
+    if( handle != NULL ){
+        *handle = (TaskHandle_t)1;
+    }
+    thread.detach();
+    return pdPASS;
+}
+
+void vTaskDelete( TaskHandle_t ){}
+
+void vTaskDelay( TickType_t ticks ){
+    delay( ticks );
+}
+
+TickType_t xTaskGetTickCount(){
+    return (TickType_t)millis();
+}
+
+void vTaskDelayUntil( TickType_t *previous_wake, TickType_t increment ){
+    *previous_wake += increment;
+    int32_t remaining = (int32_t)( *previous_wake - xTaskGetTickCount() );
+    if( remaining > 0 ){
+        delay( remaining );
+    }
+}
+
+//#########################################################################
+// Mutexes
+//#########################################################################
+SemaphoreHandle_t xSemaphoreCreateMutex(){
+    return new std::recursive_timed_mutex();
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(){
+    return new std::recursive_timed_mutex();
+}
+
+BaseType_t xSemaphoreTake( SemaphoreHandle_t semaphore, TickType_t ticks ){
+    std::recursive_timed_mutex *mutex = static_cast<std::recursive_timed_mutex*>( semaphore );
+    if( ticks == portMAX_DELAY ){
+        mutex->lock();
+        return pdTRUE;
+    }
+    return mutex->try_lock_for( std::chrono::milliseconds( ticks ) ) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive( SemaphoreHandle_t semaphore ){
+    static_cast<std::recursive_timed_mutex*>( semaphore )->unlock();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive( SemaphoreHandle_t semaphore, TickType_t ticks ){
+    return xSemaphoreTake( semaphore, ticks );
+}
+
+BaseType_t xSemaphoreGiveRecursive( SemaphoreHandle_t semaphore ){
+    return xSemaphoreGive( semaphore );
+}
+
+//#########################################################################
+// Queues
+//#########################################################################
+struct host_queue {
+    std::mutex                        lock;
+    std::condition_variable           changed;
+    std::deque<std::vector<uint8_t>>  items;
+    size_t                            length;
+    size_t                            item_size;
+};
+
+QueueHandle_t xQueueCreate( UBaseType_t length, UBaseType_t item_size ){
+    host_queue *queue = new host_queue();
+    queue->length    = length;
+    queue->item_size = item_size;
+    return queue;
+}
+
+BaseType_t xQueueSend( QueueHandle_t handle, const void *item, TickType_t ticks ){
+    host_queue *queue = static_cast<host_queue*>( handle );
+    std::unique_lock<std::mutex> guard( queue->lock );
+    if( !queue->changed.wait_for( guard, std::chrono::milliseconds( ticks ), [queue]{ return queue->items.size() < queue->length; } ) ){
+        return pdFALSE;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t*>( item );
+    queue->items.push_back( std::vector<uint8_t>( bytes, bytes + queue->item_size ) );
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive( QueueHandle_t handle, void *item, TickType_t ticks ){
+    host_queue *queue = static_cast<host_queue*>( handle );
+    std::unique_lock<std::mutex> guard( queue->lock );
+    if( !queue->changed.wait_for( guard, std::chrono::milliseconds( ticks ), [queue]{ return !queue->items.empty(); } ) ){
+        return pdFALSE;
+    }
+    memcpy( item, queue->items.front().data(), queue->item_size );
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting( QueueHandle_t handle ){
+    host_queue *queue = static_cast<host_queue*>( handle );
+    std::lock_guard<std::mutex> guard( queue->lock );
+    return (UBaseType_t)queue->items.size();
+}
+
+void vQueueDelete( QueueHandle_t handle ){
+    delete static_cast<host_queue*>( handle );
+}
+
+//#########################################################################
+// Print, the base Stream writes to stdout
+//#########################################################################
+size_t Stream::write( const uint8_t *buffer, size_t size ){
+    return fwrite( buffer, 1, size, stdout );
+}
+
+size_t Stream::print( const char *text ){
+    return write( (const uint8_t*)text, strlen( text ) );
+}
+
+size_t Stream::print( char value ){
+    return write( (uint8_t)value );
+}
+
+size_t Stream::print( int value, int base ){
+    return print( (long)value, base );
+}
+
+size_t Stream::print( unsigned int value, int base ){
+    return print( (unsigned long)value, base );
+}
+
+size_t Stream::print( long value, int base ){
+    return base == HEX ? printf( "%lX", value ) : printf( "%ld", value );
+}
+
+size_t Stream::print( unsigned long value, int base ){
+    return base == HEX ? printf( "%lX", value ) : printf( "%lu", value );
+}
+
+size_t Stream::print( double value, int digits ){
+    return printf( "%.*f", digits, value );
+}
+
+size_t Stream::println(){
+    return print( "\r\n" );
+}
+
+size_t Stream::println( const char *text ){
+    return print( text ) + println();
+}
+
+size_t Stream::printf( const char *format, ... ){
+    char    text[256];
+    va_list args;
+    va_start( args, format );
+    int length = vsnprintf( text, sizeof( text ), format, args );
+    va_end( args );
+    if( length < 0 ){
+        return 0;
+    }
+    return write( (const uint8_t*)text, (size_t)length < sizeof( text ) ? length : sizeof( text ) - 1 );
+}
+
+HardwareSerial Serial( 0 );
+
+//#########################################################################
+// Preferences
+//#########################################################################
+static std::map<std::string, std::vector<uint8_t>> &host_nvs(){
+    static std::map<std::string, std::vector<uint8_t>> nvs;
+    return nvs;
+}
+
+static std::string nvs_key( const char *name_space, const char *key ){
+    return std::string( name_space != NULL ? name_space : "" ) + "/" + key;
+}
+
+bool Preferences::begin( const char *_name_space, bool, const char * ){
+    name_space = _name_space;
+    return true;
+}
+
+void Preferences::end(){
+    name_space = NULL;
+}
+
+size_t Preferences::putBytes( const char *key, const void *value, size_t length ){
+    const uint8_t *bytes = static_cast<const uint8_t*>( value );
+    host_nvs()[nvs_key( name_space, key )] = std::vector<uint8_t>( bytes, bytes + length );
+    return length;
+}
+
+size_t Preferences::getBytes( const char *key, void *buffer, size_t length ){
+    std::map<std::string, std::vector<uint8_t>>::iterator entry = host_nvs().find( nvs_key( name_space, key ) );
+    if( entry == host_nvs().end() ){
+        return 0;
+    }
+    if( length > entry->second.size() ){
+        length = entry->second.size();
+    }
+    memcpy( buffer, entry->second.data(), length );
+    return length;
+}
+
+size_t Preferences::getBytesLength( const char *key ){
+    std::map<std::string, std::vector<uint8_t>>::iterator entry = host_nvs().find( nvs_key( name_space, key ) );
+    return entry == host_nvs().end() ? 0 : entry->second.size();
+}
+
+bool Preferences::remove( const char *key ){
+    return host_nvs().erase( nvs_key( name_space, key ) ) > 0;
+}
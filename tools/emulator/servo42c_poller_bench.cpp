@@ -0,0 +1,103 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// servo42c_poller_bench [seconds] [budget bytes/s]
+//
+// Runs SERVO42C_POLLER on Linux against the bus emulator at 38400
+// baud with 4 axes: axis 0 runs continuously, axis 1 stands with a
+// high angle error, axes 2 and 3 are idle. The same budget is run
+// twice, with the default weights and with all weights equal
+// (plain round-robin). Prints the effective per axis rates and
+// the total wire load of each run
+//
+// Build:
+//   g++ -std=gnu++11 -O2 -pthread -Istubs -I../../lib/mks42c servo42c_host_shim.cpp servo42c_emulator.cpp 
+//       ../../lib/mks42c/*.cpp servo42c_poller_bench.cpp -o servo42c_poller_bench
+//
+//####################################################################
+#include "servo42c_emulator.h"
+#include "servo42c_poller.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static const uint8_t BENCH_AXES = 4;
+
+static void run_bench( const char *name, const servo42c_poller_config &config, int seconds ){
+    servo42c_emulator_config bus_config = SERVO42C_EMULATOR::default_config();
+    bus_config.baudrate = 38400;
+    SERVO42C_EMULATOR bus( bus_config );
+    SERVO42C  servos[BENCH_AXES];
+    SERVO42C *axes[BENCH_AXES];
+    for( uint8_t i = 0; i < BENCH_AXES; ++i ){
+        bus.add_drive( i );
+        servos[i].init( bus );
+        servos[i].set_slave_address( i ); // host side only, the drive already has it
+        axes[i] = &servos[i];
+    }
+    bus.set_angle_error( 1, 2000 ); // ~11°, above the default threshold
+    servos[0].set_run_continuous( 0, 10 );
+
+    SERVO42C_POLLER poller;
+    poller.init( axes, BENCH_AXES, config );
+    // one rate window to settle the weights, then measure
+    unsigned long start = millis();
+    while( millis() - start < MKS_POLLER_RATE_WINDOW ){
+        poller.poll();
+        delay( 1 );
+    }
+    poller.reset_stats();
+    start = millis();
+    while( millis() - start < (unsigned long)seconds * 1000 ){
+        poller.poll();
+        delay( 1 );
+    }
+    unsigned long elapsed = millis() - start;
+
+    printf( "%s, budget %u bytes/s\n", name, config.budget );
+    printf( "%5s %7s %7s %10s %10s %10s %8s\n", "axis", "weight", "state", "encoder/s", "slots/s", "bytes/s", "errors" );
+    uint64_t bytes = 0;
+    for( uint8_t i = 0; i < BENCH_AXES; ++i ){
+        servo42c_poller_stats stats;
+        poller.get_stats( i, stats );
+        uint32_t axis_bytes = 0;
+        for( uint8_t n = 0; n < MKS_INPUT_COUNT; ++n ){
+            axis_bytes += stats.reads[n] * MKS_POLLER_FRAME_BYTES[n];
+        }
+        bytes += axis_bytes;
+        printf( "%5u %7u %7s %10.1f %10.1f %10.0f %8u\n", i, stats.weight, stats.moving ? "moving" : stats.high_error ? "error" : "idle",
+                stats.reads[MKS_INPUT_ENCODER] * 1000.0 / elapsed, stats.slots * 1000.0 / elapsed, axis_bytes * 1000.0 / elapsed, stats.errors );
+    }
+    printf( "total %.0f bytes/s over %lu ms\n\n", bytes * 1000.0 / elapsed, elapsed );
+    servos[0].set_stop_motor();
+}
+
+int main( int argc, char **argv ){
+    int seconds = argc > 1 ? atoi( argv[1] ) : 5;
+    servo42c_poller_config config = SERVO42C_POLLER::default_config();
+    if( argc > 2 ){
+        config.budget = strtoul( argv[2], NULL, 0 );
+    }
+    if( seconds < 1 || config.budget == 0 ){
+        fprintf( stderr, "usage: servo42c_poller_bench [seconds] [budget bytes/s]\n" );
+        return 1;
+    }
+    run_bench( "adaptive", config, seconds );
+    servo42c_poller_config round_robin = config;
+    round_robin.idle_weight   = 1;
+    round_robin.moving_weight = 1;
+    round_robin.error_weight  = 0;
+    run_bench( "round-robin", round_robin, seconds );
+    return 0;
+}
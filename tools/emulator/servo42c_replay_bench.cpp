@@ -0,0 +1,187 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// servo42c_replay_bench [record|replay capture_file]
+//
+// Host side replayer for SERVO42C_CAPTURE and a benchmark of the
+// response parser and the retry path, built for Linux against the
+// host stand-ins in stubs/ and the bus emulator.
+//
+// A fixed workload of reads with a continuous run and stop now and
+// then goes to one emulated drive with dropped and corrupted answers
+// while the traffic is captured. The same workload then runs against
+// SERVO42C_REPLAY. A lost answer costs the full MKS_WAIT_TIMEOUT on
+// the emulator, on the replay the timeout runs on the recorded time.
+// Every call has to give the same result as in the recording and all
+// TX frames have to match. The replay is repeated to time the parser
+// and retry path without wire time.
+//
+//   no arguments   record into memory, replay and benchmark
+//   record file    record and write the capture to file
+//   replay file    replay a capture written by record
+//
+// Exits with 1 if the replay did not match the recording
+//
+// Build:
+//   g++ -std=gnu++11 -O2 -pthread -Istubs -I../../lib/mks42c servo42c_host_shim.cpp servo42c_emulator.cpp 
+//       ../../lib/mks42c/*.cpp servo42c_replay_bench.cpp -o servo42c_replay_bench
+//
+//####################################################################
+#include "servo42c_emulator.h"
+#include "servo42c.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static const uint32_t REPLAY_CALLS          = 400;
+static const uint16_t REPLAY_DROP_PER_MILLE = 5;
+static const uint16_t REPLAY_CORRUPT_PER_MILLE = 5;
+static const uint32_t REPLAY_SEED           = 42;
+static const uint32_t REPLAY_REPEAT         = 50;
+static const size_t   REPLAY_BUFFER_SIZE    = 1 << 20;
+
+static uint64_t now_us(){
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+//#########################################################################
+// Runs the workload and returns one value per call. A failed call is
+// only its result, the telemetry would still hold the older value
+//#########################################################################
+static void run_workload( HardwareSerial &serial, SERVO42C_REPLAY *replay, SERVO42C_CAPTURE *capture, std::vector<int64_t> &results ){
+    SERVO42C servo;
+    servo.init( serial );
+    servo.set_replay( replay );
+    servo.set_capture( capture );
+    results.clear();
+    for( uint32_t i = 0; i < REPLAY_CALLS; ++i ){
+        if( i % 100 == 50 ){
+            results.push_back( servo.set_run_continuous( ( i / 100 ) & 1, 10 ) );
+            continue;
+        } else if( i % 100 == 60 ){
+            results.push_back( servo.set_stop_motor() );
+            continue;
+        }
+        uint8_t input = i % MKS_INPUT_COUNT;
+        bool    ok    = servo.read_input( input );
+        servo42c_telemetry snapshot;
+        servo.get_telemetry( snapshot );
+        int64_t value = 0;
+        switch( input ){
+            case MKS_INPUT_ENCODER:      value = snapshot.encoder;      break;
+            case MKS_INPUT_PULSES:       value = snapshot.pulses;       break;
+            case MKS_INPUT_ANGLE_ERROR:  value = snapshot.angle_error;  break;
+            case MKS_INPUT_ENABLE_STATE: value = snapshot.enabled;      break;
+            case MKS_INPUT_LOCK_STATE:   value = snapshot.shaft_locked; break;
+        }
+        results.push_back( ok ? value : INT64_MIN );
+    }
+    servo.set_capture( NULL );
+    servo.set_replay( NULL );
+}
+
+static void record( std::vector<uint8_t> &capture_data, std::vector<int64_t> &results ){
+    servo42c_emulator_config config = SERVO42C_EMULATOR::default_config();
+    config.drop_per_mille    = REPLAY_DROP_PER_MILLE;
+    config.corrupt_per_mille = REPLAY_CORRUPT_PER_MILLE;
+    config.seed              = REPLAY_SEED;
+    SERVO42C_EMULATOR bus( config );
+    bus.add_drive( 0 );
+    bus.set_encoder( 0, 123456 );
+    bus.set_pulses( 0, -4321 );
+    bus.set_angle_error( 0, 77 );
+
+    std::vector<uint8_t> buffer( REPLAY_BUFFER_SIZE );
+    SERVO42C_CAPTURE capture;
+    capture.init( &buffer[0], buffer.size() );
+
+    uint64_t start = now_us();
+    run_workload( bus, NULL, &capture, results );
+    uint64_t took  = now_us() - start;
+
+    capture_data.resize( MKS_CAPTURE_HEADER_SIZE );
+    SERVO42C_CAPTURE::write_header( &capture_data[0] );
+    size_t header = capture_data.size();
+    capture_data.resize( header + capture.available() );
+    capture_data.resize( header + capture.read( &capture_data[header], capture_data.size() - header ) );
+
+    servo42c_emulator_stats stats;
+    bus.get_stats( stats );
+    uint32_t failed = 0;
+    for( size_t i = 0; i < results.size(); ++i ){
+        if( results[i] == INT64_MIN ){ ++failed; }
+    }
+    printf( "record: %u calls in %.1f s, %u answers dropped, %u corrupted, %u failed reads, capture %u bytes, %u records lost\n",
+            REPLAY_CALLS, took / 1e6, stats.dropped, stats.corrupted, failed, (unsigned)capture_data.size(), capture.get_dropped() );
+}
+
+//#########################################################################
+// Replays the capture once to compare and then repeatedly to time it
+//#########################################################################
+static bool replay( const std::vector<uint8_t> &capture_data, const std::vector<int64_t> *expected ){
+    SERVO42C_REPLAY player( &capture_data[0], capture_data.size() );
+    std::vector<int64_t> results;
+    run_workload( player, &player, NULL, results );
+    servo42c_replay_stats stats;
+    player.get_stats( stats );
+    uint32_t failed = 0;
+    for( size_t i = 0; i < results.size(); ++i ){
+        if( results[i] == INT64_MIN ){ ++failed; }
+    }
+    uint32_t different = 0;
+    if( expected != NULL ){
+        for( size_t i = 0; i < results.size() && i < expected->size(); ++i ){
+            if( results[i] != (*expected)[i] ){ ++different; }
+        }
+    }
+    printf( "replay: %u tx frames (%u retries), %u mismatched, %u rx bytes, %u failed reads, %u results differ, replay clock %u ms\n",
+            stats.tx_frames, stats.tx_frames > REPLAY_CALLS ? stats.tx_frames - REPLAY_CALLS : 0, stats.tx_mismatch, stats.rx_bytes, 
+            failed, different, player.get_millis() );
+
+    uint64_t start = now_us();
+    for( uint32_t i = 0; i < REPLAY_REPEAT; ++i ){
+        player.rewind();
+        run_workload( player, &player, NULL, results );
+    }
+    uint64_t took = now_us() - start;
+    printf( "bench:  %u replays, %.2f us per call, %.1f ns per byte served\n", REPLAY_REPEAT, 
+            (double)took / ( REPLAY_REPEAT * REPLAY_CALLS ), 1000.0 * took / ( (double)REPLAY_REPEAT * stats.rx_bytes ) );
+    return stats.tx_mismatch == 0 && stats.finished && different == 0;
+}
+
+int main( int argc, char **argv ){
+    std::vector<uint8_t> capture_data;
+    std::vector<int64_t> results;
+    if( argc == 3 && strcmp( argv[1], "replay" ) == 0 ){
+        FILE *file = fopen( argv[2], "rb" );
+        if( file == NULL ){ perror( argv[2] ); return 1; }
+        uint8_t chunk[4096];
+        size_t  length;
+        while( ( length = fread( chunk, 1, sizeof( chunk ), file ) ) > 0 ){
+            capture_data.insert( capture_data.end(), chunk, chunk + length );
+        }
+        fclose( file );
+        return replay( capture_data, NULL ) ? 0 : 1;
+    }
+    record( capture_data, results );
+    if( argc == 3 && strcmp( argv[1], "record" ) == 0 ){
+        FILE *file = fopen( argv[2], "wb" );
+        if( file == NULL || fwrite( &capture_data[0], 1, capture_data.size(), file ) != capture_data.size() ){ perror( argv[2] ); return 1; }
+        fclose( file );
+        return 0;
+    }
+    return replay( capture_data, &results ) ? 0 : 1;
+}
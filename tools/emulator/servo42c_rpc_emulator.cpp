@@ -0,0 +1,154 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// servo42c_rpc_emulator [link] [axes]
+//
+// Runs SERVO42C_RPC on Linux against emulated drives and serves it
+// on a pseudo terminal, so tools/rpc_client can be used without the
+// hardware. The pty name is printed, with link given a symlink to it
+// is created too. axes defaults to 3, one emulated bus for all.
+// A sequence runner is attached like in src/main.cpp
+//
+//   ./servo42c_rpc_emulator /tmp/servo42c &
+//   ../rpc_client/servo42c_rpc_cli /tmp/servo42c encoder 0 + move 1 0 20 3200
+//
+// Build:
+//   g++ -std=gnu++11 -O2 -pthread -Istubs -I../../lib/mks42c servo42c_host_shim.cpp servo42c_emulator.cpp 
+//       ../../lib/mks42c/*.cpp servo42c_rpc_emulator.cpp -o servo42c_rpc_emulator
+//
+//####################################################################
+#include "servo42c_emulator.h"
+#include "servo42c_rpc.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+//#########################################################################
+// Stream on the master side of a pty. The slave side stays open here
+// too, otherwise the master reads EIO whenever no client is connected
+//#########################################################################
+class SERVO42C_PTY_STREAM : public Stream {
+
+    private:
+
+        int master;
+        int slave;
+        int next;   // byte read ahead by available(), -1 if none
+
+    public:
+        SERVO42C_PTY_STREAM() : master( -1 ), slave( -1 ), next( -1 ) {}
+
+        const char *open_pty(){
+            master = posix_openpt( O_RDWR | O_NOCTTY );
+            if( master < 0 || grantpt( master ) != 0 || unlockpt( master ) != 0 ){
+                return NULL;
+            }
+            const char *name = ptsname( master );
+            slave = open( name, O_RDWR | O_NOCTTY );
+            struct termios tio;
+            if( slave >= 0 && tcgetattr( slave, &tio ) == 0 ){
+                cfmakeraw( &tio );
+                tcsetattr( slave, TCSANOW, &tio );
+            }
+            fcntl( master, F_SETFL, fcntl( master, F_GETFL ) | O_NONBLOCK );
+            return name;
+        }
+
+        int available(){
+            if( next < 0 ){
+                uint8_t value;
+                if( ::read( master, &value, 1 ) == 1 ){
+                    next = value;
+                }
+            }
+            return next < 0 ? 0 : 1;
+        }
+
+        int read(){
+            available();
+            int value = next;
+            next      = -1;
+            return value;
+        }
+
+        int peek(){
+            available();
+            return next;
+        }
+
+        size_t write( const uint8_t *buffer, size_t size ){
+            size_t done = 0;
+            while( done < size ){
+                ssize_t written = ::write( master, buffer + done, size - done );
+                if( written > 0 ){
+                    done += written;
+                } else if( written < 0 && errno != EAGAIN && errno != EINTR ){
+                    break;
+                } else {
+                    delayMicroseconds( 100 ); // pty buffer full, the client reads it
+                }
+            }
+            return done;
+        }
+
+};
+
+int main( int argc, char **argv ){
+    const char *link = argc > 1 ? argv[1] : NULL;
+    int         count = argc > 2 ? atoi( argv[2] ) : 3;
+    if( count < 1 || count > MKS_RPC_MAX_AXES ){
+        fprintf( stderr, "axes: 1 to %u\n", MKS_RPC_MAX_AXES );
+        return 1;
+    }
+
+    SERVO42C_PTY_STREAM port;
+    const char *name = port.open_pty();
+    if( name == NULL ){
+        perror( "pty" );
+        return 1;
+    }
+    if( link != NULL ){
+        unlink( link );
+        if( symlink( name, link ) != 0 ){
+            perror( link );
+            return 1;
+        }
+    }
+
+    SERVO42C_EMULATOR bus;
+    SERVO42C          servos[MKS_RPC_MAX_AXES];
+    SERVO42C         *axes[MKS_RPC_MAX_AXES];
+    for( int i = 0; i < count; ++i ){
+        bus.add_drive( i );
+        servos[i].init( bus );
+        servos[i].set_slave_address( i );
+        axes[i] = &servos[i];
+    }
+    SERVO42C_SEQUENCE sequence;
+    sequence.init( axes, count );
+    SERVO42C_RPC rpc;
+    rpc.init( port, axes, count );
+    rpc.set_sequence( &sequence );
+
+    printf( "%u axes on %s%s%s\n", count, name, link != NULL ? " -> " : "", link != NULL ? link : "" );
+    fflush( stdout );
+    while( true ){
+        rpc.poll();
+        vTaskDelay( 1 );
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#ifndef SERVO42C_HOST_HARDWARESERIAL
+#define SERVO42C_HOST_HARDWARESERIAL
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define HEX 16
+#define DEC 10
+
+unsigned long millis( void );
+unsigned long micros( void );
+void          delay( uint32_t ms );
+void          delayMicroseconds( uint32_t us );
+
+//###############################################################
+// Stream as in the Arduino core. The I/O methods are virtual so
+// emulators and ptys can stand in for a UART. The base class
+// has no data, print goes to stdout
+//###############################################################
+class Stream {
+
+    public:
+        virtual ~Stream(){}
+        virtual int    available( void ){ return 0; }
+        virtual int    read( void ){ return -1; }
+        virtual int    peek( void ){ return -1; }
+        virtual void   flush( void ){}
+        virtual size_t write( uint8_t value ){ return write( &value, 1 ); }
+        virtual size_t write( const uint8_t *buffer, size_t size );
+
+        size_t print( const char *text );
+        size_t print( char value );
+        size_t print( int value, int base = DEC );
+        size_t print( unsigned int value, int base = DEC );
+        size_t print( long value, int base = DEC );
+        size_t print( unsigned long value, int base = DEC );
+        size_t print( double value, int digits = 2 );
+        size_t println( void );
+        size_t println( const char *text );
+        size_t printf( const char *format, ... );
+
+};
+
+class HardwareSerial : public Stream {
+
+    public:
+        HardwareSerial( int uart_nr ){ (void)uart_nr; }
+        void begin( unsigned long baud, uint32_t config = 0, int8_t rx_pin = -1, int8_t tx_pin = -1 ){ (void)baud; (void)config; (void)rx_pin; (void)tx_pin; }
+        void end( void ){}
+
+};
+
+extern HardwareSerial Serial;
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#ifndef SERVO42C_HOST_PREFERENCES
+#define SERVO42C_HOST_PREFERENCES
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include <stdint.h>
+#include <stddef.h>
+
+//###############################################################
+// NVS stand-in, keeps the keys in memory for the process lifetime
+//###############################################################
+class Preferences {
+
+    private:
+        const char *name_space;
+
+    public:
+        Preferences() : name_space( NULL ) {}
+        bool   begin( const char *name_space, bool read_only = false, const char *partition = NULL );
+        void   end( void );
+        size_t putBytes( const char *key, const void *value, size_t length );
+        size_t getBytes( const char *key, void *buffer, size_t length );
+        size_t getBytesLength( const char *key );
+        bool   remove( const char *key );
+
+};
+
+
+#endif
\ No newline at end of file
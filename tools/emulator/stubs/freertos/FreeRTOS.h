@@ -0,0 +1,56 @@
+#pragma once
+
+#ifndef SERVO42C_HOST_FREERTOS
+#define SERVO42C_HOST_FREERTOS
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//###############################################################
+// Host stand-ins for the FreeRTOS and Arduino API the library
+// uses. Just enough to build lib/mks42c on Linux for the tools
+// in this directory. Tasks are std::threads, critical sections
+// one global recursive mutex and ticks are milliseconds
+//###############################################################
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define portMAX_DELAY          0xFFFFFFFFUL
+#define portTICK_PERIOD_MS     1
+#define pdMS_TO_TICKS( ms )    ( ms )
+#define pdTRUE                 1
+#define pdFALSE                0
+#define pdPASS                 1
+#define pdFAIL                 0
+#define configMAX_PRIORITIES   25
+#define tskNO_AFFINITY         0x7FFFFFFF
+
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+#define portMUX_INITIALIZE( mux )    ( ( mux )->owner = 0, ( mux )->count = 0 )
+#define portENTER_CRITICAL( mux )    servo42c_host_enter_critical( mux )
+#define portEXIT_CRITICAL( mux )     servo42c_host_exit_critical( mux )
+
+void servo42c_host_enter_critical( portMUX_TYPE *mux );
+void servo42c_host_exit_critical( portMUX_TYPE *mux );
+
+
+#endif
\ No newline at end of file
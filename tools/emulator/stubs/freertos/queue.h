@@ -0,0 +1,30 @@
+#pragma once
+
+#ifndef SERVO42C_HOST_QUEUE
+#define SERVO42C_HOST_QUEUE
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "FreeRTOS.h"
+
+typedef void *QueueHandle_t;
+
+QueueHandle_t xQueueCreate( UBaseType_t length, UBaseType_t item_size );
+BaseType_t    xQueueSend( QueueHandle_t queue, const void *item, TickType_t ticks );
+BaseType_t    xQueueReceive( QueueHandle_t queue, void *item, TickType_t ticks );
+UBaseType_t   uxQueueMessagesWaiting( QueueHandle_t queue );
+void          vQueueDelete( QueueHandle_t queue );
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#ifndef SERVO42C_HOST_SEMPHR
+#define SERVO42C_HOST_SEMPHR
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "FreeRTOS.h"
+
+typedef void *SemaphoreHandle_t;
+
+// all mutexes are recursive on the host
+SemaphoreHandle_t xSemaphoreCreateMutex( void );
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex( void );
+BaseType_t        xSemaphoreTake( SemaphoreHandle_t semaphore, TickType_t ticks );
+BaseType_t        xSemaphoreGive( SemaphoreHandle_t semaphore );
+BaseType_t        xSemaphoreTakeRecursive( SemaphoreHandle_t semaphore, TickType_t ticks );
+BaseType_t        xSemaphoreGiveRecursive( SemaphoreHandle_t semaphore );
+
+
+#endif
\ No newline at end of file
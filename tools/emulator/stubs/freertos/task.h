@@ -0,0 +1,32 @@
+#pragma once
+
+#ifndef SERVO42C_HOST_TASK
+#define SERVO42C_HOST_TASK
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+#include "FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+typedef void ( *TaskFunction_t )( void * );
+
+// priority and stack size are ignored, the task runs in a detached thread
+BaseType_t xTaskCreate( TaskFunction_t function, const char *name, uint32_t stack_size, void *parameter, UBaseType_t priority, TaskHandle_t *handle );
+void       vTaskDelete( TaskHandle_t handle ); // only NULL at the end of the task function
+void       vTaskDelay( TickType_t ticks );
+void       vTaskDelayUntil( TickType_t *previous_wake, TickType_t increment );
+TickType_t xTaskGetTickCount( void );
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,527 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+// 
+// Host driver for drives on Linux serial ports
+//
+// Build together with the benchmark:
+//   g++ -std=c++11 -O2 -pthread servo42c_host.cpp servo42c_host_bench.cpp -o servo42c_host_bench
+//
+//####################################################################
+#include "servo42c_host.h"
+#include <condition_variable>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <termios.h>
+#include <unistd.h>
+#include <time.h>
+
+static uint64_t now_us(){
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+uint8_t servo42c_host_checksum( const uint8_t *data, size_t length ){
+    uint8_t sum = 0;
+    for( size_t i = 0; i < length; ++i ){
+        sum += data[i];
+    }
+    return sum;
+}
+
+uint8_t servo42c_host_data_length( uint8_t cmd ){
+    switch( cmd ){
+        case 0x30: case 0x33: case 0x36: case 0x39: case 0x3A:
+        case 0x3D: case 0x3E: case 0x3F: case 0xF7:
+            return 0;
+        case 0xA1: case 0xA2: case 0xA3: case 0xA4: case 0xA5:
+            return 2;
+        case 0xFD:
+            return 5;
+    }
+    if( ( cmd >= 0x80 && cmd <= 0x8B ) || ( cmd >= 0x90 && cmd <= 0x94 ) || cmd == 0xF3 || cmd == 0xF6 || cmd == 0xFF ){
+        return 1;
+    }
+    return 0;
+}
+
+uint8_t servo42c_host_response_length( uint8_t cmd ){
+    switch( cmd ){
+        case 0x30: return 8;
+        case 0x33: return 6;
+        case 0x36: return 6;
+        case 0x39: return 4;
+    }
+    if( cmd == 0x3A || cmd == 0x3D || cmd == 0x3E || cmd == 0x3F || cmd == 0xF7 || servo42c_host_data_length( cmd ) > 0 ){
+        return 3;
+    }
+    return 0;
+}
+
+//#########################################################################
+// Commands whose answer can be status 2, which is also the final status
+// of a 0xFD move. And commands that end a move, its final status with it
+//#########################################################################
+static bool answers_status_2( uint8_t cmd ){
+    return cmd == 0x3A || cmd == 0x3E || cmd == 0x80;
+}
+
+static bool ends_move( uint8_t cmd ){
+    return cmd == 0xF6 || cmd == 0xF7 || cmd == 0xFD;
+}
+
+static speed_t termios_speed( uint32_t baudrate ){
+    switch( baudrate ){
+        case 9600:   return B9600;
+        case 19200:  return B19200;
+        case 38400:  return B38400;
+        case 57600:  return B57600;
+        case 115200: return B115200;
+    }
+    return B38400; // 25000 is not a standard rate, set it with the adapter tool
+}
+
+SERVO42C_HOST::SERVO42C_HOST() : record_latencies( false ), epoll_fd( -1 ), wake_fd( -1 ), running( false ) {}
+
+SERVO42C_HOST::~SERVO42C_HOST(){
+    stop();
+    for( size_t i = 0; i < ports.size(); ++i ){
+        close( ports[i]->fd );
+        delete ports[i];
+    }
+}
+
+//#########################################################################
+// Open a tty in raw mode. Ports have to be added before start()
+// pipeline_depth: requests in flight on the bus, 1 = strict request and
+// answer. Above 1 answers can collide, see servo42c_host.h. Returns the
+// port index or -1
+//#########################################################################
+int SERVO42C_HOST::add_port( const char *device, uint32_t baudrate, uint8_t pipeline_depth ){
+    if( running ){
+        return -1;
+    }
+    int fd = open( device, O_RDWR | O_NOCTTY | O_NONBLOCK );
+    if( fd < 0 ){
+        return -1;
+    }
+    struct termios tio;
+    if( tcgetattr( fd, &tio ) == 0 ){
+        cfmakeraw( &tio );
+        cfsetispeed( &tio, termios_speed( baudrate ) );
+        cfsetospeed( &tio, termios_speed( baudrate ) );
+        tio.c_cflag |= CLOCAL | CREAD;
+        tcsetattr( fd, TCSANOW, &tio );
+    }
+    port *p          = new port();
+    p->fd            = fd;
+    p->index         = ports.size();
+    p->depth         = pipeline_depth == 0 ? 1 : pipeline_depth;
+    p->tx_waiting    = false;
+    p->final_pending = 0;
+    p->stats         = servo42c_host_stats();
+    ports.push_back( p );
+    return (int)ports.size() - 1;
+}
+
+bool SERVO42C_HOST::start(){
+    if( running ){
+        return false;
+    }
+    epoll_fd = epoll_create1( 0 );
+    wake_fd  = eventfd( 0, EFD_NONBLOCK );
+    if( epoll_fd < 0 || wake_fd < 0 ){
+        return false;
+    }
+    struct epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+    event.events   = EPOLLIN;
+    event.data.u32 = 0xFFFFFFFF;
+    epoll_ctl( epoll_fd, EPOLL_CTL_ADD, wake_fd, &event );
+    for( size_t i = 0; i < ports.size(); ++i ){
+        event.data.u32 = i;
+        epoll_ctl( epoll_fd, EPOLL_CTL_ADD, ports[i]->fd, &event );
+    }
+    running = true;
+    thread  = std::thread( &SERVO42C_HOST::run, this );
+    return true;
+}
+
+//#########################################################################
+// Ends the I/O thread. Requests still queued or in flight complete with
+// ok = false, submit() refuses new ones from now on
+//#########################################################################
+void SERVO42C_HOST::stop(){
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        if( !running ){
+            return;
+        }
+        running = false;
+    }
+    uint64_t one = 1;
+    if( write( wake_fd, &one, sizeof( one ) ) < 0 ){}
+    thread.join();
+    close( epoll_fd );
+    close( wake_fd );
+    epoll_fd = wake_fd = -1;
+}
+
+//#########################################################################
+// Queue a request. Safe from any thread. The callback runs on the I/O
+// thread and has to return quickly. It may submit new requests
+// address: 0 - 9, data: data bytes of the command
+// 0x80 waits at least MKS_HOST_CALIBRATE_TIMEOUT, it answers at the end
+//#########################################################################
+bool SERVO42C_HOST::submit( int port_index, uint8_t address, uint8_t cmd, const uint8_t *data, uint8_t data_length, 
+                            servo42c_host_callback callback, uint32_t timeout_ms ){
+    uint8_t response_length = servo42c_host_response_length( cmd );
+    if( port_index < 0 || port_index >= (int)ports.size() || data_length > MKS_HOST_MAX_DATA || response_length == 0 || address >= MKS_HOST_MAX_ADDRESSES ){
+        return false;
+    }
+    if( cmd == 0x80 && timeout_ms < MKS_HOST_CALIBRATE_TIMEOUT ){
+        timeout_ms = MKS_HOST_CALIBRATE_TIMEOUT;
+    }
+    request r;
+    r.frame[0] = 0xE0 + address;
+    r.frame[1] = cmd;
+    if( data_length > 0 ){
+        memcpy( r.frame + 2, data, data_length );
+    }
+    r.frame[2 + data_length] = servo42c_host_checksum( r.frame, 2 + data_length );
+    r.frame_length    = 3 + data_length;
+    r.response_length = response_length;
+    r.timeout         = timeout_ms;
+    r.submitted       = now_us();
+    r.deadline        = 0;
+    r.callback        = callback;
+    bool wake;
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        if( !running ){
+            // checked under the lock, stop() can't drain before this is queued
+            return false;
+        }
+        wake = submissions.empty();
+        submissions.push_back( std::make_pair( port_index, r ) );
+        ++ports[port_index]->stats.queued;
+    }
+    if( wake ){
+        uint64_t one = 1;
+        if( write( wake_fd, &one, sizeof( one ) ) < 0 ){}
+    }
+    return true;
+}
+
+//#########################################################################
+// Blocking request. Response needs room for the full answer
+//#########################################################################
+bool SERVO42C_HOST::transact( int port_index, uint8_t address, uint8_t cmd, const uint8_t *data, uint8_t data_length, 
+                              uint8_t *response, uint32_t timeout_ms ){
+    std::mutex              done_lock;
+    std::condition_variable done_signal;
+    bool                    done    = false;
+    bool                    success = false;
+    servo42c_host_callback callback = [&]( bool ok, const uint8_t *answer, uint8_t length, uint32_t ){
+        std::lock_guard<std::mutex> guard( done_lock );
+        if( ok ){
+            memcpy( response, answer, length );
+        }
+        success = ok;
+        done    = true;
+        done_signal.notify_one();
+    };
+    if( !submit( port_index, address, cmd, data, data_length, callback, timeout_ms ) ){
+        return false;
+    }
+    std::unique_lock<std::mutex> guard( done_lock );
+    done_signal.wait( guard, [&]{ return done; } );
+    return success;
+}
+
+bool SERVO42C_HOST::read_encoder( int port_index, uint8_t address, int64_t &encoder ){
+    uint8_t response[MKS_HOST_MAX_RESPONSE];
+    if( !transact( port_index, address, 0x30, NULL, 0, response ) ){
+        return false;
+    }
+    int32_t  carrier = (int32_t)( ( (uint32_t)response[1] << 24 ) | ( (uint32_t)response[2] << 16 ) | ( (uint32_t)response[3] << 8 ) | response[4] );
+    uint16_t value   = (uint16_t)( ( response[5] << 8 ) | response[6] );
+    encoder = (int64_t)carrier * 65536 + value;
+    return true;
+}
+
+void SERVO42C_HOST::get_stats( int port_index, servo42c_host_stats &stats ){
+    std::lock_guard<std::mutex> guard( lock );
+    stats = ports[port_index]->stats;
+}
+
+//#########################################################################
+// Latency of every completed request in us, submit to answer
+//#########################################################################
+void SERVO42C_HOST::set_record_latencies( bool active ){
+    std::lock_guard<std::mutex> guard( lock );
+    record_latencies = active;
+}
+
+void SERVO42C_HOST::take_latencies( std::vector<uint32_t> &_latencies ){
+    std::lock_guard<std::mutex> guard( lock );
+    _latencies.swap( latencies );
+    latencies.clear();
+}
+
+//#########################################################################
+// I/O thread
+//#########################################################################
+void SERVO42C_HOST::run(){
+    struct epoll_event events[32];
+    while( running ){
+        int count = epoll_wait( epoll_fd, events, 32, next_timeout( now_us() ) );
+        for( int i = 0; i < count; ++i ){
+            if( events[i].data.u32 == 0xFFFFFFFF ){
+                uint64_t value;
+                if( read( wake_fd, &value, sizeof( value ) ) < 0 ){}
+                take_submissions();
+            } else {
+                port &p = *ports[events[i].data.u32];
+                if( events[i].events & EPOLLOUT ){
+                    flush_tx( p );
+                }
+                if( events[i].events & ( EPOLLIN | EPOLLERR | EPOLLHUP ) ){
+                    read_port( p );
+                }
+            }
+        }
+        uint64_t now = now_us();
+        for( size_t i = 0; i < ports.size(); ++i ){
+            expire( *ports[i], now );
+            send_pending( *ports[i] );
+        }
+    }
+    // submit() refuses new requests since running went false under the
+    // lock, everything queued before that is in submissions
+    take_submissions();
+    for( size_t i = 0; i < ports.size(); ++i ){
+        port &p = *ports[i];
+        while( !p.in_flight.empty() ){ complete( p, p.in_flight.front(), false, NULL ); p.in_flight.pop_front(); }
+        while( !p.pending.empty() ){ complete( p, p.pending.front(), false, NULL ); p.pending.pop_front(); }
+    }
+}
+
+void SERVO42C_HOST::take_submissions(){
+    std::vector<std::pair<int, request>> batch;
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        batch.swap( submissions );
+    }
+    for( size_t i = 0; i < batch.size(); ++i ){
+        ports[batch[i].first]->pending.push_back( batch[i].second );
+    }
+}
+
+//#########################################################################
+// Queue requests for writing while the pipeline has room. A request for
+// an address that is already in flight waits, answers are matched by
+// address. So does one that could answer status 2 while the final status
+// of a move of that address is still due
+//#########################################################################
+void SERVO42C_HOST::send_pending( port &p ){
+    while( !p.pending.empty() && p.in_flight.size() < p.depth ){
+        request &r       = p.pending.front();
+        uint8_t  address = r.frame[0] - 0xE0;
+        bool     busy    = answers_status_2( r.frame[1] ) && ( ( p.final_pending >> address ) & 1 );
+        for( size_t i = 0; i < p.in_flight.size(); ++i ){
+            busy |= p.in_flight[i].frame[0] == r.frame[0];
+        }
+        if( busy ){
+            break;
+        }
+        if( ends_move( r.frame[1] ) ){
+            p.final_pending &= ~( 1 << address );
+        }
+        request sent = r;
+        p.pending.pop_front();
+        sent.deadline = now_us() + (uint64_t)sent.timeout * 1000;
+        p.tx.insert( p.tx.end(), sent.frame, sent.frame + sent.frame_length );
+        p.in_flight.push_back( sent );
+    }
+    flush_tx( p );
+}
+
+//#########################################################################
+// Write what the fd takes. The rest waits for EPOLLOUT instead of
+// spinning on EAGAIN. A write error fails everything in flight
+//#########################################################################
+void SERVO42C_HOST::flush_tx( port &p ){
+    while( !p.tx.empty() ){
+        ssize_t n = write( p.fd, p.tx.data(), p.tx.size() );
+        if( n > 0 ){
+            p.tx.erase( p.tx.begin(), p.tx.begin() + n );
+        } else if( n < 0 && errno == EINTR ){
+            continue;
+        } else if( n < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) ){
+            break;
+        } else {
+            p.tx.clear();
+            while( !p.in_flight.empty() ){
+                request r = p.in_flight.front();
+                p.in_flight.pop_front();
+                complete( p, r, false, NULL );
+            }
+        }
+    }
+    bool waiting = !p.tx.empty();
+    if( waiting != p.tx_waiting ){
+        struct epoll_event event;
+        memset( &event, 0, sizeof( event ) );
+        event.events   = waiting ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.u32 = p.index;
+        epoll_ctl( epoll_fd, EPOLL_CTL_MOD, p.fd, &event );
+        p.tx_waiting = waiting;
+    }
+}
+
+//#########################################################################
+// Take a final status [address, 2, checksum] from the front of rx. Not if
+// the request in flight for the address could answer 2 itself
+//#########################################################################
+bool SERVO42C_HOST::take_final_status( port &p ){
+    uint8_t address = p.rx[0] - 0xE0;
+    if( p.rx.size() < 3 || address >= MKS_HOST_MAX_ADDRESSES || p.rx[1] != 2 || p.rx[2] != (uint8_t)( p.rx[0] + 2 ) ){
+        return false;
+    }
+    for( size_t i = 0; i < p.in_flight.size(); ++i ){
+        if( p.in_flight[i].frame[0] == p.rx[0] && answers_status_2( p.in_flight[i].frame[1] ) ){
+            return false;
+        }
+    }
+    p.final_pending &= ~( 1 << address );
+    p.rx.erase( p.rx.begin(), p.rx.begin() + 3 );
+    std::lock_guard<std::mutex> guard( lock );
+    ++p.stats.final_status;
+    return true;
+}
+
+void SERVO42C_HOST::read_port( port &p ){
+    uint8_t buffer[256];
+    ssize_t n;
+    while( ( n = read( p.fd, buffer, sizeof( buffer ) ) ) > 0 ){
+        p.rx.insert( p.rx.end(), buffer, buffer + n );
+    }
+    size_t dropped = 0;
+    while( !p.rx.empty() ){
+        size_t match = p.in_flight.size();
+        for( size_t i = 0; i < p.in_flight.size(); ++i ){
+            if( p.in_flight[i].frame[0] == p.rx[0] ){
+                match = i;
+                break;
+            }
+        }
+        if( match < p.in_flight.size() ){
+            request &r = p.in_flight[match];
+            if( p.rx.size() < r.response_length ){
+                break;
+            }
+            bool valid = servo42c_host_checksum( p.rx.data(), r.response_length - 1 ) == p.rx[r.response_length - 1];
+            if( valid && r.frame[1] == 0x80 && p.rx[1] == 0 ){
+                // still calibrating, the result comes later
+                p.rx.erase( p.rx.begin(), p.rx.begin() + r.response_length );
+                continue;
+            }
+            if( valid && r.response_length == 3 && take_final_status( p ) ){
+                continue; // the final status of an earlier move came first
+            }
+            if( valid ){
+                request done = r;
+                p.in_flight.erase( p.in_flight.begin() + match );
+                if( done.frame[1] == 0xFD && p.rx[1] == 1 ){
+                    // started, status 2 follows when the move is done
+                    uint32_t steps = ( (uint32_t)done.frame[3] << 24 ) | ( (uint32_t)done.frame[4] << 16 ) | ( (uint32_t)done.frame[5] << 8 ) | done.frame[6];
+                    uint8_t  index = done.frame[0] - 0xE0;
+                    p.final_pending        |= 1 << index;
+                    p.final_deadline[index] = now_us() + ( (uint64_t)steps * MKS_HOST_STEP_TIME + MKS_HOST_TIMEOUT ) * 1000;
+                }
+                complete( p, done, true, p.rx.data() );
+                p.rx.erase( p.rx.begin(), p.rx.begin() + done.response_length );
+                continue;
+            }
+        }
+        if( take_final_status( p ) ){
+            continue;
+        }
+        // no request for the address or a bad checksum, resync
+        p.rx.erase( p.rx.begin() );
+        ++dropped;
+    }
+    if( dropped > 0 ){
+        std::lock_guard<std::mutex> guard( lock );
+        p.stats.dropped_bytes += dropped;
+    }
+}
+
+void SERVO42C_HOST::expire( port &p, uint64_t now ){
+    for( uint8_t i = 0; i < MKS_HOST_MAX_ADDRESSES; ++i ){
+        if( ( ( p.final_pending >> i ) & 1 ) && p.final_deadline[i] <= now ){
+            p.final_pending &= ~( 1 << i ); // lost, don't hold the address forever
+        }
+    }
+    for( size_t i = 0; i < p.in_flight.size(); ){
+        if( p.in_flight[i].deadline > now ){
+            ++i;
+            continue;
+        }
+        request r = p.in_flight[i];
+        p.in_flight.erase( p.in_flight.begin() + i );
+        p.rx.clear(); // a late answer would be taken for the next request
+        complete( p, r, false, NULL );
+    }
+}
+
+void SERVO42C_HOST::complete( port &p, request &r, bool ok, const uint8_t *response ){
+    uint32_t latency = (uint32_t)( now_us() - r.submitted );
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        --p.stats.queued;
+        if( ok ){
+            ++p.stats.transactions;
+            if( record_latencies ){
+                latencies.push_back( latency );
+            }
+        } else {
+            ++p.stats.timeouts;
+        }
+    }
+    if( r.callback ){
+        r.callback( ok, response, ok ? r.response_length : 0, latency );
+    }
+}
+
+int SERVO42C_HOST::next_timeout( uint64_t now ){
+    uint64_t next = now + 100000; // wake up at least every 100ms to check running
+    for( size_t i = 0; i < ports.size(); ++i ){
+        for( size_t n = 0; n < ports[i]->in_flight.size(); ++n ){
+            if( ports[i]->in_flight[n].deadline < next ){
+                next = ports[i]->in_flight[n].deadline;
+            }
+        }
+        for( uint8_t n = 0; n < MKS_HOST_MAX_ADDRESSES; ++n ){
+            if( ( ( ports[i]->final_pending >> n ) & 1 ) && ports[i]->final_deadline[n] < next ){
+                next = ports[i]->final_deadline[n];
+            }
+        }
+    }
+    return next <= now ? 0 : (int)( ( next - now + 999 ) / 1000 );
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_HOST
+#define SERVO42C_MKS_HOST
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//###############################################################
+// Linux host driver
+// Talks the MKS protocol directly to drives on USB serial
+// adapters, without the MCU in between. One bus per port, all
+// ports are served by one epoll thread. Requests from any thread
+// are queued per port and sent in order. Answers are matched by
+// address and checked with the checksum.
+//
+// Status frames that come later are modeled as on the MCU:
+// 0xFD answers 1 at the start and [address, 2, checksum] when the
+// move is done. That frame is taken out of the stream, requests
+// whose answer can be a 2 (0x3A, 0x3E, 0x80) wait for it. A stop
+// or new motion command drops it. 0x80 only answers when the
+// calibration is done, a status 0 before that is skipped.
+//
+// Pipeline depth: above 1 the next request goes out before the
+// previous answer is in, as long as it is for a different slave
+// address. All drives of a port answer on the same line and have
+// no arbitration, two answers that overlap collide and both are
+// lost. Only use it where answers can't overlap, on a shared MKS
+// bus keep the default of 1
+//###############################################################
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+static const uint8_t  MKS_HOST_MAX_DATA       = 5;
+static const uint8_t  MKS_HOST_MAX_RESPONSE   = 8;
+static const uint32_t MKS_HOST_TIMEOUT        = 3000; // ms, same as MKS_WAIT_TIMEOUT on the MCU
+static const uint32_t MKS_HOST_CALIBRATE_TIMEOUT = 60000; // ms, least timeout of 0x80
+static const uint32_t MKS_HOST_STEP_TIME      = 100;  // ms per step until a missing final status of 0xFD is given up
+static const uint8_t  MKS_HOST_MAX_ADDRESSES  = 10;
+
+// data bytes of a request and length of the answer, 0 = unknown command
+uint8_t servo42c_host_data_length( uint8_t cmd );
+uint8_t servo42c_host_response_length( uint8_t cmd );
+uint8_t servo42c_host_checksum( const uint8_t *data, size_t length );
+
+typedef std::function<void( bool ok, const uint8_t *response, uint8_t length, uint32_t latency_us )> servo42c_host_callback;
+
+struct servo42c_host_stats {
+    uint64_t transactions;
+    uint64_t timeouts;
+    uint64_t dropped_bytes;  // bytes that didn't belong to a request in flight
+    uint64_t final_status;   // final status frames of 0xFD taken out of the stream
+    uint32_t queued;         // requests waiting right now
+};
+
+class SERVO42C_HOST {
+
+    private:
+
+        struct request {
+            uint8_t  frame[3 + MKS_HOST_MAX_DATA];
+            uint8_t  frame_length;
+            uint8_t  response_length;
+            uint32_t timeout;
+            uint64_t submitted;  // us
+            uint64_t deadline;   // us, set when written
+            servo42c_host_callback callback;
+        };
+
+        struct port {
+            int                  fd;
+            uint32_t             index;
+            uint8_t              depth;
+            std::deque<request>  pending;
+            std::deque<request>  in_flight;
+            std::vector<uint8_t> rx;
+            std::vector<uint8_t> tx;        // written when the fd takes it, EPOLLOUT while not empty
+            bool                 tx_waiting;
+            uint16_t             final_pending;  // bit per address, 0xFD status 2 still due
+            uint64_t             final_deadline[MKS_HOST_MAX_ADDRESSES];
+            servo42c_host_stats  stats;
+        };
+
+        std::vector<port*>  ports;
+        std::mutex          lock;          // guards submissions, stats and running for submit()
+        std::vector<std::pair<int, request>> submissions;
+        std::vector<uint32_t> latencies;
+        bool                record_latencies;
+
+        int                 epoll_fd;
+        int                 wake_fd;
+        std::thread         thread;
+        std::atomic<bool>   running;
+
+        void run( void );
+        void take_submissions( void );
+        void send_pending( port &p );
+        void flush_tx( port &p );
+        void read_port( port &p );
+        bool take_final_status( port &p );
+        void expire( port &p, uint64_t now );
+        void complete( port &p, request &r, bool ok, const uint8_t *response );
+        int  next_timeout( uint64_t now );
+
+    public:
+        SERVO42C_HOST();
+        ~SERVO42C_HOST();
+        int  add_port( const char *device, uint32_t baudrate = 38400, uint8_t pipeline_depth = 1 );
+        bool start( void );
+        void stop( void );
+
+        bool submit( int port, uint8_t address, uint8_t cmd, const uint8_t *data, uint8_t data_length, 
+                     servo42c_host_callback callback, uint32_t timeout_ms = MKS_HOST_TIMEOUT );
+        bool transact( int port, uint8_t address, uint8_t cmd, const uint8_t *data, uint8_t data_length, 
+                       uint8_t *response, uint32_t timeout_ms = MKS_HOST_TIMEOUT );
+        bool read_encoder( int port, uint8_t address, int64_t &encoder );
+
+        void get_stats( int port, servo42c_host_stats &stats );
+        void set_record_latencies( bool active );
+        void take_latencies( std::vector<uint32_t> &latencies );
+
+};
+
+
+#endif
\ No newline at end of file
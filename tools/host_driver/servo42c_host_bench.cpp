@@ -0,0 +1,257 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+// 
+// servo42c_host_bench [drives per port] [seconds] [baudrate|0] [pipeline depth]
+//
+// Scaling benchmark for the host driver. Every port is a pty pair,
+// an emulator thread answers on the master side like a bus of
+// drives. With a baudrate the requests take their wire time on the
+// host line, each drive answers MKS_BENCH_ANSWER_DELAY after its
+// request is in and takes the wire time of the answer. Drives
+// don't wait for each other: answers that overlap collide, both
+// arrive with a bad checksum and count as collisions. 0 answers at
+// once and measures only the host side.
+// One client thread per drive reads the encoder in a closed loop.
+// Runs with 1, 4, 8 and 16 ports. The pipeline depth defaults to 1,
+// above that answers collide as on a real shared bus
+//
+//####################################################################
+#include "servo42c_host.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t now_us(){
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+struct emulated_answer {
+    uint64_t due;
+    uint8_t  frame[MKS_HOST_MAX_RESPONSE];
+    uint8_t  length;
+};
+
+static const uint32_t MKS_BENCH_ANSWER_DELAY = 100; // us from the end of a request to the answer
+
+struct emulated_bus {
+    int                         master;
+    std::vector<uint8_t>        rx;
+    std::deque<emulated_answer> answers;  // ordered by due
+    uint64_t                    tx_free;  // host line free again
+    uint64_t                    rx_free;  // end of the last answer on the drive line
+    uint64_t                    collisions;
+    int64_t                     encoder[10];
+};
+
+static uint32_t wire_us( uint32_t baudrate, uint8_t bytes ){
+    return baudrate == 0 ? 0 : (uint32_t)( (uint64_t)bytes * 10 * 1000000 / baudrate );
+}
+
+//#########################################################################
+// Parse complete requests and queue the answers
+//#########################################################################
+static void emulate_requests( emulated_bus &bus, uint32_t baudrate ){
+    while( bus.rx.size() >= 3 ){
+        uint8_t address = bus.rx[0] - 0xE0;
+        if( address > 9 ){
+            bus.rx.erase( bus.rx.begin() );
+            continue;
+        }
+        uint8_t cmd    = bus.rx[1];
+        uint8_t length = 3 + servo42c_host_data_length( cmd );
+        if( bus.rx.size() < length ){
+            return;
+        }
+        emulated_answer answer;
+        answer.length   = servo42c_host_response_length( cmd );
+        answer.frame[0] = bus.rx[0];
+        if( cmd == 0x30 ){
+            int64_t  encoder = bus.encoder[address]++;
+            int32_t  carrier = (int32_t)( encoder >> 16 );
+            uint16_t value   = (uint16_t)( encoder & 0xFFFF );
+            answer.frame[1] = carrier >> 24;
+            answer.frame[2] = carrier >> 16;
+            answer.frame[3] = carrier >> 8;
+            answer.frame[4] = carrier;
+            answer.frame[5] = value >> 8;
+            answer.frame[6] = value;
+        } else {
+            memset( answer.frame + 1, answer.length > 2 ? 1 : 0, answer.length - 2 );
+        }
+        answer.frame[answer.length - 1] = servo42c_host_checksum( answer.frame, answer.length - 1 );
+        uint64_t received = std::max( now_us(), bus.tx_free ) + wire_us( baudrate, length );
+        uint64_t start    = received + ( baudrate == 0 ? 0 : MKS_BENCH_ANSWER_DELAY );
+        bus.tx_free       = received;
+        answer.due        = start + wire_us( baudrate, answer.length );
+        if( start < bus.rx_free ){
+            // another drive is still sending, both frames are garbage
+            answer.frame[answer.length - 1] ^= 0xFF;
+            for( size_t i = 0; i < bus.answers.size(); ++i ){
+                if( bus.answers[i].due > start ){
+                    bus.answers[i].frame[bus.answers[i].length - 1] ^= 0xFF;
+                    bus.collisions += 1;
+                }
+            }
+            bus.collisions += 1;
+        }
+        bus.rx_free = std::max( bus.rx_free, answer.due );
+        std::deque<emulated_answer>::iterator position = bus.answers.end();
+        while( position != bus.answers.begin() && ( position - 1 )->due > answer.due ){
+            --position;
+        }
+        bus.answers.insert( position, answer );
+        bus.rx.erase( bus.rx.begin(), bus.rx.begin() + length );
+    }
+}
+
+static void emulator( std::vector<emulated_bus> *buses, uint32_t baudrate, std::atomic<bool> *running ){
+    int epoll_fd = epoll_create1( 0 );
+    for( size_t i = 0; i < buses->size(); ++i ){
+        struct epoll_event event;
+        memset( &event, 0, sizeof( event ) );
+        event.events   = EPOLLIN;
+        event.data.u32 = i;
+        epoll_ctl( epoll_fd, EPOLL_CTL_ADD, (*buses)[i].master, &event );
+    }
+    struct epoll_event events[32];
+    while( *running ){
+        uint64_t now  = now_us();
+        int      wait = 10;
+        for( size_t i = 0; i < buses->size(); ++i ){
+            if( !(*buses)[i].answers.empty() ){
+                uint64_t due = (*buses)[i].answers.front().due;
+                wait = std::min( wait, due <= now ? 0 : (int)( ( due - now + 999 ) / 1000 ) );
+            }
+        }
+        int count = epoll_wait( epoll_fd, events, 32, wait );
+        for( int i = 0; i < count; ++i ){
+            emulated_bus &bus = (*buses)[events[i].data.u32];
+            uint8_t buffer[256];
+            ssize_t n;
+            while( ( n = read( bus.master, buffer, sizeof( buffer ) ) ) > 0 ){
+                bus.rx.insert( bus.rx.end(), buffer, buffer + n );
+            }
+            emulate_requests( bus, baudrate );
+        }
+        now = now_us();
+        for( size_t i = 0; i < buses->size(); ++i ){
+            emulated_bus &bus = (*buses)[i];
+            while( !bus.answers.empty() && bus.answers.front().due <= now ){
+                if( write( bus.master, bus.answers.front().frame, bus.answers.front().length ) < 0 ){}
+                bus.answers.pop_front();
+            }
+        }
+    }
+    close( epoll_fd );
+}
+
+//#########################################################################
+// One run with a number of ports
+//#########################################################################
+static void run_bench( int port_count, int drives, int seconds, uint32_t baudrate, uint8_t depth ){
+    std::vector<emulated_bus> buses( port_count );
+    SERVO42C_HOST host;
+    for( int i = 0; i < port_count; ++i ){
+        emulated_bus &bus = buses[i];
+        bus.master   = posix_openpt( O_RDWR | O_NOCTTY );
+        bus.tx_free    = 0;
+        bus.rx_free    = 0;
+        bus.collisions = 0;
+        memset( bus.encoder, 0, sizeof( bus.encoder ) );
+        grantpt( bus.master );
+        unlockpt( bus.master );
+        fcntl( bus.master, F_SETFL, O_NONBLOCK );
+        if( host.add_port( ptsname( bus.master ), baudrate == 0 ? 38400 : baudrate, depth ) < 0 ){
+            fprintf( stderr, "failed to open %s\n", ptsname( bus.master ) );
+            exit( 1 );
+        }
+    }
+    std::atomic<bool> emulating( true );
+    std::thread emulator_thread( emulator, &buses, baudrate, &emulating );
+    host.start();
+    host.set_record_latencies( true );
+
+    std::atomic<bool>     active( true );
+    std::atomic<uint64_t> errors( 0 );
+    std::vector<std::thread> clients;
+    for( int p = 0; p < port_count; ++p ){
+        for( int d = 0; d < drives; ++d ){
+            clients.push_back( std::thread( [&host, &active, &errors, p, d]{
+                int64_t encoder;
+                while( active ){
+                    if( !host.read_encoder( p, d, encoder ) ){
+                        ++errors;
+                    }
+                }
+            } ) );
+        }
+    }
+    uint64_t start = now_us();
+    sleep( seconds );
+    active = false;
+    for( size_t i = 0; i < clients.size(); ++i ){
+        clients[i].join();
+    }
+    uint64_t elapsed = now_us() - start;
+    host.stop();
+    emulating = false;
+    emulator_thread.join();
+
+    std::vector<uint32_t> latencies;
+    host.take_latencies( latencies );
+    std::sort( latencies.begin(), latencies.end() );
+    uint64_t dropped    = 0;
+    uint64_t collisions = 0;
+    for( int i = 0; i < port_count; ++i ){
+        servo42c_host_stats stats;
+        host.get_stats( i, stats );
+        dropped    += stats.dropped_bytes;
+        collisions += buses[i].collisions;
+        close( buses[i].master );
+    }
+    size_t n = latencies.size();
+    if( n == 0 ){
+        printf( "%5d %7d %10s\n", port_count, port_count * drives, "no answers" );
+        return;
+    }
+    printf( "%5d %7d %10.0f %8u %8u %8u %8u %8llu %8llu %10llu\n", port_count, port_count * drives, 
+            (double)n * 1000000.0 / elapsed,
+            latencies[n / 2], latencies[n * 99 / 100], latencies[n * 999 / 1000], latencies[n - 1],
+            (unsigned long long)errors.load(), (unsigned long long)dropped, (unsigned long long)collisions );
+}
+
+int main( int argc, char **argv ){
+    int      drives   = argc > 1 ? atoi( argv[1] ) : 4;
+    int      seconds  = argc > 2 ? atoi( argv[2] ) : 3;
+    uint32_t baudrate = argc > 3 ? strtoul( argv[3], NULL, 0 ) : 38400;
+    int      depth    = argc > 4 ? atoi( argv[4] ) : 1;
+    if( drives < 1 || drives > 10 || seconds < 1 || depth < 1 || depth > 10 ){
+        fprintf( stderr, "usage: servo42c_host_bench [drives per port 1-10] [seconds] [baudrate|0] [pipeline depth 1-10]\n" );
+        return 1;
+    }
+    printf( "%d drives per port, %u baud%s, pipeline depth %d\n", drives, baudrate, baudrate == 0 ? " (no wire time)" : "", depth );
+    printf( "%5s %7s %10s %8s %8s %8s %8s %8s %8s %10s\n", "ports", "drives", "tps", "p50 us", "p99 us", "p99.9 us", "max us", "errors", "dropped", "collisions" );
+    const int port_counts[] = { 1, 4, 8, 16 };
+    for( int i = 0; i < 4; ++i ){
+        run_bench( port_counts[i], drives, seconds, baudrate, (uint8_t)depth );
+    }
+    return 0;
+}
@@ -0,0 +1,184 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// Command line client for the RPC gateway
+//
+// servo42c_rpc_cli <device> <command> [args] [+ <command> [args]]...
+//
+// Commands joined with + are sent as one batch
+//   encoder <axis>                  pulses <axis>
+//   error <axis>                    position <axis>
+//   enable <axis> <0|1>             stop <axis>
+//   run <axis> <dir> <speed>        move <axis> <dir> <speed> <steps>
+//   release <axis>                  zero <axis>
+//   current <axis> <mA>
+//   watch <axis mask> <period ms>   prints telemetry until killed
+//   sequence <file>                 compile, upload and start a sequence
+//   seqstatus                       state and program counter of the sequence
+//
+//####################################################################
+#include "servo42c_rpc_client.h"
+#include "servo42c_sequence_compiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+static int usage(){
+    fprintf( stderr, "usage: servo42c_rpc_cli <device> <command> [args] [+ <command> [args]]...\n" );
+    return 1;
+}
+
+//#########################################################################
+// Parse one command starting at argv[pos] and add it to the batch
+//#########################################################################
+static bool add_command( SERVO42C_RPC_CLIENT &client, int argc, char **argv, int &pos ){
+    std::string cmd = argv[pos++];
+    long values[4] = { 0 };
+    int  count = 0;
+    while( pos < argc && std::string( argv[pos] ) != "+" && count < 4 ){
+        values[count++] = strtol( argv[pos++], NULL, 0 );
+    }
+    uint8_t axis = (uint8_t)values[0];
+    uint8_t args[6];
+    if( cmd == "encoder" ){ return client.add( axis, MKS_RPC_OP_GET_ENCODER ); }
+    if( cmd == "pulses" ){ return client.add( axis, MKS_RPC_OP_GET_PULSES ); }
+    if( cmd == "error" ){ return client.add( axis, MKS_RPC_OP_GET_ANGLE_ERROR ); }
+    if( cmd == "position" ){ return client.add( axis, MKS_RPC_OP_GET_POSITION ); }
+    if( cmd == "stop" ){ return client.add( axis, MKS_RPC_OP_STOP ); }
+    if( cmd == "release" ){ return client.add( axis, MKS_RPC_OP_RELEASE_LOCK ); }
+    if( cmd == "zero" ){ return client.add( axis, MKS_RPC_OP_GOTO_ZERO ); }
+    if( cmd == "enable" ){
+        args[0] = (uint8_t)values[1];
+        return client.add( axis, MKS_RPC_OP_SET_ENABLE, args );
+    }
+    if( cmd == "run" ){
+        args[0] = (uint8_t)values[1];
+        args[1] = (uint8_t)values[2];
+        return client.add( axis, MKS_RPC_OP_RUN_CONTINUOUS, args );
+    }
+    if( cmd == "move" ){
+        args[0] = (uint8_t)values[1];
+        args[1] = (uint8_t)values[2];
+        servo42c_put_u32( args + 2, (uint32_t)values[3] );
+        return client.add( axis, MKS_RPC_OP_MOVE_STEPS, args );
+    }
+    if( cmd == "current" ){
+        servo42c_put_u16( args, (uint16_t)values[1] );
+        return client.add( axis, MKS_RPC_OP_SET_CURRENT, args );
+    }
+    fprintf( stderr, "unknown command %s\n", cmd.c_str() );
+    return false;
+}
+
+static void print_result( const servo42c_rpc_result &result ){
+    printf( "axis %u op 0x%02X %s", result.axis, result.op, result.ok ? "ok" : "failed" );
+    switch( result.op ){
+        case MKS_RPC_OP_GET_ENCODER:
+        case MKS_RPC_OP_GET_PULSES:
+            printf( " %lld", (long long)(int64_t)servo42c_get_u64( result.data ) );
+            break;
+        case MKS_RPC_OP_GET_ANGLE_ERROR:
+            printf( " %d", (int16_t)servo42c_get_u16( result.data ) );
+            break;
+        case MKS_RPC_OP_GET_POSITION: {
+            int64_t following = (int64_t)servo42c_get_u64( result.data + 16 );
+            printf( " encoder %lld pulses %lld", 
+                    (long long)(int64_t)servo42c_get_u64( result.data ),
+                    (long long)(int64_t)servo42c_get_u64( result.data + 8 ) );
+            if( following == MKS_RPC_NO_FOLLOWING ){
+                printf( " following error n/a" );
+            } else {
+                printf( " following error %lld", (long long)following );
+            }
+            break;
+        }
+    }
+    printf( "\n" );
+}
+
+int main( int argc, char **argv ){
+    if( argc < 3 ){
+        return usage();
+    }
+    SERVO42C_RPC_CLIENT client;
+    if( !client.open_port( argv[1] ) ){
+        perror( argv[1] );
+        return 1;
+    }
+    if( std::string( argv[2] ) == "sequence" ){
+        if( argc < 4 ){ return usage(); }
+        std::ifstream file( argv[3] );
+        std::stringstream source;
+        source << file.rdbuf();
+        std::vector<uint8_t> code;
+        std::string error;
+        if( !file || !servo42c_compile_sequence( source.str(), code, error ) ){
+            fprintf( stderr, "%s: %s\n", argv[3], file ? error.c_str() : "can't read" );
+            return 1;
+        }
+        if( !client.upload_sequence( code ) ){
+            fprintf( stderr, "upload failed\n" );
+            return 1;
+        }
+        printf( "started, %zu bytes\n", code.size() );
+        return 0;
+    }
+    if( std::string( argv[2] ) == "seqstatus" ){
+        uint8_t  state;
+        uint16_t pc;
+        if( !client.sequence_status( state, pc ) ){
+            fprintf( stderr, "request failed\n" );
+            return 1;
+        }
+        printf( "state %u pc %u\n", state, pc );
+        return 0;
+    }
+    if( std::string( argv[2] ) == "watch" ){
+        if( argc < 5 ){ return usage(); }
+        if( !client.subscribe( (uint16_t)strtol( argv[3], NULL, 0 ), (uint16_t)strtol( argv[4], NULL, 0 ) ) ){
+            fprintf( stderr, "subscribe failed\n" );
+            return 1;
+        }
+        servo42c_telemetry_sample sample;
+        while( client.next_sample( sample, 5000 ) ){
+            printf( "%u axis %u encoder %lld pulses %lld error %d flags 0x%02X\n", sample.timestamp, sample.axis,
+                    (long long)sample.encoder, (long long)sample.pulses, sample.angle_error, sample.flags );
+            fflush( stdout );
+        }
+        return 1;
+    }
+    client.begin_batch();
+    int pos = 2;
+    while( pos < argc ){
+        if( std::string( argv[pos] ) == "+" ){
+            ++pos;
+            continue;
+        }
+        if( !add_command( client, argc, argv, pos ) ){
+            return usage();
+        }
+    }
+    std::vector<servo42c_rpc_result> results;
+    if( !client.execute( results ) ){
+        fprintf( stderr, "request failed\n" );
+        return 1;
+    }
+    for( size_t i = 0; i < results.size(); ++i ){
+        print_result( results[i] );
+    }
+    return 0;
+}
@@ -0,0 +1,240 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// Host client for the RPC gateway
+//
+// Build together with the CLI:
+//   g++ -std=c++11 -O2 -I../../lib/mks42c servo42c_rpc_client.cpp servo42c_sequence_compiler.cpp servo42c_rpc_cli.cpp -o servo42c_rpc_cli
+//
+//####################################################################
+#include "servo42c_rpc_client.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <time.h>
+
+static long now_ms(){
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+SERVO42C_RPC_CLIENT::SERVO42C_RPC_CLIENT() : fd( -1 ), seq( 0 ) {}
+
+SERVO42C_RPC_CLIENT::~SERVO42C_RPC_CLIENT(){
+    close_port();
+}
+
+//#########################################################################
+// Open the tty in raw mode. The baudrate does not matter for USB CDC and
+// ptys but is set to 115200 for real UART adapters
+//#########################################################################
+bool SERVO42C_RPC_CLIENT::open_port( const char *device ){
+    close_port();
+    fd = open( device, O_RDWR | O_NOCTTY | O_NONBLOCK );
+    if( fd < 0 ){
+        return false;
+    }
+    struct termios tio;
+    if( tcgetattr( fd, &tio ) == 0 ){
+        cfmakeraw( &tio );
+        cfsetispeed( &tio, B115200 );
+        cfsetospeed( &tio, B115200 );
+        tio.c_cflag |= CLOCAL | CREAD;
+        tcsetattr( fd, TCSANOW, &tio );
+    }
+    return true;
+}
+
+void SERVO42C_RPC_CLIENT::close_port(){
+    if( fd >= 0 ){
+        close( fd );
+        fd = -1;
+    }
+}
+
+void SERVO42C_RPC_CLIENT::begin_batch(){
+    batch.clear();
+    batch.push_back( ++seq );
+}
+
+//#########################################################################
+// Add a command to the batch. args needs the length listed in MKS_RPC_OPS
+//#########################################################################
+bool SERVO42C_RPC_CLIENT::add( uint8_t axis, uint8_t op, const uint8_t *args ){
+    const servo42c_rpc_op_info *info = servo42c_rpc_find_op( op );
+    if( info == NULL || batch.empty() || batch.size() + 2 + info->args_length > MKS_RPC_MAX_PAYLOAD ){
+        return false;
+    }
+    batch.push_back( axis );
+    batch.push_back( op );
+    for( uint8_t i = 0; i < info->args_length; ++i ){
+        batch.push_back( args[i] );
+    }
+    return true;
+}
+
+//#########################################################################
+// Wait until a complete frame is in the parser
+//#########################################################################
+bool SERVO42C_RPC_CLIENT::read_frame( int timeout_ms ){
+    long deadline = now_ms() + timeout_ms;
+    uint8_t buffer[256];
+    while( true ){
+        long left = deadline - now_ms();
+        if( left < 0 ){
+            return false;
+        }
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if( poll( &pfd, 1, (int)left ) <= 0 ){
+            continue;
+        }
+        // read one byte at a time so nothing after the frame is lost
+        while( read( fd, buffer, 1 ) == 1 ){
+            if( parser.feed( buffer[0] ) ){
+                return true;
+            }
+        }
+    }
+}
+
+void SERVO42C_RPC_CLIENT::queue_telemetry(){
+    servo42c_telemetry_sample block_samples[255];
+    int count = decoder.decode( parser.payload, parser.length, block_samples, 255 );
+    for( int i = 0; i < count; ++i ){
+        samples.push_back( block_samples[i] );
+    }
+}
+
+uint32_t SERVO42C_RPC_CLIENT::get_lost_blocks(){
+    return decoder.get_lost();
+}
+
+//#########################################################################
+// Send the batch and wait for the response. Telemetry that arrives in
+// between is kept for next_sample()
+//#########################################################################
+bool SERVO42C_RPC_CLIENT::execute( std::vector<servo42c_rpc_result> &results, int timeout_ms ){
+    results.clear();
+    if( fd < 0 || batch.empty() ){
+        return false;
+    }
+    std::vector<uint8_t> frame( batch.size() + MKS_RPC_FRAME_OVERHEAD );
+    size_t size = servo42c_rpc_build_frame( MKS_RPC_TYPE_REQUEST, batch.data(), batch.size(), frame.data() );
+    if( write( fd, frame.data(), size ) != (ssize_t)size ){
+        return false;
+    }
+    long deadline = now_ms() + timeout_ms;
+    while( read_frame( (int)( deadline - now_ms() ) ) ){
+        if( parser.type == MKS_RPC_TYPE_TELEMETRY ){
+            queue_telemetry();
+            continue;
+        }
+        if( parser.length < 1 || parser.payload[0] != batch[0] ){
+            continue; // late answer to an older request
+        }
+        if( parser.type == MKS_RPC_TYPE_ERROR ){
+            return false;
+        }
+        for( uint16_t pos = 1; pos + 3 <= parser.length; ){
+            servo42c_rpc_result result;
+            result.axis   = parser.payload[pos];
+            result.op     = parser.payload[pos + 1];
+            result.ok     = parser.payload[pos + 2] != 0;
+            const servo42c_rpc_op_info *info = servo42c_rpc_find_op( result.op );
+            result.length = info != NULL ? info->result_length : 0;
+            if( pos + 3 + result.length > parser.length ){
+                return false;
+            }
+            memcpy( result.data, parser.payload + pos + 3, result.length );
+            results.push_back( result );
+            pos += 3 + result.length;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool SERVO42C_RPC_CLIENT::subscribe( uint16_t axis_mask, uint16_t period_ms ){
+    uint8_t args[4];
+    servo42c_put_u16( args, axis_mask );
+    servo42c_put_u16( args + 2, period_ms );
+    std::vector<servo42c_rpc_result> results;
+    begin_batch();
+    add( MKS_RPC_ALL_AXES, MKS_RPC_OP_SUBSCRIBE, args );
+    return execute( results ) && results.size() == 1 && results[0].ok;
+}
+
+bool SERVO42C_RPC_CLIENT::next_sample( servo42c_telemetry_sample &sample, int timeout_ms ){
+    long deadline = now_ms() + timeout_ms;
+    while( samples.empty() ){
+        if( !read_frame( (int)( deadline - now_ms() ) ) ){
+            return false;
+        }
+        if( parser.type == MKS_RPC_TYPE_TELEMETRY ){
+            queue_telemetry();
+        }
+    }
+    sample = samples.front();
+    samples.pop_front();
+    return true;
+}
+
+//#########################################################################
+// Load a compiled sequence in 16 byte chunks and start it. As many
+// chunks as fit go into one request
+//#########################################################################
+bool SERVO42C_RPC_CLIENT::upload_sequence( const std::vector<uint8_t> &code ){
+    std::vector<servo42c_rpc_result> results;
+    begin_batch();
+    add( MKS_RPC_ALL_AXES, MKS_RPC_OP_SEQ_STOP );
+    for( size_t offset = 0; offset < code.size(); offset += MKS_RPC_SEQ_CHUNK ){
+        uint8_t args[2 + MKS_RPC_SEQ_CHUNK] = { 0 };
+        servo42c_put_u16( args, (uint16_t)offset );
+        size_t length = code.size() - offset < MKS_RPC_SEQ_CHUNK ? code.size() - offset : MKS_RPC_SEQ_CHUNK;
+        memcpy( args + 2, &code[offset], length );
+        if( !add( MKS_RPC_ALL_AXES, MKS_RPC_OP_SEQ_LOAD, args ) ){
+            if( !execute( results ) ){ return false; }
+            for( size_t i = 0; i < results.size(); ++i ){
+                if( !results[i].ok ){ return false; }
+            }
+            begin_batch();
+            add( MKS_RPC_ALL_AXES, MKS_RPC_OP_SEQ_LOAD, args );
+        }
+    }
+    uint8_t args[2];
+    servo42c_put_u16( args, (uint16_t)code.size() );
+    add( MKS_RPC_ALL_AXES, MKS_RPC_OP_SEQ_START, args );
+    if( !execute( results ) ){
+        return false;
+    }
+    for( size_t i = 0; i < results.size(); ++i ){
+        if( !results[i].ok ){ return false; }
+    }
+    return true;
+}
+
+bool SERVO42C_RPC_CLIENT::sequence_status( uint8_t &state, uint16_t &pc ){
+    std::vector<servo42c_rpc_result> results;
+    begin_batch();
+    add( MKS_RPC_ALL_AXES, MKS_RPC_OP_SEQ_STATUS );
+    if( !execute( results ) || results.size() != 1 || !results[0].ok ){
+        return false;
+    }
+    state = results[0].data[0];
+    pc    = servo42c_get_u16( results[0].data + 1 );
+    return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_RPC_CLIENT
+#define SERVO42C_MKS_RPC_CLIENT
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//###############################################################
+// Linux side of the RPC gateway
+// Works with the USB serial of the MCU or any tty/pty that 
+// speaks the protocol in servo42c_rpc_protocol.h
+//###############################################################
+#include "servo42c_rpc_protocol.h"
+#include "servo42c_telemetry_codec.h"
+#include <vector>
+#include <deque>
+
+struct servo42c_rpc_result {
+    uint8_t axis;
+    uint8_t op;
+    bool    ok;
+    uint8_t length;
+    uint8_t data[24];
+};
+
+class SERVO42C_RPC_CLIENT {
+
+    private:
+
+        int     fd;
+        uint8_t seq;
+        servo42c_rpc_parser parser;
+        std::vector<uint8_t> batch;
+        std::deque<servo42c_telemetry_sample> samples;
+        SERVO42C_TELEMETRY_DECODER decoder;
+
+        bool read_frame( int timeout_ms );
+        void queue_telemetry( void );
+
+    public:
+        SERVO42C_RPC_CLIENT();
+        ~SERVO42C_RPC_CLIENT();
+        bool open_port( const char *device );
+        void close_port( void );
+
+        void begin_batch( void );
+        bool add( uint8_t axis, uint8_t op, const uint8_t *args = NULL );
+        bool execute( std::vector<servo42c_rpc_result> &results, int timeout_ms = 5000 );
+
+        bool subscribe( uint16_t axis_mask, uint16_t period_ms );
+        bool next_sample( servo42c_telemetry_sample &sample, int timeout_ms );
+
+        bool upload_sequence( const std::vector<uint8_t> &code );
+        bool sequence_status( uint8_t &state, uint16_t &pc );
+        uint32_t get_lost_blocks( void );
+
+};
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,145 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// Host side sequence compiler
+//
+//####################################################################
+#include "servo42c_sequence_compiler.h"
+#include "servo42c_rpc_protocol.h"
+#include <sstream>
+#include <stdlib.h>
+
+static void put_op( std::vector<uint8_t> &code, uint8_t op, const uint8_t *operands = NULL, size_t length = 0 ){
+    code.push_back( op );
+    code.insert( code.end(), operands, operands + length );
+}
+
+static bool parse_number( const std::string &token, long long &value ){
+    char *end = NULL;
+    value = strtoll( token.c_str(), &end, 0 );
+    return !token.empty() && *end == '\0';
+}
+
+bool servo42c_compile_sequence( const std::string &source, std::vector<uint8_t> &code, std::string &error ){
+    std::istringstream lines( source );
+    std::string line;
+    std::vector<size_t> blocks;   // open loop and if_encoder blocks, innermost last
+                                  // skip operand position of an if, 0 for a loop
+    size_t loops = 0;
+    int  line_number = 0;
+    long long max_axis = 0;
+    code.assign( MKS_SEQUENCE_HEADER_SIZE, 0 );
+
+    while( std::getline( lines, line ) ){
+        ++line_number;
+        size_t comment = line.find( '#' );
+        if( comment != std::string::npos ){ line.erase( comment ); }
+        std::istringstream tokens( line );
+        std::string cmd;
+        if( !( tokens >> cmd ) ){ continue; }
+        std::vector<long long> args;
+        std::string token;
+        while( tokens >> token ){
+            long long value;
+            if( !parse_number( token, value ) ){
+                error = "line " + std::to_string( line_number ) + ": bad number " + token;
+                return false;
+            }
+            args.push_back( value );
+        }
+        size_t expected = 0;
+        uint8_t operands[18];
+        if( cmd == "axis" || cmd == "speed" || cmd == "enable" || cmd == "run" || cmd == "delay" || cmd == "loop" ){ expected = 1; }
+        else if( cmd == "move" || cmd == "if_encoder" ){ expected = 2; }
+        if( args.size() != expected ){
+            error = "line " + std::to_string( line_number ) + ": " + cmd + " needs " + std::to_string( expected ) + " arguments";
+            return false;
+        }
+        if( cmd == "axis" ){
+            if( args[0] < 0 || args[0] > 9 ){ error = "line " + std::to_string( line_number ) + ": axis out of range"; return false; }
+            if( args[0] > max_axis ){ max_axis = args[0]; }
+            operands[0] = (uint8_t)args[0];
+            put_op( code, MKS_SEQ_OP_AXIS, operands, 1 );
+        } else if( cmd == "speed" ){
+            operands[0] = (uint8_t)( args[0] > 127 ? 127 : args[0] );
+            put_op( code, MKS_SEQ_OP_SPEED, operands, 1 );
+        } else if( cmd == "enable" ){
+            operands[0] = args[0] ? 1 : 0;
+            put_op( code, MKS_SEQ_OP_ENABLE, operands, 1 );
+        } else if( cmd == "run" ){
+            operands[0] = args[0] ? 1 : 0;
+            put_op( code, MKS_SEQ_OP_RUN, operands, 1 );
+        } else if( cmd == "delay" ){
+            servo42c_put_u32( operands, (uint32_t)args[0] );
+            put_op( code, MKS_SEQ_OP_DELAY, operands, 4 );
+        } else if( cmd == "move" ){
+            operands[0] = args[0] ? 1 : 0;
+            servo42c_put_u32( operands + 1, (uint32_t)args[1] );
+            put_op( code, MKS_SEQ_OP_MOVE, operands, 5 );
+        } else if( cmd == "wait" ){
+            put_op( code, MKS_SEQ_OP_WAIT );
+        } else if( cmd == "stop" ){
+            put_op( code, MKS_SEQ_OP_STOP );
+        } else if( cmd == "end" ){
+            put_op( code, MKS_SEQ_OP_END );
+        } else if( cmd == "loop" ){
+            if( args[0] < 1 || args[0] > 65535 ){ error = "line " + std::to_string( line_number ) + ": loop count out of range"; return false; }
+            if( loops >= MKS_SEQUENCE_MAX_LOOPS ){ error = "line " + std::to_string( line_number ) + ": loops nested too deep"; return false; }
+            servo42c_put_u16( operands, (uint16_t)args[0] );
+            put_op( code, MKS_SEQ_OP_LOOP, operands, 2 );
+            blocks.push_back( 0 );
+            ++loops;
+        } else if( cmd == "endloop" ){
+            if( blocks.empty() || blocks.back() != 0 ){
+                error = "line " + std::to_string( line_number ) + ( blocks.empty() ? ": endloop without loop" : ": endloop inside if_encoder, endif first" );
+                return false;
+            }
+            blocks.pop_back();
+            --loops;
+            put_op( code, MKS_SEQ_OP_ENDLOOP );
+        } else if( cmd == "if_encoder" ){
+            servo42c_put_u64( operands, (uint64_t)args[0] );
+            servo42c_put_u64( operands + 8, (uint64_t)args[1] );
+            servo42c_put_u16( operands + 16, 0 );
+            put_op( code, MKS_SEQ_OP_IF_ENC, operands, 18 );
+            blocks.push_back( code.size() - 2 );
+        } else if( cmd == "endif" ){
+            if( blocks.empty() || blocks.back() == 0 ){
+                error = "line " + std::to_string( line_number ) + ( blocks.empty() ? ": endif without if_encoder" : ": endif inside loop, endloop first" );
+                return false;
+            }
+            size_t skip_pos = blocks.back();
+            blocks.pop_back();
+            servo42c_put_u16( &code[skip_pos], (uint16_t)( code.size() - ( skip_pos + 2 ) ) );
+        } else {
+            error = "line " + std::to_string( line_number ) + ": unknown command " + cmd;
+            return false;
+        }
+    }
+    if( !blocks.empty() ){
+        error = "missing endloop or endif";
+        return false;
+    }
+    if( code.size() > MKS_SEQUENCE_MAX_SIZE ){
+        error = "sequence is too long";
+        return false;
+    }
+    code[0] = 'S';
+    code[1] = 'Q';
+    code[2] = MKS_SEQUENCE_VERSION;
+    code[3] = (uint8_t)( max_axis + 1 );
+    servo42c_put_u16( &code[4], (uint16_t)( code.size() - MKS_SEQUENCE_HEADER_SIZE ) );
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#ifndef SERVO42C_MKS_SEQUENCE_COMPILER
+#define SERVO42C_MKS_SEQUENCE_COMPILER
+
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//###############################################################
+// Compiles the text form of a sequence into bytecode
+//
+//   # comment
+//   axis <n>                 speed <0-127>
+//   move <dir> <steps>       wait
+//   enable <0|1>             delay <ms>
+//   loop <count> ... endloop
+//   if_encoder <min> <max> ... endif
+//   run <dir>                stop
+//   end
+//###############################################################
+#include "servo42c_sequence_code.h"
+#include <string>
+#include <vector>
+
+bool servo42c_compile_sequence( const std::string &source, std::vector<uint8_t> &code, std::string &error );
+
+
+#endif
\ No newline at end of file
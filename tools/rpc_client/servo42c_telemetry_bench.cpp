@@ -0,0 +1,162 @@
+//###############################################################
+//  _______  _        _______    _______  _______  _______           _______     ___  _______  _______ 
+// (       )| \    /\(  ____ \  (  ____ \(  ____ \(  ____ )|\     /|(  ___  )   /   )/ ___   )(  ____ \
+// | () () ||  \  / /| (    \/  | (    \/| (    \/| (    )|| )   ( || (   ) |  / /) |\/   )  || (    \/
+// | || || ||  (_/ / | (_____   | (_____ | (__    | (____)|| |   | || |   | | / (_) (_   /   )| |      
+// | |(_)| ||   _ (  (_____  )  (_____  )|  __)   |     __)( (   ) )| |   | |(____   _)_/   / | |      
+// | |   | ||  ( \ \       ) |        ) || (      | (\ (    \ \_/ / | |   | |     ) ( /   _/  | |      
+// | )   ( ||  /  \ \/\____) |  /\____) || (____/\| ) \ \__  \   /  | (___) |     | |(   (__/\| (____/\
+// |/     \||_/    \/\_______)  \_______)(_______/|/   \__/   \_/   (_______)     (_)\_______/(_______/
+//                                                                                                    
+// Library to control the Makerbase Servo42C driver
+//###############################################################
+
+//####################################################################
+// 
+// servo42c_telemetry_bench
+//
+// Compares the packed telemetry blocks of the RPC gateway with the
+// text line src/main.cpp prints. Blocks are filled and flushed the
+// way SERVO42C_RPC does it and framed like on the wire. Bytes per
+// sample include the frame overhead and the padding of the fixed
+// size blocks. Encode is what the MCU does per sample, decode runs
+// on the host. Both are timed against one snprintf of the text
+// line, on the machine the bench runs on
+//
+// Build:
+//   g++ -std=c++11 -O2 -I../../lib/mks42c servo42c_telemetry_bench.cpp -o servo42c_telemetry_bench
+//
+//####################################################################
+#include "servo42c_telemetry_codec.h"
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+static const uint32_t BENCH_SAMPLES = 1000000;
+
+struct bench_scenario {
+    const char *name;
+    uint8_t     axes;
+    uint32_t    period_ms;
+    int64_t     encoder_per_period;  // 0 = idle
+    int64_t     pulses_per_period;
+    int16_t     angle_jitter;
+};
+
+//#########################################################################
+// Moving axes run at 10000 microsteps/s with 16 microsteps, that is
+// 204800 encoder counts/s
+//#########################################################################
+static const bench_scenario BENCH_SCENARIOS[] = {
+    { "1 axis idle, 10 ms",    1, 10, 0,    0,   3  },
+    { "1 axis moving, 10 ms",  1, 10, 2048, 100, 50 },
+    { "3 axes moving, 1 ms",   3, 1,  205,  10,  50 },
+};
+
+static uint64_t now_ns(){
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static void make_samples( const bench_scenario &scenario, std::vector<servo42c_telemetry_sample> &samples ){
+    uint32_t random_state = 12345;
+    samples.resize( BENCH_SAMPLES );
+    for( uint32_t i = 0; i < BENCH_SAMPLES; ++i ){
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 17;
+        random_state ^= random_state << 5;
+        uint32_t round = i / scenario.axes;
+        servo42c_telemetry_sample &sample = samples[i];
+        sample.axis        = i % scenario.axes;
+        sample.timestamp   = 1000 + round * scenario.period_ms;
+        sample.flags       = MKS_TELEMETRY_FLAG_ENABLED;
+        sample.encoder     = 0x10000 * ( sample.axis + 1 ) + round * scenario.encoder_per_period + (int64_t)( random_state % 5 ) - 2;
+        sample.pulses      = round * scenario.pulses_per_period;
+        sample.angle_error = (int16_t)( (int32_t)( random_state >> 8 ) % ( 2 * scenario.angle_jitter + 1 ) - scenario.angle_jitter );
+    }
+}
+
+//#########################################################################
+// Same flush rule as SERVO42C_RPC::sample_telemetry(). Returns the bytes
+// on the wire, the frames go to frames back to back
+//#########################################################################
+static size_t encode( const std::vector<servo42c_telemetry_sample> &samples, std::vector<uint8_t> &frames ){
+    SERVO42C_TELEMETRY_ENCODER encoder;
+    uint8_t frame[MKS_RPC_MAX_FRAME];
+    frames.clear();
+    frames.reserve( ( samples.size() / MKS_TELEMETRY_MAX_SAMPLES + 1 ) * ( MKS_TELEMETRY_BLOCK_SIZE + MKS_RPC_FRAME_OVERHEAD ) );
+    for( size_t i = 0; i < samples.size(); ++i ){
+        if( encoder.get_count() == 0 ){
+            encoder.begin( samples[i].timestamp );
+        }
+        encoder.add( samples[i] );
+        if( encoder.is_full() || i + 1 == samples.size() ){
+            size_t size = servo42c_rpc_build_frame( MKS_RPC_TYPE_TELEMETRY, encoder.finish(), MKS_TELEMETRY_BLOCK_SIZE, frame );
+            frames.insert( frames.end(), frame, frame + size );
+            encoder.begin( 0 );
+        }
+    }
+    return frames.size();
+}
+
+static size_t decode( const std::vector<uint8_t> &frames, int64_t &check ){
+    SERVO42C_TELEMETRY_DECODER decoder;
+    servo42c_telemetry_sample  samples[256];
+    size_t frame_size = MKS_TELEMETRY_BLOCK_SIZE + MKS_RPC_FRAME_OVERHEAD;
+    size_t count      = 0;
+    for( size_t offset = 0; offset + frame_size <= frames.size(); offset += frame_size ){
+        int decoded = decoder.decode( &frames[offset + 4], MKS_TELEMETRY_BLOCK_SIZE, samples, 256 );
+        for( int i = 0; i < decoded; ++i ){
+            check += samples[i].encoder;
+        }
+        count += decoded > 0 ? decoded : 0;
+    }
+    return count;
+}
+
+//#########################################################################
+// The line src/main.cpp prints per sample, the float like Serial.print()
+//#########################################################################
+static size_t format_text( const std::vector<servo42c_telemetry_sample> &samples, int64_t &check ){
+    char   line[128];
+    size_t total = 0;
+    for( size_t i = 0; i < samples.size(); ++i ){
+        const servo42c_telemetry_sample &sample = samples[i];
+        float aerr = ( static_cast<float>( sample.angle_error ) / 0xFFFF ) * 360.0f;
+        int length = snprintf( line, sizeof( line ), "\r\n  Shaft error: %.2f  Pulses: %lld  Encoder: %lld  ", 
+                               aerr, (long long)sample.pulses, (long long)sample.encoder );
+        total += length;
+        check += line[length - 3];
+    }
+    return total;
+}
+
+int main(){
+    printf( "per sample             packed bytes  text bytes  encode ns  decode ns  text ns\n" );
+    for( size_t s = 0; s < sizeof( BENCH_SCENARIOS ) / sizeof( BENCH_SCENARIOS[0] ); ++s ){
+        std::vector<servo42c_telemetry_sample> samples;
+        std::vector<uint8_t> frames;
+        make_samples( BENCH_SCENARIOS[s], samples );
+        int64_t  check = 0;
+
+        uint64_t start      = now_ns();
+        size_t   packed     = encode( samples, frames );
+        uint64_t encode_ns  = now_ns() - start;
+        start               = now_ns();
+        size_t   decoded    = decode( frames, check );
+        uint64_t decode_ns  = now_ns() - start;
+
+        start               = now_ns();
+        size_t   text       = format_text( samples, check );
+        uint64_t text_ns    = now_ns() - start;
+
+        if( decoded != samples.size() ){
+            printf( "%s: decoded %u of %u samples\n", BENCH_SCENARIOS[s].name, (unsigned)decoded, (unsigned)samples.size() );
+            return 1;
+        }
+        printf( "%-22s %12.1f %11.1f %10.0f %10.0f %8.0f\n", BENCH_SCENARIOS[s].name, 
+                (double)packed / samples.size(), (double)text / samples.size(), (double)encode_ns / samples.size(), 
+                (double)decode_ns / samples.size(), (double)text_ns / samples.size() );
+        if( check == 42 ){ printf( "\n" ); } // keeps the work from being optimized out
+    }
+    return 0;
+}